@@ -2,6 +2,7 @@
 #define VSHOGI_GAME_HPP
 
 #include <algorithm>
+#include <cassert>
 #include <string>
 #include <vector>
 
@@ -35,6 +36,15 @@ private:
     using StandType = Stand<Config>;
     using StateType = State<Config>;
 
+    /**
+     * @brief What `undo()` needs to revert a move applied.
+     */
+    struct UndoRecord
+    {
+        typename StateType::UndoInfo state;
+        ResultEnum result;
+    };
+
     static constexpr uint num_piece_types = Config::num_piece_types;
     static constexpr uint num_stand_piece_types = Config::num_stand_piece_types;
     static constexpr uint num_dir = Config::num_dir;
@@ -49,6 +59,7 @@ private:
 
     std::vector<std::uint64_t> m_zobrist_hash_list;
     std::vector<MoveType> m_move_list;
+    std::vector<UndoRecord> m_undo_list;
     std::vector<MoveType> m_legal_moves;
     ResultEnum m_result;
     std::uint64_t m_zobrist_hash;
@@ -172,6 +183,33 @@ public:
         update_internals_mcts_internal_vertex();
         return *this;
     }
+    /**
+     * @brief Revert the last move applied by `apply()`, `apply_nocheck()`, or
+     * `apply_mcts_internal_vertex()`, so that a single game can go down and up
+     * a search tree without being copied.
+     * @note Moves applied by the dfpn variants cannot be reverted.
+     * @note There has to be a move applied to revert.
+     */
+    Game& undo()
+    {
+        m_result = remove_record_and_revert_state();
+        if (m_result == ONGOING)
+            update_internals();
+        else
+            m_legal_moves.clear();
+        return *this;
+    }
+
+    /**
+     * @brief Same as `undo()` but skip updating legal moves and result, as
+     * `apply_mcts_internal_vertex()` does.
+     */
+    Game& undo_mcts_internal_vertex()
+    {
+        remove_record_and_revert_state();
+        update_internals_mcts_internal_vertex();
+        return *this;
+    }
     Game& apply_dfpn_offence(const MoveType& move)
     {
         add_record_and_update_state_for_dfpn(move);
@@ -190,6 +228,7 @@ public:
             m_current_state,
             m_zobrist_hash_list,
             m_move_list,
+            m_undo_list,
             m_result,
             m_zobrist_hash,
             m_initial_sfen_without_ply);
@@ -202,6 +241,7 @@ public:
             m_current_state,
             m_zobrist_hash_list,
             m_move_list,
+            m_undo_list,
             m_result,
             m_zobrist_hash,
             m_initial_sfen_without_ply);
@@ -257,6 +297,7 @@ public:
     {
         m_zobrist_hash_list.clear();
         m_move_list.clear();
+        m_undo_list.clear();
         m_zobrist_hash_list.emplace_back(
             m_current_state.get_board().zobrist_hash());
     }
@@ -268,23 +309,26 @@ public:
 protected:
     Game(const StateType& s)
         : m_current_state(s), m_zobrist_hash_list(), m_move_list(),
-          m_legal_moves(), m_result(ONGOING),
+          m_undo_list(), m_legal_moves(), m_result(ONGOING),
           m_zobrist_hash(m_current_state.zobrist_hash()),
           m_initial_sfen_without_ply(m_current_state.to_sfen())
     {
         m_zobrist_hash_list.reserve(128);
         m_move_list.reserve(128);
+        m_undo_list.reserve(128);
         update_internals();
     }
     Game(
         const StateType& s,
         const std::vector<uint64_t>& zobrist_hash_list,
         const std::vector<MoveType>& move_list,
+        const std::vector<UndoRecord>& undo_list,
         const ResultEnum& result,
         const uint64_t& zobrist_hash,
         const std::string& initial_sfen_without_ply)
         : m_current_state(s), m_zobrist_hash_list(zobrist_hash_list),
-          m_move_list(move_list), m_legal_moves(), m_result(result),
+          m_move_list(move_list), m_undo_list(undo_list), m_legal_moves(),
+          m_result(result),
           m_zobrist_hash(zobrist_hash),
           m_initial_sfen_without_ply(initial_sfen_without_ply)
     {
@@ -326,12 +370,32 @@ protected:
     {
         m_zobrist_hash_list.emplace_back(m_zobrist_hash);
         m_move_list.emplace_back(move);
-        m_current_state.apply(move, &m_zobrist_hash);
+        m_undo_list.emplace_back();
+        m_undo_list.back().result = m_result;
+        m_current_state.apply(
+            move, &m_zobrist_hash, &m_undo_list.back().state);
+    }
+    ResultEnum remove_record_and_revert_state()
+    {
+        assert(!m_undo_list.empty());
+        assert(m_undo_list.size() == m_move_list.size());
+        const auto record = m_undo_list.back();
+        m_current_state.undo(m_move_list.back(), record.state);
+        m_zobrist_hash = m_zobrist_hash_list.back();
+        m_undo_list.pop_back();
+        m_move_list.pop_back();
+        m_zobrist_hash_list.pop_back();
+        return record.result;
     }
     void add_record_and_update_state_for_dfpn(const MoveType& move)
     {
+        // Undo records are kept in step with the moves, though the hash list
+        // does not allow reverting these moves.
         m_move_list.emplace_back(move);
-        m_current_state.apply(move, &m_zobrist_hash);
+        m_undo_list.emplace_back();
+        m_undo_list.back().result = m_result;
+        m_current_state.apply(
+            move, &m_zobrist_hash, &m_undo_list.back().state);
         m_zobrist_hash_list.emplace_back(
             m_current_state.get_board().zobrist_hash());
     }
@@ -44,6 +44,13 @@ private:
         (1U << (msb_promotion + 1U)) - 1U - destination_mask);
     static constexpr Int source_mask = static_cast<Int>(
         (1U << (msb_source + 1U)) - 1U - destination_mask - promotion_mask);
+    static constexpr uint num_hashes
+        = (num_squares + num_stand_piece_types) << source_shift;
+
+    /**
+     * @brief Policy index of each move keyed by its hash, for each turn.
+     */
+    inline static std::uint16_t policy_index_table[num_colors][num_hashes];
 
 private:
     /**
@@ -146,11 +153,43 @@ public:
         const auto src_index = to_dlshogi_source_index();
         return dst_index * num_policy_per_square() + src_index;
     }
+
+    /**
+     * @brief Return policy index of this move in the view of the player to
+     * move, i.e. that of the rotated move if it is white's turn.
+     * @note `init_tables()` has to be called beforehand.
+     */
+    uint to_dlshogi_policy_index(const ColorEnum turn) const
+    {
+        return policy_index_table[turn][m_value];
+    }
     static constexpr uint num_policy_per_square()
     {
         return 2 * num_dir_dl + num_stand_piece_types;
     }
 
+    /**
+     * @note `Squares<Config>::init_tables()` has to be called beforehand.
+     */
+    static void init_tables()
+    {
+        for (uint src = num_squares + num_stand_piece_types; src--;) {
+            for (auto dst : EnumIterator<Square, num_squares>()) {
+                for (bool promote : {false, true}) {
+                    if (promote && (src >= num_squares))
+                        continue;
+                    const auto m = Move(dst, src, promote);
+                    policy_index_table[BLACK][m.m_value]
+                        = static_cast<std::uint16_t>(
+                            m.to_dlshogi_policy_index());
+                    policy_index_table[WHITE][m.m_value]
+                        = static_cast<std::uint16_t>(
+                            m.rotate().to_dlshogi_policy_index());
+                }
+            }
+        }
+    }
+
 private:
     Move(const Square dst, const uint src, const bool promote = false)
         : m_value(static_cast<Int>(
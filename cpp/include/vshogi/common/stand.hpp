@@ -214,6 +214,46 @@ public:
         }
     }
 
+    /**
+     * @brief Put a piece back on a stand, reverting `pop_piece_from()`.
+     *
+     * @param c Color of the stand.
+     * @param pt Piece type to put.
+     * @param hash Pointer to zobrist hash value.
+     */
+    void push_piece_to(
+        const ColorEnum& c,
+        const PieceType& pt,
+        std::uint64_t* const hash = nullptr)
+    {
+        m_stands[c].add(pt);
+        if (hash != nullptr) {
+            const auto num_after = m_stands[c].count(pt);
+            const auto num_before = num_after - 1;
+            *hash ^= zobrist_table[c][pt][num_before];
+            *hash ^= zobrist_table[c][pt][num_after];
+        }
+    }
+
+    /**
+     * @brief Remove captured piece from a stand, reverting
+     * `add_captured_piece()`.
+     *
+     * @param captured Captured piece.
+     * @param hash Pointer to zobrist hash value.
+     */
+    void remove_captured_piece(
+        const ColoredPiece& captured, std::uint64_t* const hash = nullptr)
+    {
+        if ((captured == PHelper::VOID)
+            || (PHelper::to_piece_type(captured) == PHelper::OU))
+            return;
+        pop_piece_from(
+            ~PHelper::get_color(captured),
+            PHelper::demote(PHelper::to_piece_type(captured)),
+            hash);
+    }
+
     std::uint64_t zobrist_hash() const
     {
         std::uint64_t out = static_cast<std::uint64_t>(0);
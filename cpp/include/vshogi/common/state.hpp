@@ -1,6 +1,7 @@
 #ifndef VSHOGI_STATE_HPP
 #define VSHOGI_STATE_HPP
 
+#include <algorithm>
 #include <random>
 #include <string>
 #include <vector>
@@ -140,26 +141,80 @@ public:
     {
         return State(m_board.hflip(), m_stands, m_turn);
     }
-    State& apply(const MoveType& move, std::uint64_t* const hash = nullptr)
+    /**
+     * @brief What `apply()` overwrites and `undo()` needs to restore.
+     * @note The moved piece is recorded rather than derived from the move,
+     * because some variants promote pieces implicitly.
+     */
+    struct UndoInfo
     {
+        ColoredPiece moved;
+        ColoredPiece captured;
+        Square checker_locations[2];
+    };
+
+    State& apply(
+        const MoveType& move,
+        std::uint64_t* const hash = nullptr,
+        UndoInfo* const info = nullptr)
+    {
+        if (info != nullptr)
+            std::copy_n(m_checker_locations, 2, info->checker_locations);
         if (move.is_drop()) {
             const PieceType src = move.source_piece();
             const Square dst = move.destination();
             const ColoredPiece p = m_stands.pop_piece_from(m_turn, src, hash);
             m_board.apply(dst, p, hash);
             update_checkers_before_turn_update(dst);
+            if (info != nullptr) {
+                info->moved = p;
+                info->captured = PHelper::VOID;
+            }
         } else {
             const Square src = move.source_square();
             const Square dst = move.destination();
+            if (info != nullptr)
+                info->moved = m_board[src];
             const auto captured = m_board.apply(dst, src, move.promote(), hash);
             m_stands.add_captured_piece(captured, hash);
             update_checkers_before_turn_update(dst, src);
+            if (info != nullptr)
+                info->captured = captured;
         }
         m_turn = ~m_turn;
         if (hash != nullptr)
             *hash ^= zobrist_hash_for_turn;
         return *this;
     }
+
+    /**
+     * @brief Revert `apply(move, hash, &info)` made just before.
+     *
+     * @param move Move applied last.
+     * @param info Information recorded by the `apply()`.
+     * @param hash Pointer to zobrist hash value.
+     * @return State& Reverted state.
+     */
+    State& undo(
+        const MoveType& move,
+        const UndoInfo& info,
+        std::uint64_t* const hash = nullptr)
+    {
+        m_turn = ~m_turn;
+        if (hash != nullptr)
+            *hash ^= zobrist_hash_for_turn;
+        const Square dst = move.destination();
+        if (move.is_drop()) {
+            m_board.apply(dst, PHelper::VOID, hash);
+            m_stands.push_piece_to(m_turn, move.source_piece(), hash);
+        } else {
+            m_board.apply(dst, info.captured, hash);
+            m_board.apply(move.source_square(), info.moved, hash);
+            m_stands.remove_captured_piece(info.captured, hash);
+        }
+        std::copy_n(info.checker_locations, 2, m_checker_locations);
+        return *this;
+    }
     void to_feature_map(float* const data) const
     {
         constexpr uint sp_types = num_stand_piece_types;
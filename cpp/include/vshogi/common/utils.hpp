@@ -3,7 +3,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <vector>
 
@@ -57,21 +59,82 @@ private:
     }
 };
 
-inline void softmax(std::vector<float>& logits)
+/**
+ * @brief Return `std::exp(x)` for non-positive `x` within a few ULPs.
+ * @details Unlike `std::exp()`, this has no branches nor calls, so that the
+ * compiler vectorizes loops calling it. Values below -87 are regarded as -87.
+ */
+inline float exp_nonpositive(float x)
 {
-    if (logits.empty())
+    constexpr float log2e = 1.44269504f;
+    constexpr float ln2_hi = 0.693145752f;
+    constexpr float ln2_lo = 1.42860677e-6f;
+    constexpr float round_magic = 12582912.f; // 1.5 * 2^23
+
+    // Clamp by comparing bits, which orders non-positive floats reversely,
+    // because compilers do not vectorize comparisons of floats that may trap.
+    constexpr std::uint32_t lower_bound_bits = 0xc2ae0000u; // -87.f
+    std::uint32_t x_bits;
+    std::memcpy(&x_bits, &x, sizeof(x_bits));
+    x_bits = (x_bits > lower_bound_bits) ? lower_bound_bits : x_bits;
+    std::memcpy(&x, &x_bits, sizeof(x));
+
+    // exp(x) = 2^n * exp(r) where n = round(x / ln2) and |r| <= ln2 / 2.
+    const float t = x * log2e + round_magic;
+    const float n = t - round_magic;
+    const float r = (x - n * ln2_hi) - n * ln2_lo;
+    float p = 1.f / 720.f;
+    p = p * r + 1.f / 120.f;
+    p = p * r + 1.f / 24.f;
+    p = p * r + 1.f / 6.f;
+    p = p * r + 0.5f;
+    p = p * r + 1.f;
+    p = p * r + 1.f;
+
+    std::int32_t t_bits;
+    std::memcpy(&t_bits, &t, sizeof(t_bits));
+    std::int32_t magic_bits;
+    std::memcpy(&magic_bits, &round_magic, sizeof(magic_bits));
+    const std::int32_t scale_bits = (t_bits - magic_bits + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &scale_bits, sizeof(scale));
+    return p * scale;
+}
+
+/**
+ * @brief Apply softmax function to `n` logits in place.
+ */
+inline void softmax(float* const logits, const std::size_t n)
+{
+    if (n == 0u)
         return;
-    const float maximum_value
-        = *std::max_element(logits.cbegin(), logits.cend());
-    float sum = 0.f;
-    for (auto&& e : logits) {
-        e -= maximum_value;
-        e = std::exp(e);
-        sum += e;
-    }
-    for (auto&& e : logits) {
-        e /= sum;
+    float maximum_value = logits[0];
+    for (std::size_t ii = 1u; ii < n; ++ii)
+        maximum_value = std::max(maximum_value, logits[ii]);
+    for (std::size_t ii = 0u; ii < n; ++ii)
+        logits[ii] = exp_nonpositive(logits[ii] - maximum_value);
+
+    // Sum in separate lanes, which the compiler may not reorder by itself.
+    constexpr std::size_t num_lanes = 8u;
+    float lanes[num_lanes] = {};
+    std::size_t ii = 0u;
+    for (; ii + num_lanes <= n; ii += num_lanes) {
+        for (std::size_t jj = 0u; jj < num_lanes; ++jj)
+            lanes[jj] += logits[ii + jj];
     }
+    float sum = 0.f;
+    for (; ii < n; ++ii)
+        sum += logits[ii];
+    for (std::size_t jj = 0u; jj < num_lanes; ++jj)
+        sum += lanes[jj];
+
+    const float inv_sum = 1.f / sum;
+    for (ii = 0u; ii < n; ++ii)
+        logits[ii] *= inv_sum;
+}
+inline void softmax(std::vector<float>& logits)
+{
+    softmax(logits.data(), logits.size());
 }
 
 constexpr uint get_msb(uint x)
@@ -0,0 +1,336 @@
+#ifndef VSHOGI_ENGINE_ARENA_HPP
+#define VSHOGI_ENGINE_ARENA_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "vshogi/engine/spin_lock.hpp"
+
+namespace vshogi::engine
+{
+
+/**
+ * @brief Slab allocator of objects and arrays of a single type.
+ * @details Objects are carved out of fixed-size slabs which are kept until the
+ * arena itself is destroyed. Released arrays are recycled through free lists,
+ * one for each length. An array is taken from the shortest free one long
+ * enough, whose rest goes back to the free lists, and adjacent free arrays
+ * are merged before a new slab is added, so that arrays of varying lengths
+ * reuse each other's memory rather than new slabs. `reset()` drops
+ * every object at once without touching them, so that the slabs are reused by
+ * the following allocations. Allocation and release are thread-safe.
+ *
+ * An object is also referred to by its 32-bit index, which is half the size
+ * of a pointer, e.g. to keep references in large arrays compact. Indices are
+ * converted back to pointers without locking, as slabs never move.
+ *
+ * @tparam T Type of objects to allocate. It has to be trivially destructible
+ * because destructors are never called.
+ * @tparam SlabSize Number of objects in one slab.
+ */
+template <class T, std::size_t SlabSize = 4096u>
+class Arena
+{
+    static_assert(std::is_trivially_destructible<T>::value);
+    static_assert(SlabSize > 0u);
+
+private:
+    /**
+     * @brief Number of entries of each level of the table of slabs.
+     */
+    static constexpr std::size_t table_size = 256u;
+
+    /**
+     * @brief Two-level table of slabs, whose entries are never moved once
+     * created so that `at()` reads them without locking.
+     */
+    std::unique_ptr<std::unique_ptr<T[]>[]> m_slabs[table_size];
+
+    std::size_t m_num_slabs;
+
+    /**
+     * @brief Addresses of the slabs paired with their indices, sorted by the
+     * addresses, to find the slab an object belongs to.
+     */
+    std::vector<std::pair<std::uintptr_t, std::size_t>> m_slab_addresses;
+
+    /**
+     * @brief Index of the slab objects are currently carved out of.
+     */
+    std::size_t m_slab_index;
+
+    /**
+     * @brief Index of the next unused object in the current slab.
+     */
+    std::size_t m_offset;
+
+    /**
+     * @brief Released arrays indexed by their lengths.
+     */
+    std::vector<std::vector<T*>> m_free_lists;
+
+    /**
+     * @brief Whether no adjacent free arrays are left to merge.
+     */
+    bool m_is_coalesced;
+
+    /**
+     * @brief Number of objects allocated and not released yet. It is updated
+     * while holding the lock, and may be read without it.
+     */
+    std::atomic<std::size_t> m_size;
+
+    mutable SpinLock m_lock;
+
+public:
+    /**
+     * @brief Maximum number of slabs, so that indices of objects fit in 32
+     * bits.
+     */
+    static constexpr std::size_t max_num_slabs = table_size * table_size;
+    static_assert(SlabSize <= (std::size_t{1} << 32) / max_num_slabs);
+
+    Arena()
+        : m_slabs(), m_num_slabs(0u), m_slab_addresses(), m_slab_index(0u),
+          m_offset(0u), m_free_lists(), m_is_coalesced(true), m_size(0u),
+          m_lock()
+    {
+    }
+
+    // Rules of 5
+    ~Arena() = default; // 1/5 destructor
+    Arena(const Arena& other) = delete; // 2/5 copy constructor
+    Arena& operator=(const Arena& other) = delete; // 3/5 copy assignment
+    Arena(Arena&& other) = delete; // 4/5 move constructor
+    Arena& operator=(Arena&& other) = delete; // 5/5 move assignment
+
+    /**
+     * @brief Allocate an object constructed with given arguments.
+     * @note This allocates memory only when all the slabs are in use.
+     */
+    template <class... Args>
+    T* allocate(Args&&... args)
+    {
+        return new (allocate_array(1u)) T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Allocate contiguous objects whose values are unspecified.
+     * @note This allocates memory only when all the slabs are in use.
+     * @throw std::bad_alloc if `max_num_slabs` slabs are all in use.
+     *
+     * @param n Number of the objects, which must not exceed `SlabSize`.
+     * @return T* Pointer to the first object.
+     */
+    T* allocate_array(const std::size_t n)
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        return allocate_array_nolock(n);
+    }
+
+    /**
+     * @brief Allocate contiguous objects like `allocate_array()`, and return
+     * the index of the first object instead of a pointer.
+     */
+    std::uint32_t allocate_array_index(const std::size_t n)
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        return index_of_nolock(allocate_array_nolock(n));
+    }
+
+    /**
+     * @brief Return the index of an object allocated from this arena.
+     */
+    std::uint32_t index_of(const T* const p) const
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        return index_of_nolock(p);
+    }
+
+    /**
+     * @brief Return the object of an index returned by `index_of()` or
+     * `allocate_array_index()`.
+     * @note This does not lock the arena. The index has to be obtained
+     * through a synchronization with the thread allocating the object, e.g.
+     * read while holding a lock under which it was written.
+     */
+    T* at(const std::uint32_t index) const
+    {
+        return slab(index / SlabSize) + index % SlabSize;
+    }
+
+    /**
+     * @brief Return an object to the arena so that it is reused later.
+     */
+    void release(T* const p)
+    {
+        release_array(p, 1u);
+    }
+
+    /**
+     * @brief Return contiguous objects to the arena so that they are reused
+     * later.
+     *
+     * @param p Pointer returned by `allocate_array()`.
+     * @param n Number of the objects given to `allocate_array()`.
+     */
+    void release_array(T* const p, const std::size_t n)
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        push_free(p, n);
+        m_is_coalesced = false;
+        m_size.fetch_sub(n, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Drop all the objects allocated so far in O(1).
+     * @note Pointers to the objects are invalidated.
+     */
+    void reset()
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        m_slab_index = 0u;
+        m_offset = 0u;
+        for (auto&& free_list : m_free_lists)
+            free_list.clear();
+        m_is_coalesced = true;
+        m_size.store(0u, std::memory_order_relaxed);
+    }
+    std::size_t size() const
+    {
+        return m_size.load(std::memory_order_relaxed);
+    }
+    std::size_t capacity() const
+    {
+        return m_num_slabs * SlabSize;
+    }
+
+private:
+    T* allocate_array_nolock(const std::size_t n)
+    {
+        T* out = pop_free(n);
+        if (out != nullptr)
+            return out;
+        if (m_offset + n > SlabSize) {
+            // The rest of the slab is left for shorter arrays.
+            if ((m_offset < SlabSize) && (m_slab_index < m_num_slabs)) {
+                push_free(slab(m_slab_index) + m_offset, SlabSize - m_offset);
+                m_is_coalesced = false;
+            }
+            ++m_slab_index;
+            m_offset = 0u;
+        }
+        if (m_slab_index == m_num_slabs) {
+            if (!m_is_coalesced) {
+                coalesce();
+                out = pop_free(n);
+                if (out != nullptr)
+                    return out;
+            }
+            add_slab();
+        }
+        out = slab(m_slab_index) + m_offset;
+        m_offset += n;
+        m_size.fetch_add(n, std::memory_order_relaxed);
+        return out;
+    }
+
+    /**
+     * @brief Take `n` objects from the shortest free array long enough,
+     * returning the rest of it to the free lists.
+     */
+    T* pop_free(const std::size_t n)
+    {
+        for (std::size_t length = n; length < m_free_lists.size(); ++length) {
+            if (m_free_lists[length].empty())
+                continue;
+            T* const out = m_free_lists[length].back();
+            m_free_lists[length].pop_back();
+            if (length > n)
+                push_free(out + n, length - n);
+            m_size.fetch_add(n, std::memory_order_relaxed);
+            return out;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Merge free arrays adjacent to each other in the same slab.
+     */
+    void coalesce()
+    {
+        std::vector<std::pair<std::uintptr_t, std::size_t>> arrays;
+        for (std::size_t length = 0u; length < m_free_lists.size(); ++length) {
+            for (const T* const p : m_free_lists[length])
+                arrays.emplace_back(
+                    reinterpret_cast<std::uintptr_t>(p), length);
+            m_free_lists[length].clear();
+        }
+        std::sort(arrays.begin(), arrays.end());
+        std::size_t num = 0u;
+        for (const auto& a : arrays) {
+            const T* const p = reinterpret_cast<const T*>(a.first);
+            if ((num > 0u)
+                && (arrays[num - 1u].first + arrays[num - 1u].second * sizeof(T)
+                    == a.first)
+                && (index_of_nolock(p) % SlabSize != 0u)) // In the same slab.
+                arrays[num - 1u].second += a.second;
+            else
+                arrays[num++] = a;
+        }
+        for (std::size_t ii = 0u; ii < num; ++ii)
+            push_free(
+                reinterpret_cast<T*>(arrays[ii].first), arrays[ii].second);
+        m_is_coalesced = true;
+    }
+    void push_free(T* const p, const std::size_t n)
+    {
+        if (m_free_lists.size() <= n)
+            m_free_lists.resize(n + 1u);
+        m_free_lists[n].emplace_back(p);
+    }
+    void add_slab()
+    {
+        if (m_num_slabs == max_num_slabs)
+            throw std::bad_alloc();
+        auto& chunk = m_slabs[m_num_slabs / table_size];
+        if (chunk == nullptr)
+            chunk = std::make_unique<std::unique_ptr<T[]>[]>(table_size);
+        chunk[m_num_slabs % table_size] = std::make_unique<T[]>(SlabSize);
+        const auto entry = std::make_pair(
+            reinterpret_cast<std::uintptr_t>(slab(m_num_slabs)), m_num_slabs);
+        m_slab_addresses.insert(
+            std::upper_bound(
+                m_slab_addresses.begin(), m_slab_addresses.end(), entry),
+            entry);
+        ++m_num_slabs;
+    }
+    T* slab(const std::size_t index) const
+    {
+        return m_slabs[index / table_size][index % table_size].get();
+    }
+    std::uint32_t index_of_nolock(const T* const p) const
+    {
+        // The last slab whose address is not greater than `p`.
+        const auto it = std::upper_bound(
+            m_slab_addresses.cbegin(),
+            m_slab_addresses.cend(),
+            std::make_pair(reinterpret_cast<std::uintptr_t>(p), max_num_slabs));
+        const std::size_t index = std::prev(it)->second;
+        return static_cast<std::uint32_t>(
+            index * SlabSize + static_cast<std::size_t>(p - slab(index)));
+    }
+};
+
+} // namespace vshogi::engine
+
+#endif // VSHOGI_ENGINE_ARENA_HPP
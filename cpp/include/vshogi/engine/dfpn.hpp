@@ -10,6 +10,7 @@
 #include "vshogi/common/color.hpp"
 #include "vshogi/common/result.hpp"
 #include "vshogi/common/utils.hpp"
+#include "vshogi/engine/time_manager.hpp"
 #include "vshogi/variants/animal_shogi.hpp"
 
 /**
@@ -33,6 +34,17 @@
 namespace vshogi::engine::dfpn
 {
 
+/**
+ * @brief Statistics of DFPN search accumulated by a searcher.
+ */
+struct Stats
+{
+    std::uint64_t num_explorations; //!< Leaves selected and expanded.
+    std::uint64_t num_nodes_created;
+    std::uint64_t num_cache_lookups; //!< Lookups of the mate cache.
+    std::uint64_t num_cache_hits;
+};
+
 template <class Game, class Move>
 class Node
 {
@@ -95,13 +107,16 @@ public:
         m_game->clear_records_for_dfpn();
         simulate_expand_backprop();
     }
-    Node(const Game& g, std::unordered_map<std::uint64_t, bool>& mate_cache)
+    Node(
+        const Game& g,
+        std::unordered_map<std::uint64_t, bool>& mate_cache,
+        Stats& stats)
         : m_attacker(true), m_parent(nullptr), m_action(),
           m_game(std::make_unique<Game>(Game(g))), m_sibling(nullptr),
           m_child(nullptr), m_pn(unit), m_dn(unit)
     {
         m_game->clear_records_for_dfpn();
-        simulate_expand_backprop(mate_cache);
+        simulate_expand_backprop(mate_cache, stats);
     }
     Node(const bool attacker, Node* const parent, const Move& action)
         : m_attacker(attacker), m_parent(parent), m_action(action),
@@ -184,12 +199,13 @@ public:
         n->simulate_expand_backprop();
     }
     void select_simulate_expand_backprop(
-        std::unordered_map<std::uint64_t, bool>& mate_cache)
+        std::unordered_map<std::uint64_t, bool>& mate_cache, Stats& stats)
     {
         Node* n = this;
         while (n->m_child != nullptr)
             n = n->select();
-        n->simulate_expand_backprop(mate_cache);
+        ++stats.num_explorations;
+        n->simulate_expand_backprop(mate_cache, stats);
     }
 
 private:
@@ -205,12 +221,12 @@ private:
         backprop();
     }
     void simulate_expand_backprop(
-        std::unordered_map<std::uint64_t, bool>& mate_cache)
+        std::unordered_map<std::uint64_t, bool>& mate_cache, Stats& stats)
     {
         const Game& game = *m_game;
         const auto r = game.get_result();
         if (r == ONGOING) {
-            expand(game, mate_cache);
+            expand(game, mate_cache, stats);
         } else {
             simulate(game);
         }
@@ -366,12 +382,15 @@ private:
         Node* const ch,
         const Game& g,
         const Move m,
-        std::unordered_map<std::uint64_t, bool>& mate_cache)
+        std::unordered_map<std::uint64_t, bool>& mate_cache,
+        Stats& stats)
     {
         const std::uint64_t zobrist_hash = g.get_zobrist_hash();
         const std::uint64_t hash
             = zobrist_hash ^ static_cast<std::uint64_t>(m.hash());
+        ++stats.num_cache_lookups;
         if (auto it = mate_cache.find(hash); it != mate_cache.end()) {
+            ++stats.num_cache_hits;
             if (it->second) {
                 ch->m_pn = cent;
                 ch->m_dn = 10000 * unit;
@@ -390,7 +409,9 @@ private:
     }
 
     void expand(
-        const Game& game, std::unordered_map<std::uint64_t, bool>& mate_cache)
+        const Game& game,
+        std::unordered_map<std::uint64_t, bool>& mate_cache,
+        Stats& stats)
     {
         const std::vector<Move>& legal_moves = game.get_legal_moves();
         std::unique_ptr<Node>* ch = &m_child;
@@ -405,13 +426,15 @@ private:
                     && (!game.template is_check_move<false>(m)))
                     continue;
                 *ch = std::make_unique<Node>(!m_attacker, this, m);
+                ++stats.num_nodes_created;
                 modify_pndn_by_attacks(ch->get(), game, m, is_attacked_cache);
-                modify_pndn_by_mate(ch->get(), game, m, mate_cache);
+                modify_pndn_by_mate(ch->get(), game, m, mate_cache, stats);
                 ch = &ch->get()->m_sibling;
             }
         } else {
             for (auto&& m : legal_moves) {
                 *ch = std::make_unique<Node>(!m_attacker, this, m);
+                ++stats.num_nodes_created;
                 modify_pndn_by_defence(ch->get(), game, m);
                 modify_pndn_if_parent_is_almost_mate(ch->get());
                 ch = &ch->get()->m_sibling;
@@ -538,9 +561,12 @@ private:
      */
     std::unordered_map<std::uint64_t, bool> m_mate_cache_for_white;
 
+    Stats m_stats;
+
 public:
     Searcher()
-        : m_root(nullptr), m_mate_cache_for_black{}, m_mate_cache_for_white{}
+        : m_root(nullptr), m_mate_cache_for_black{}, m_mate_cache_for_white{},
+          m_stats{}
     {
     }
 
@@ -552,7 +578,8 @@ public:
     {
         auto& cache = (g.get_turn() == vshogi::BLACK) ? m_mate_cache_for_black
                                                       : m_mate_cache_for_white;
-        m_root = std::make_unique<Node<Game, Move>>(g, cache);
+        m_root = std::make_unique<Node<Game, Move>>(g, cache, m_stats);
+        ++m_stats.num_nodes_created;
     }
 
     /**
@@ -571,7 +598,29 @@ public:
         for (; n--;) {
             if (root->found_conclusion())
                 break;
-            root->select_simulate_expand_backprop(cache);
+            root->select_simulate_expand_backprop(cache, m_stats);
+        }
+        return root->found_mate();
+    }
+
+    /**
+     * @brief Explore mate moves at given game state until `time_manager` tells
+     * the time is up.
+     *
+     * @param time_manager Time manager started for this exploration.
+     * @return true Found mate moves.
+     * @return false No mate moves found which may be found by further explorations.
+     */
+    bool explore(TimeManager& time_manager)
+    {
+        Node<Game, Move>* const root = m_root.get();
+        auto& cache = (root->get_turn() == vshogi::BLACK)
+                          ? m_mate_cache_for_black
+                          : m_mate_cache_for_white;
+        for (std::uint64_t n = 0u; !time_manager.is_time_up(n); ++n) {
+            if (root->found_conclusion())
+                break;
+            root->select_simulate_expand_backprop(cache, m_stats);
         }
         return root->found_mate();
     }
@@ -595,6 +644,10 @@ public:
     {
         return m_root->get_mate_moves();
     }
+    const Stats& get_stats() const
+    {
+        return m_stats;
+    }
 };
 
 } // namespace vshogi::engine::dfpn
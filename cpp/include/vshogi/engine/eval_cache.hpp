@@ -0,0 +1,168 @@
+#ifndef VSHOGI_ENGINE_EVAL_CACHE_HPP
+#define VSHOGI_ENGINE_EVAL_CACHE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "vshogi/engine/half.hpp"
+#include "vshogi/engine/spin_lock.hpp"
+
+namespace vshogi::engine
+{
+
+/**
+ * @brief Bounded cache of evaluations of game positions keyed by their
+ * Zobrist hashes.
+ * @details Each slot keeps the value of a game position and the prior
+ * probabilities of its legal moves in half precision. A position is stored
+ * in the slot indexed by its hash, replacing whatever was there, so that the
+ * memory stays bounded without bookkeeping of recency. Lookups and stores are
+ * thread-safe, so that a cache may be shared by searchers of different games,
+ * e.g. of self-play, as well as by search threads of one tree.
+ */
+class EvalCache
+{
+private:
+    struct Slot
+    {
+        std::uint64_t key;
+        float value;
+        bool is_occupied;
+        std::vector<std::uint16_t> probas;
+    };
+
+    /**
+     * @brief Number of locks the slots are striped over.
+     */
+    static constexpr std::size_t num_locks = 64u;
+
+    std::vector<Slot> m_slots;
+    SpinLock m_locks[num_locks];
+    std::atomic<std::uint64_t> m_num_lookups;
+    std::atomic<std::uint64_t> m_num_hits;
+
+public:
+    /**
+     * @param capacity Number of game positions to keep at most.
+     */
+    explicit EvalCache(const std::size_t capacity)
+        : m_slots(std::max(capacity, std::size_t{1}), Slot{0u, 0.f, false, {}}),
+          m_locks(), m_num_lookups(0u), m_num_hits(0u)
+    {
+    }
+
+    // Rules of 5
+    ~EvalCache() = default; // 1/5 destructor
+    EvalCache(const EvalCache& other) = delete; // 2/5 copy constructor
+    EvalCache& operator=(const EvalCache& other) = delete; // 3/5 copy assign
+    EvalCache(EvalCache&& other) = delete; // 4/5 move constructor
+    EvalCache& operator=(EvalCache&& other) = delete; // 5/5 move assignment
+
+    /**
+     * @brief Look up the evaluation of a game position.
+     *
+     * @param key Zobrist hash of the game position.
+     * @param [out] value Value of the game position.
+     * @param [out] probas Prior probabilities of the legal moves, in the order
+     * they were stored.
+     * @return true If the game position is found.
+     */
+    bool lookup(
+        const std::uint64_t key, float& value, std::vector<float>& probas)
+    {
+        m_num_lookups.fetch_add(1u, std::memory_order_relaxed);
+        const std::size_t index = index_of(key);
+        {
+            std::lock_guard<SpinLock> lock(m_locks[index % num_locks]);
+            const Slot& slot = m_slots[index];
+            if ((!slot.is_occupied) || (slot.key != key))
+                return false;
+            value = slot.value;
+            probas.resize(slot.probas.size());
+            std::transform(
+                slot.probas.cbegin(),
+                slot.probas.cend(),
+                probas.begin(),
+                from_half);
+        }
+        m_num_hits.fetch_add(1u, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Store the evaluation of a game position.
+     *
+     * @param key Zobrist hash of the game position.
+     * @param value Value of the game position.
+     * @param probas Prior probabilities of the `num` legal moves.
+     * @param num Number of the legal moves.
+     */
+    void store(
+        const std::uint64_t key,
+        const float value,
+        const float* const probas,
+        const std::size_t num)
+    {
+        const std::size_t index = index_of(key);
+        std::lock_guard<SpinLock> lock(m_locks[index % num_locks]);
+        Slot& slot = m_slots[index];
+        slot.key = key;
+        slot.value = value;
+        slot.is_occupied = true;
+        slot.probas.resize(num);
+        std::transform(probas, probas + num, slot.probas.begin(), to_half);
+    }
+
+    /**
+     * @brief Remove all the game positions and reset the statistics.
+     * @note This must not be called while other threads use the cache.
+     */
+    void clear()
+    {
+        for (auto& slot : m_slots) {
+            slot.is_occupied = false;
+            slot.probas.clear();
+        }
+        m_num_lookups.store(0u, std::memory_order_relaxed);
+        m_num_hits.store(0u, std::memory_order_relaxed);
+    }
+
+    std::size_t get_capacity() const
+    {
+        return m_slots.size();
+    }
+    std::uint64_t get_num_lookups() const
+    {
+        return m_num_lookups.load(std::memory_order_relaxed);
+    }
+    std::uint64_t get_num_hits() const
+    {
+        return m_num_hits.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Ratio of lookups finding their game positions, or zero if there
+     * are no lookups.
+     */
+    double get_hit_rate() const
+    {
+        const auto n = get_num_lookups();
+        if (n == 0u)
+            return 0.;
+        return static_cast<double>(get_num_hits()) / static_cast<double>(n);
+    }
+
+private:
+    std::size_t index_of(const std::uint64_t key) const
+    {
+        return static_cast<std::size_t>(key % m_slots.size());
+    }
+};
+
+} // namespace vshogi::engine
+
+#endif // VSHOGI_ENGINE_EVAL_CACHE_HPP
@@ -0,0 +1,157 @@
+#ifndef VSHOGI_ENGINE_GUMBEL_HPP
+#define VSHOGI_ENGINE_GUMBEL_HPP
+
+#include <algorithm>
+#include <cmath>
+
+#include "vshogi/common/utils.hpp"
+#include "vshogi/engine/random.hpp"
+
+namespace vshogi::engine::mcts
+{
+
+/**
+ * @brief Parameters of Gumbel search at the root, which samples actions
+ * without replacement by Gumbel-top-k trick and narrows them down by
+ * sequential halving.
+ * @note Danihelka et al., "Policy improvement by planning with Gumbel", ICLR
+ * 2022. https://openreview.net/forum?id=bERaNdoegnO
+ */
+struct GumbelParams
+{
+    /**
+     * @brief Maximum number of actions sampled at the root.
+     */
+    uint num_sampled = 16u;
+
+    /**
+     * @brief Scale of Gumbel noise. Zero samples actions of the highest
+     * prior probabilities deterministically, e.g. for evaluation games.
+     */
+    float gumbel_scale = 1.f;
+
+    /**
+     * @brief Coefficients of `sigma(q) = (c_visit + max_visit_count) * c_scale
+     * * q` turning Q-values in [0, 1] into the scale of logits.
+     */
+    float c_visit = 50.f;
+    float c_scale = 0.1f;
+};
+
+/**
+ * @brief Sample from the standard Gumbel distribution.
+ */
+inline float sample_gumbel(Random& random)
+{
+    // Uniform in (0, 1) so that both logarithms are finite.
+    const float u = (static_cast<float>(random() >> 8) + 0.5f) * 0x1.0p-24f;
+    return -std::log(-std::log(u));
+}
+
+/**
+ * @brief Logarithm of a prior probability, bounded so that a probability of
+ * zero, e.g. underflowed in half precision, gives a finite logit.
+ */
+inline float gumbel_logit(const float proba)
+{
+    constexpr float min_proba = 1e-8f;
+    return std::log(std::max(proba, min_proba));
+}
+
+/**
+ * @brief Transform of Q-values in [0, 1] into the scale of logits.
+ *
+ * @param q Q-value in [0, 1].
+ * @param max_visit_count Max visit count of the children of the root.
+ */
+inline float gumbel_sigma(
+    const float q, const int max_visit_count, const GumbelParams& params)
+{
+    const auto n = static_cast<float>(max_visit_count);
+    return (params.c_visit + n) * params.c_scale * q;
+}
+
+/**
+ * @brief Number of phases of sequential halving to narrow `num_sampled`
+ * actions down to one, which is `ceil(log2(num_sampled))`.
+ */
+inline uint num_halving_phases(const uint num_sampled)
+{
+    uint out = 0u;
+    for (uint m = num_sampled; m > 1u; m = (m + 1u) / 2u)
+        ++out;
+    return out;
+}
+
+/**
+ * @brief Complete Q-values of children from the parent's point of view,
+ * rescaled from [-1, 1] into [0, 1].
+ * @details Unvisited children get the mixed value, an estimate of the value of
+ * the parent interpolating its own evaluation and the Q-values of the visited
+ * children weighted by their prior probabilities.
+ *
+ * @param [in] probas Prior probabilities of the children.
+ * @param [in] visit_counts Visit counts of the children.
+ * @param [in] q_values Q-values of the children from their point of view.
+ * @param [in] size Number of the children.
+ * @param [in] value Value of the parent from its point of view.
+ * @param [out] out Completed Q-values of the children.
+ */
+inline void complete_q_values(
+    const float* const probas,
+    const int* const visit_counts,
+    const float* const q_values,
+    const uint size,
+    const float value,
+    float* const out)
+{
+    float sum_visits = 0.f;
+    float sum_probas = 0.f;
+    float sum_weighted_q = 0.f;
+    for (uint ii = 0u; ii < size; ++ii) {
+        if (visit_counts[ii] <= 0)
+            continue;
+        sum_visits += static_cast<float>(visit_counts[ii]);
+        sum_probas += probas[ii];
+        sum_weighted_q -= probas[ii] * q_values[ii];
+    }
+    float mixed = value;
+    if (sum_probas > 0.f)
+        mixed = (value + sum_visits * sum_weighted_q / sum_probas)
+                / (1.f + sum_visits);
+    for (uint ii = 0u; ii < size; ++ii) {
+        const float q = (visit_counts[ii] > 0) ? -q_values[ii] : mixed;
+        out[ii] = std::clamp(0.5f * (q + 1.f), 0.f, 1.f);
+    }
+}
+
+/**
+ * @brief Improved policy `softmax(logit + sigma(completed_q))` of children,
+ * which is a training target of the policy better than visit distribution
+ * for small numbers of visits.
+ * @note See `complete_q_values()` for the parameters.
+ *
+ * @param [out] out Probabilities of the children.
+ */
+inline void improved_policy(
+    const float* const probas,
+    const int* const visit_counts,
+    const float* const q_values,
+    const uint size,
+    const float value,
+    const GumbelParams& params,
+    float* const out)
+{
+    complete_q_values(probas, visit_counts, q_values, size, value, out);
+    int max_visit_count = 0;
+    for (uint ii = 0u; ii < size; ++ii)
+        max_visit_count = std::max(max_visit_count, visit_counts[ii]);
+    for (uint ii = 0u; ii < size; ++ii)
+        out[ii] = gumbel_logit(probas[ii])
+                  + gumbel_sigma(out[ii], max_visit_count, params);
+    softmax(out, size);
+}
+
+} // namespace vshogi::engine::mcts
+
+#endif // VSHOGI_ENGINE_GUMBEL_HPP
@@ -0,0 +1,74 @@
+#ifndef VSHOGI_ENGINE_HALF_HPP
+#define VSHOGI_ENGINE_HALF_HPP
+
+#include <cstdint>
+#include <cstring>
+
+namespace vshogi::engine
+{
+
+/**
+ * @brief Convert a float to IEEE 754 half precision, rounding to nearest
+ * with ties to even.
+ */
+inline std::uint16_t to_half(const float f)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &f, 4u);
+    const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+    const int exponent = static_cast<int>((bits >> 23) & 0xffu);
+    std::uint32_t mantissa = bits & 0x7fffffu;
+
+    if (exponent == 0xff) // Infinity or NaN.
+        return static_cast<std::uint16_t>(
+            sign | 0x7c00u | ((mantissa != 0u) ? 0x200u : 0u));
+    const int e = exponent - 127 + 15;
+    if (e >= 0x1f) // Overflow to infinity.
+        return static_cast<std::uint16_t>(sign | 0x7c00u);
+    if (e <= 0) { // Subnormal, or underflow to zero.
+        if (e < -10)
+            return sign;
+        mantissa |= 0x800000u;
+        const auto shift = static_cast<std::uint32_t>(14 - e);
+        std::uint32_t half = mantissa >> shift;
+        const std::uint32_t rest = mantissa & ((1u << shift) - 1u);
+        const std::uint32_t tie = 1u << (shift - 1u);
+        if ((rest > tie) || ((rest == tie) && (half & 1u)))
+            ++half;
+        return static_cast<std::uint16_t>(sign | half);
+    }
+    // Carry of the rounding may overflow into the exponent as expected.
+    std::uint32_t half = (static_cast<std::uint32_t>(e) << 10)
+                         | (mantissa >> 13);
+    const std::uint32_t rest = mantissa & 0x1fffu;
+    if ((rest > 0x1000u) || ((rest == 0x1000u) && (half & 1u)))
+        ++half;
+    return static_cast<std::uint16_t>(sign | half);
+}
+
+/**
+ * @brief Convert IEEE 754 half precision to a float.
+ */
+inline float from_half(const std::uint16_t h)
+{
+    const auto sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+    const std::uint32_t exponent = (h >> 10) & 0x1fu;
+    const std::uint32_t mantissa = h & 0x3ffu;
+
+    std::uint32_t bits;
+    if (exponent == 0u) { // Zero or subnormal.
+        const float f = static_cast<float>(mantissa) * 0x1.0p-24f;
+        return (sign != 0u) ? -f : f;
+    } else if (exponent == 0x1fu) { // Infinity or NaN.
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    }
+    float out;
+    std::memcpy(&out, &bits, 4u);
+    return out;
+}
+
+} // namespace vshogi::engine
+
+#endif // VSHOGI_ENGINE_HALF_HPP
@@ -2,636 +2,2639 @@
 #define VSHOGI_ENGINE_MCTS_HPP
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
-#include <random>
+#include <mutex>
+#include <new>
+#include <numeric>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "vshogi/common/color.hpp"
 #include "vshogi/common/result.hpp"
 #include "vshogi/common/utils.hpp"
+#include "vshogi/engine/arena.hpp"
 #include "vshogi/engine/dfpn.hpp"
+#include "vshogi/engine/eval_cache.hpp"
+#include "vshogi/engine/gumbel.hpp"
+#include "vshogi/engine/node_layout.hpp"
+#include "vshogi/engine/puct.hpp"
+#include "vshogi/engine/random.hpp"
+#include "vshogi/engine/root_stats.hpp"
+#include "vshogi/engine/search_stats.hpp"
+#include "vshogi/engine/spin_lock.hpp"
+#include "vshogi/engine/time_manager.hpp"
 
 namespace vshogi::engine::mcts
 {
 
-static std::random_device seed_gen;
-static std::default_random_engine engine(seed_gen());
-static std::uniform_real_distribution<float> dist(0.f, 1.f);
-
-template <class Game, class Move>
+template <class Game, class Move, class Layout = DefaultLayout>
 class Searcher;
 
-template <class Game, class Move>
-class Node
+template <class Game, class Move, class Layout = DefaultLayout>
+class Node;
+
+template <class Game, class Move, class Layout = DefaultLayout>
+class Children;
+
+/**
+ * @brief Child nodes of a node stored in structure-of-arrays layout.
+ * @details A block consists of a header followed by arrays, each of which
+ * starts at a cache line boundary.
+ * - `probas`, `visit_counts`, `q_values`, `is_mate`, `virtual_losses` used to
+ * select a child
+ * - `visit_counts_excluding_random`, `actions`
+ * - `nodes` referring to the rest of the child nodes, which refer to their
+ * own statistics by their index in the block.
+ *
+ * Selecting a child is therefore a linear scan over a few contiguous arrays,
+ * and a child is accessed in O(1) by its index. A child node itself is
+ * allocated only when it is accessed first, e.g. selected, because most of
+ * the children are never visited. Nodes are stored in lines of their own,
+ * which start with a pointer to the block the nodes belong to. In the compact
+ * layout, two siblings of indices `2k` and `2k + 1` share a line.
+ *
+ * Children are sorted in descending order of their prior probabilities.
+ * Since the PUCT score of an unvisited child only grows with its prior
+ * probability, the first child after the last one ever selected scores the
+ * highest among the rest, and the scan stops there. This cuts the scan short
+ * in positions with many legal moves, e.g. of many drops.
+ *
+ * @tparam Layout Types of the arrays, e.g. `FullLayout` or `CompactLayout`.
+ */
+template <class Game, class Move, class Layout>
+class Children
 {
-private:
-    using NodeGM = Node<Game, Move>;
+public:
+    struct alignas(64) Line
+    {
+        unsigned char bytes[64];
+    };
+    using ArenaType = Arena<Line, 16384u>;
+
+    using Proba = typename Layout::Proba;
+    using VirtualLoss = typename Layout::VirtualLoss;
 
     /**
-     * @brief Pointer to parent node.
-     *
+     * @brief Reference to a block, which is null if there is no block. In the
+     * compact layout, it is the index of the block in the arena plus one, so
+     * that zero is null.
      */
-    NodeGM* m_parent;
+    using Ref
+        = std::conditional_t<Layout::is_compact, std::uint32_t, Children*>;
+
+private:
+    using NodeGM = Node<Game, Move, Layout>;
 
     /**
-     * @brief Pointer to sibling node.
-     * @ref https://blog.mozilla.org/nnethercote/2012/03/07/n-ary-trees-in-c/
+     * @brief Word of mate flags, which packs the flags of 64 children in the
+     * compact layout.
      */
-    std::unique_ptr<NodeGM> m_sibling;
+    using MateFlags
+        = std::conditional_t<Layout::is_compact, std::uint64_t, bool>;
 
     /**
-     * @brief Pointer to first child node.
-     * @ref https://blog.mozilla.org/nnethercote/2012/03/07/n-ary-trees-in-c/
+     * @brief Reference to a child node, which is null if the child is not
+     * allocated yet. In the compact layout, it is the index of the line of the
+     * child in the arena times `nodes_per_line`, plus the position of the
+     * child in the line, plus one, so that zero is null.
      */
-    std::unique_ptr<NodeGM> m_child;
+    using NodeRef
+        = std::conditional_t<Layout::is_compact, std::uint32_t, NodeGM*>;
+
+    static constexpr std::size_t line_size = sizeof(Line);
 
     /**
-     * @brief Action to perform to get to this node from parent node.
-     *
+     * @brief Number of nodes stored in a line.
      */
-    Move m_action;
+    static constexpr uint nodes_per_line = Layout::is_compact ? 2u : 1u;
 
     /**
-     * @brief Probability to perform the action at the parent node.
-     *
+     * @brief Bytes at the beginning of a line of nodes, which hold a pointer
+     * to the block the nodes belong to.
      */
-    float m_proba;
+    static constexpr std::size_t node_line_header = sizeof(Children*);
+    static constexpr uint mate_flags_per_word = Layout::is_compact ? 64u : 1u;
 
     /**
-     * @brief Number of visit to this node in the course of explorations.
-     * @note `backprop` step increments this value.
+     * @brief Capacity of a block is a multiple of this value, so that 4-byte
+     * arrays fill whole cache lines.
      */
-    int m_visit_count;
-
-    int m_visit_count_excluding_random;
+    static constexpr uint granularity = line_size / sizeof(float);
 
     /**
-     * @brief result of `std::sqrt(static_cast<float>(m_visit_count))`.
-     * @details Computing this value beforehand to reduce the computation time
-     * of `u_value_of_puct()` function.
+     * @brief Node whose children are stored in this block.
      */
-    float m_sqrt_visit_count;
+    NodeGM* m_parent;
 
     /**
-     * @brief 1 ~ -1 scaled probability of the turn player winning the game.
-     * @details This is typically a raw estimate of a machine learning model.
-     * If the turn is black, then this value shows winning rate of black.
-     * If the turn is white, then it shows the rate of white. If the value is
-     * out of [-1, 1] range, then it means that there is a winner.
+     * @brief Link to another block used while releasing blocks in bulk.
      */
-    float m_value;
+    Children* m_next;
 
     /**
-     * @brief Average of `m_value` of all the nodes below this including this
-     * one weighted by their `m_visit_count`.
-     * @note `m_q_arctanh = atanh(m_q_value)` does not necessarily hold.
+     * @brief Arena the block is allocated from, which child nodes are also
+     * allocated from.
      */
-    float m_q_value;
+    ArenaType* m_arena;
+
+    uint m_size;
+    uint m_capacity;
 
     /**
-     * @brief True if the node is in mate or leads to mate, otherwise false.
+     * @brief One past the largest index of the children ever selected.
+     * @note It is guarded by the lock of the parent node.
      */
-    bool m_is_mate;
-
-    NodeGM* m_most_visited_child;
+    uint m_selected_end;
 
-    friend class Searcher<Game, Move>;
+    /**
+     * @brief Index of this block in the arena plus one in the compact layout,
+     * or zero.
+     */
+    std::uint32_t m_ref;
 
 public:
-    Node()
-        : m_parent(nullptr), m_sibling(nullptr), m_child(nullptr), m_action(),
-          m_proba(0.f), m_visit_count(0), m_visit_count_excluding_random(0),
-          m_sqrt_visit_count(0.f), m_value(0.f), m_q_value(0.f),
-          m_is_mate(false), m_most_visited_child(nullptr)
-    {
-    }
-    Node(
-        const std::vector<Move>& actions,
-        const ColorEnum& turn,
-        const float value,
-        const float* const policy_logits)
-        : Node()
+    /**
+     * @brief Allocate a block of child nodes from an arena.
+     *
+     * @param arena Arena to allocate the block from.
+     * @param parent Node whose children are stored in the block.
+     * @param size Number of child nodes.
+     * @return Children* Block whose statistics are all zero.
+     */
+    static Children* create(ArenaType& arena, NodeGM* parent, const uint size)
     {
-        m_visit_count = 1;
-        m_visit_count_excluding_random = 1;
-        simulate_expand_and_backprop(actions, turn, value, policy_logits);
+        static_assert(sizeof(Children) <= line_size);
+        const uint capacity
+            = (size + granularity - 1u) / granularity * granularity;
+        Line* lines = nullptr;
+        std::uint32_t ref = 0u;
+        if constexpr (Layout::is_compact) {
+            const std::uint32_t index
+                = arena.allocate_array_index(num_lines(capacity));
+            lines = arena.at(index);
+            ref = index + 1u;
+        } else {
+            lines = arena.allocate_array(num_lines(capacity));
+        }
+        Children* const out
+            = new (lines) Children(arena, parent, size, capacity, ref);
+        std::uninitialized_fill_n(out->probas(), capacity, Proba());
+        std::uninitialized_fill_n(out->visit_counts(), capacity, 0);
+        std::uninitialized_fill_n(out->q_values(), capacity, 0.f);
+        std::uninitialized_fill_n(
+            out->mate_flags(), num_mate_words(capacity), MateFlags());
+        std::uninitialized_fill_n(
+            out->virtual_losses(), capacity, VirtualLoss());
+        std::uninitialized_fill_n(
+            out->visit_counts_excluding_random(), capacity, 0);
+        std::uninitialized_fill_n(out->actions(), capacity, Move());
+        std::uninitialized_fill_n(out->node_refs(), capacity, NodeRef());
+        return out;
     }
-    Node(const Move action, const float proba) noexcept
-        : m_parent(nullptr), m_sibling(nullptr), m_child(nullptr),
-          m_action(action), m_proba(proba), m_visit_count(0),
-          m_visit_count_excluding_random(0), m_sqrt_visit_count(0.f),
-          m_value(0.f), m_q_value(0.f), m_is_mate(false),
-          m_most_visited_child(nullptr)
+
+    /**
+     * @brief Return blocks to the arena together with all the blocks below.
+     * @details Blocks to release are chained through their headers, so that
+     * the whole subtree is released without recursion nor extra memory.
+     *
+     * @param arena Arena the blocks are allocated from.
+     * @param block Block to release.
+     */
+    static void release(ArenaType& arena, Children* block)
     {
+        release(arena, chain(block, nullptr), SIZE_MAX);
     }
 
-    // Rules of 5
-    ~Node() = default; // 1/5 destructor
-    Node(const Node& other) = default; // 2/5 copy constructor
-    Node& operator=(const Node& other) = default; // 3/5 copy assignment
-    Node(Node&& other) = default; // 4/5 move constructor
-    Node& operator=(Node&& other) = default; // 5/5 move assignment
-
-    int get_visit_count() const
+    /**
+     * @brief Prepend a block to a chain of blocks to release later.
+     *
+     * @param block Block to release later.
+     * @param head Head of the chain, or null pointer if empty.
+     * @return Children* New head of the chain.
+     */
+    static Children* chain(Children* const block, Children* const head)
     {
-        return m_visit_count;
+        block->m_next = head;
+        return block;
     }
-    int get_visit_count_excluding_random() const
+
+    /**
+     * @brief Return at most `max_blocks` blocks of a chain to the arena, and
+     * put the blocks below them onto the chain instead.
+     *
+     * @param arena Arena the blocks are allocated from.
+     * @param head Head of the chain of blocks to release.
+     * @param max_blocks Maximum number of blocks to release.
+     * @return Children* Head of the rest of the chain, or null pointer if the
+     * whole chain is released.
+     */
+    static Children*
+    release(ArenaType& arena, Children* head, std::size_t max_blocks)
     {
-        return m_visit_count_excluding_random;
+        for (; (head != nullptr) && (max_blocks > 0u); --max_blocks) {
+            Children* const block = head;
+            head = block->m_next;
+            for (uint ii = block->m_size; ii--;) {
+                NodeGM* const ch = block->find_node(ii);
+                if (ch == nullptr)
+                    continue;
+                Children* const grandchildren = ch->children();
+                if (grandchildren != nullptr) {
+                    grandchildren->m_next = head;
+                    head = grandchildren;
+                }
+                // A line shared by siblings is released with the first one.
+                if ((ii % nodes_per_line == 0u)
+                    || (block->find_node(ii - 1u) == nullptr))
+                    arena.release(line_of(*ch));
+            }
+            arena.release_array(
+                reinterpret_cast<Line*>(block), num_lines(block->m_capacity));
+        }
+        return head;
     }
-    float get_value() const
+
+    NodeGM* parent() const
     {
-        return m_value;
+        return m_parent;
     }
-    float get_q_value(const uint greedy_depth = 0u) const
+    void set_parent(NodeGM* const parent)
     {
-        if ((m_most_visited_child == nullptr) || (greedy_depth == 0u))
-            return m_q_value;
-        else
-            return -m_most_visited_child->get_q_value(greedy_depth - 1u);
+        m_parent = parent;
     }
-    float get_proba() const
+    uint size() const
     {
-        return m_proba;
+        return m_size;
     }
-    Move get_action() const
+
+    /**
+     * @brief Return the reference to a block, or null reference if null.
+     */
+    static Ref ref_of(Children* const block)
     {
-        return m_action;
+        if constexpr (Layout::is_compact)
+            return (block == nullptr) ? 0u : block->m_ref;
+        else
+            return block;
     }
-    uint get_num_child() const
+
+    /**
+     * @brief Return the block of a reference, which is allocated from the
+     * same arena as this block.
+     */
+    Children* deref(const Ref ref) const
     {
-        const NodeGM* ch = m_child.get();
-        uint out = 0u;
-        while (true) {
-            if (ch == nullptr)
-                break;
-            ++out;
-            ch = ch->m_sibling.get();
-        }
-        return out;
+        if constexpr (Layout::is_compact)
+            return (ref == 0u)
+                       ? nullptr
+                       : reinterpret_cast<Children*>(m_arena->at(ref - 1u));
+        else
+            return ref;
     }
-    const Node<Game, Move>* get_child(uint index = 0U) const
+
+    /**
+     * @brief Return the block a node is stored in, from the header of the
+     * line of the node.
+     */
+    static Children* block_of(const NodeGM& node)
     {
-        const Node<Game, Move>* node = m_child.get();
-        for (; index--;) {
-            if (node->m_sibling == nullptr)
-                break;
-            node = node->m_sibling.get();
-        }
-        return node;
+        return *reinterpret_cast<Children* const*>(
+            reinterpret_cast<const unsigned char*>(&node) - node_line_header
+            - (node.m_index % nodes_per_line) * sizeof(NodeGM));
     }
-    const Node<Game, Move>* get_child(const Move& action) const
+
+    /**
+     * @brief Return prior probabilities encoded by `Layout::encode_proba()`.
+     */
+    Proba* probas()
     {
-        const NodeGM* ch = m_child.get();
-        for (; ch != nullptr; ch = ch->m_sibling.get()) {
-            if (ch->m_action == action)
-                return ch;
-        }
-        return nullptr;
+        return column<Proba>(offset_probas());
     }
-    const Node<Game, Move>* get_sibling() const
+    const Proba* probas() const
     {
-        return m_sibling.get();
+        return column<Proba>(offset_probas());
     }
-    const Node<Game, Move>* get_most_visited_child() const
+    float proba(const uint index) const
     {
-        return m_most_visited_child;
+        return Layout::decode_proba(probas()[index]);
     }
 
     /**
-     * @brief Select a leaf node using PUCT algorithm.
-     * @note https://en.wikipedia.org/wiki/Monte_Carlo_tree_search#Principle_of_operation
-     *
-     * @param [in,out] game The game position of the node. After the end, the
-     * position corresponds to the leaf node.
-     * @param [in] coeff_puct Coefficient of PUCT algorithm. Higher the value is,
-     * stronger the exploration is.
-     * @param [in] non_random_ratio Ratio of selecting actions in non-random manner.
-     * `proba_of_random : proba_of_non_random = 1 : non_random_ratio`.
-     * If the value is negative, no random selection.
-     * @param [in] random_depth Depth of nodes to explore in random manner.
-     * e.g. If `random_depth == 2`, `non_random_ratio` takes effect when
-     * selecting child nodes from root node and from nodes beneath the root
-     * node. `non_random_ratio` takes no effect for the nodes further below.
-     * @return Node<Game, Move> Leaf node selected by PUCT algorithm.
-     * If it is game end, then output is null pointer.
+     * @brief Set actions of the children and their prior probabilities, in
+     * descending order of the probabilities keeping the order of ties.
      */
-    Node<Game, Move>* select(
-        Game& game,
-        const float coeff_puct,
-        const int non_random_ratio,
-        int random_depth)
+    void assign(const Move* const actions, const float* const probas)
     {
-        ++m_visit_count;
-        ++m_visit_count_excluding_random;
-        NodeGM* node = this;
-        while (true) {
-            if (node->m_child == nullptr)
-                return node->select_at_leaf(game);
-            node = node->select_at_internal_vertex(
-                game, coeff_puct, non_random_ratio, random_depth--);
+        std::vector<uint> order(m_size);
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(
+            order.begin(), order.end(), [probas](const uint a, const uint b) {
+                return probas[a] > probas[b];
+            });
+        Proba* const dst_probas = this->probas();
+        Move* const dst_actions = this->actions();
+        for (uint ii = 0u; ii < m_size; ++ii) {
+            dst_probas[ii] = Layout::encode_proba(probas[order[ii]]);
+            dst_actions[ii] = actions[order[ii]];
         }
     }
-
-    /**
-     * @note https://en.wikipedia.org/wiki/Monte_Carlo_tree_search#Principle_of_operation
-     *
-     * @param actions
-     * @param turn
-     * @param value
-     * @param policy_logits
-     */
-    void simulate_expand_and_backprop(
-        const std::vector<Move>& actions,
-        const ColorEnum& turn,
-        const float value,
-        const float* const policy_logits)
-    {
-        simulate_ongoing_game(value);
-        expand(actions, turn, policy_logits);
-        backprop_leaf();
-    }
-    void simulate_mate_and_backprop()
+    int* visit_counts()
     {
-        m_value = 1.f;
-        m_q_value = 1.f;
-        m_is_mate = true;
-        backprop_leaf(); // Increment `m_visit_count`.
+        return column<int>(offset_visit_counts());
     }
-    Node<Game, Move>& apply(const Move& action)
+    const int* visit_counts() const
     {
-        NodeGM* ch = m_child.get();
-        for (; ch != nullptr; ch = ch->m_sibling.get()) {
-            if (ch->m_action == action) {
-                m_action = ch->m_action;
-                m_proba = ch->m_proba;
-                m_visit_count = ch->m_visit_count;
-                m_visit_count_excluding_random
-                    = ch->m_visit_count_excluding_random;
-                m_sqrt_visit_count = ch->m_sqrt_visit_count;
-                m_value = ch->m_value;
-                m_q_value = ch->m_q_value;
-                m_is_mate = ch->m_is_mate;
-                m_most_visited_child = ch->m_most_visited_child;
-                m_child = std::move(ch->m_child);
-                return *this;
-            }
-        }
-
-        m_child = nullptr;
-        m_visit_count = 0;
-        m_visit_count_excluding_random = 0;
-        m_sqrt_visit_count = 0.f;
-        m_value = 0.f;
-        m_q_value = 0.f;
-        m_is_mate = false;
-        m_most_visited_child = nullptr;
-        return *this;
+        return column<int>(offset_visit_counts());
     }
-
-private:
-    NodeGM* select_at_leaf(const Game& game)
+    float* q_values()
     {
-        if (game.get_result() == ResultEnum::ONGOING) {
-            return this;
-        }
-        if (m_visit_count == 1)
-            simulate_end_game(game);
-        backprop_leaf();
-        return nullptr;
+        return column<float>(offset_q_values());
     }
-    NodeGM* get_child(std::size_t index)
+    const float* q_values() const
     {
-        Node<Game, Move>* node = m_child.get();
-        for (; index--;) {
-            if (node->m_sibling == nullptr)
-                break;
-            node = node->m_sibling.get();
-        }
-        return node;
+        return column<float>(offset_q_values());
     }
-    NodeGM* select_at_internal_vertex(
-        Game& game,
-        const float coeff_puct,
-        const int non_random_ratio,
-        const int random_depth)
+    bool is_mate(const uint index) const
     {
-        NodeGM* ch = select_child(coeff_puct, non_random_ratio, random_depth);
-        ch->m_parent = this; // In order to cope with move operations.
-        if (ch->m_child == nullptr)
-            game.apply_nocheck(ch->m_action);
+        if constexpr (Layout::is_compact)
+            return (mate_flags()[index / 64u] >> (index % 64u)) & 1u;
         else
-            game.apply_mcts_internal_vertex(ch->m_action);
-        return ch;
+            return mate_flags()[index];
     }
-    NodeGM* select_child(
-        const float coeff_puct,
-        const int non_random_ratio,
-        const int random_depth)
+    void set_mate(const uint index, const bool mate)
     {
-        NodeGM* ch = nullptr;
-        if (use_random(non_random_ratio, random_depth)) {
-            ch = select_random();
+        if constexpr (Layout::is_compact) {
+            const std::uint64_t bit = std::uint64_t{1} << (index % 64u);
+            std::uint64_t& word = mate_flags()[index / 64u];
+            word = mate ? (word | bit) : (word & ~bit);
         } else {
-            ch = select_max_puct(coeff_puct);
-            ++(ch->m_visit_count_excluding_random);
+            mate_flags()[index] = mate;
         }
-        ++(ch->m_visit_count);
-        if ((m_most_visited_child == nullptr)
-            || (ch->m_visit_count_excluding_random
-                > m_most_visited_child->m_visit_count_excluding_random))
-            m_most_visited_child = ch;
-        return ch;
-    }
-    bool use_random(const int non_random_ratio, const int random_depth) const
-    {
-        if (random_depth <= 0)
-            return false;
-        const float u = dist(engine);
-        const float p_random = 1.f / static_cast<float>(1 + non_random_ratio);
-        if (u > p_random)
-            return false;
-        if (has_mate_to_win())
-            return false;
-        return true;
     }
-    bool has_mate_to_win() const
+    VirtualLoss* virtual_losses()
     {
-        const NodeGM* ch = m_child.get();
-        for (; ch != nullptr; ch = ch->m_sibling.get()) {
-            if (ch->is_mate_to_win())
-                return true;
-        }
-        return false;
+        return column<VirtualLoss>(offset_virtual_losses());
     }
-    bool is_mate_to_win() const
+    const VirtualLoss* virtual_losses() const
     {
-        return m_is_mate && (m_q_value > 0);
+        return column<VirtualLoss>(offset_virtual_losses());
     }
-    bool is_mate_to_lose() const
+    int* visit_counts_excluding_random()
     {
-        return m_is_mate && (m_q_value < 0);
+        return column<int>(offset_visit_counts_excluding_random());
     }
-    bool is_mate_to_lose(const std::size_t& index) const
+    const int* visit_counts_excluding_random() const
     {
-        const NodeGM* const child = get_child(index);
-        return child->m_is_mate && (child->m_q_value > 0);
+        return column<int>(offset_visit_counts_excluding_random());
     }
-    NodeGM* select_random()
+    Move* actions()
     {
-        constexpr std::size_t num_max_try = 3;
-        const std::size_t num = get_num_child();
-        const float p = 1.f / static_cast<float>(num);
-        Node* ch = nullptr;
-        for (std::size_t ii = num_max_try; ii--;) {
-            float s = dist(engine);
-            for (ch = m_child.get(); ch != nullptr; ch = ch->m_sibling.get()) {
-                if (p > s) {
-                    if (!ch->is_mate_to_win())
-                        return ch;
-                    else
-                        break;
-                }
-                s -= p;
-            }
-        }
-        return ch;
+        return column<Move>(offset_actions());
     }
-    NodeGM* select_max_puct(const float coeff_puct) const
+    const Move* actions() const
     {
-        NodeGM* ch = m_child.get();
-        NodeGM* out = ch;
-        float max_puct_score = ch->puct_score_from_parent_view(
-            coeff_puct, m_sqrt_visit_count, m_q_value);
-
-        ch = ch->m_sibling.get();
-        for (; ch != nullptr;) {
-            const float score = ch->puct_score_from_parent_view(
-                coeff_puct, m_sqrt_visit_count, m_q_value);
-            if (score > max_puct_score) {
-                max_puct_score = score;
-                out = ch;
-            }
-            ch = ch->m_sibling.get();
-        }
-        return out;
+        return column<Move>(offset_actions());
     }
-    float puct_score_from_parent_view(
-        const float coeff_puct,
-        const float sqrt_visit_count_of_parent,
-        const float q_of_parent) const
+    /**
+     * @brief Record that the child at an index is selected.
+     * @note Call this while holding the lock of the parent node.
+     */
+    void mark_selected(const uint index)
     {
-        const float q = (m_visit_count == 0) ? q_of_parent : -m_q_value;
-        if (is_mate_to_lose()) {
-            const float p_plus_1 = m_proba + 1.f;
-            return (q + 2.f)
-                   + p_plus_1 * sqrt_visit_count_of_parent * coeff_puct;
-        }
-        const float u = m_proba * sqrt_visit_count_of_parent
-                        / static_cast<float>(1 + m_visit_count);
-        return q + u * coeff_puct;
+        m_selected_end = std::max(m_selected_end, index + 1u);
     }
 
-private:
-    void simulate_ongoing_game(const float value)
+    /**
+     * @brief Return statistics of the children to compute PUCT scores of,
+     * which cover the children up to the first one never selected.
+     * @note Call this while holding the lock of the parent node.
+     */
+    auto puct_inputs() const
     {
-        m_value = value;
-        m_q_value = value;
+        const uint size = std::min(m_selected_end + 1u, m_size);
+        if constexpr (Layout::is_compact)
+            return CompactPuctInputs{
+                probas(),
+                visit_counts(),
+                q_values(),
+                mate_flags(),
+                virtual_losses(),
+                size};
+        else
+            return PuctInputs{
+                probas(),
+                visit_counts(),
+                q_values(),
+                mate_flags(),
+                virtual_losses(),
+                size};
     }
-    void simulate_end_game(const Game& game)
-    {
-        const auto result = game.get_result();
-        if (result == ResultEnum::DRAW)
-            return; // Skip simulation as no change from initial values.
 
-        const auto turn = game.get_turn();
-        const auto winner = (result == BLACK_WIN) ? BLACK : WHITE;
-        const auto value = (winner == turn) ? 1.f : -1.f;
-        m_value = value;
-        m_q_value = value;
-        m_is_mate = true;
+    /**
+     * @brief Return the child node at an index, or null pointer if it is not
+     * accessed yet.
+     * @note Call this while holding the lock of the parent node, unless no
+     * other threads are searching.
+     */
+    NodeGM* find_node(const uint index) const
+    {
+        const NodeRef ref = node_refs()[index];
+        if constexpr (Layout::is_compact)
+            return (ref == 0u) ? nullptr
+                               : node_in_line(
+                                   m_arena->at((ref - 1u) / nodes_per_line),
+                                   (ref - 1u) % nodes_per_line);
+        else
+            return ref;
     }
 
-private:
-    void expand(
-        const std::vector<Move>& actions,
-        const ColorEnum& turn,
-        const float* const policy_logits)
+    /**
+     * @brief Return the child node at an index, allocating it if not yet.
+     * @note Call this while holding the lock of the parent node, unless the
+     * block has no parent.
+     */
+    NodeGM* node(const uint index)
     {
-        const auto num = actions.size();
-        if (num == 0)
-            return;
-        auto probas = std::vector<float>(num);
-        const auto is_black_turn = (turn == ColorEnum::BLACK);
-        for (std::size_t ii = num; ii--;) {
-            const auto index
-                = (is_black_turn)
-                      ? actions[ii].to_dlshogi_policy_index()
-                      : actions[ii].rotate().to_dlshogi_policy_index();
-            probas[ii] = policy_logits[index];
-        }
-        softmax(probas);
-
-        m_child = std::make_unique<NodeGM>(actions[0], probas[0]);
-        NodeGM* child = m_child.get();
-        for (std::size_t ii = 1; ii < num; ++ii) {
-            child->m_sibling
-                = std::make_unique<NodeGM>(actions[ii], probas[ii]);
-            child = child->m_sibling.get();
+        static_assert(
+            node_line_header + nodes_per_line * sizeof(NodeGM) <= line_size);
+        NodeGM* const found = find_node(index);
+        if (found != nullptr)
+            return found;
+        const uint slot = index % nodes_per_line;
+        if constexpr (Layout::is_compact) {
+            // The sibling sharing the line may have allocated it already.
+            const NodeRef sibling = node_refs()[index ^ 1u];
+            std::uint32_t line = 0u;
+            if (sibling == 0u) {
+                line = m_arena->allocate_array_index(1u);
+                new (m_arena->at(line)) Children*(this);
+            } else {
+                line = (sibling - 1u) / nodes_per_line;
+            }
+            node_refs()[index] = line * nodes_per_line + slot + 1u;
+            return new (node_in_line(m_arena->at(line), slot)) NodeGM(index);
+        } else {
+            Line* const line = m_arena->allocate_array(1u);
+            new (line) Children*(this);
+            NodeGM* const out = new (node_in_line(line, slot)) NodeGM(index);
+            node_refs()[index] = out;
+            return out;
         }
     }
 
 private:
-    void backprop_at_internal_vertex(const float v)
+    Children(
+        ArenaType& arena,
+        NodeGM* const parent,
+        const uint size,
+        const uint capacity,
+        const std::uint32_t ref)
+        : m_parent(parent), m_next(nullptr), m_arena(&arena), m_size(size),
+          m_capacity(capacity), m_selected_end(0u), m_ref(ref)
     {
-        const auto count_before = static_cast<float>(m_visit_count - 1);
-        const auto count_after = static_cast<float>(m_visit_count);
-        m_sqrt_visit_count = std::sqrt(count_after);
-
-        m_q_value *= count_before / count_after;
-        m_q_value += v / count_after;
+    }
 
-        if (m_parent != nullptr) {
-            m_parent->update_most_visited_child(this);
-            m_parent->backprop_at_internal_vertex(-v);
-        }
+    static NodeGM* node_in_line(Line* const line, const uint slot)
+    {
+        return reinterpret_cast<NodeGM*>(
+            reinterpret_cast<unsigned char*>(line) + node_line_header
+            + slot * sizeof(NodeGM));
     }
-    void backprop_mate_at_internal_vertex(const float v)
+    static Line* line_of(NodeGM& node)
     {
-        const auto count_before = static_cast<float>(m_visit_count - 1);
-        const auto count_after = static_cast<float>(m_visit_count);
-        m_sqrt_visit_count = std::sqrt(count_after);
+        return reinterpret_cast<Line*>(
+            reinterpret_cast<unsigned char*>(&node) - node_line_header
+            - (node.m_index % nodes_per_line) * sizeof(NodeGM));
+    }
 
-        if ((!m_is_mate) && (v < 0) && has_non_mate_child()) {
-            m_is_mate = false;
-            m_q_value *= count_before / count_after;
-            m_q_value += v / count_after;
-            if (m_parent != nullptr) {
-                m_parent->update_most_visited_child(this);
-                m_parent->backprop_at_internal_vertex(-v);
-            }
-        } else {
-            m_is_mate = true;
-            m_q_value = v;
-            if (m_parent != nullptr) {
-                m_parent->update_most_visited_child(this);
-                m_parent->backprop_mate_at_internal_vertex(-v);
-            }
-        }
+    template <class T>
+    static constexpr std::size_t bytes_of(const std::size_t num)
+    {
+        const std::size_t n = (num * sizeof(T) + line_size - 1u);
+        return n / line_size * line_size;
     }
-    bool has_non_mate_child() const
+    static constexpr std::size_t num_mate_words(const uint capacity)
     {
-        const NodeGM* ch = m_child.get();
-        for (; ch != nullptr; ch = ch->m_sibling.get()) {
-            if (!ch->m_is_mate)
-                return true;
-        }
-        return false;
+        return (capacity + mate_flags_per_word - 1u) / mate_flags_per_word;
     }
-    void backprop_leaf()
+    static constexpr std::size_t num_lines(const uint capacity)
     {
-        // skip updating `m_q_value` because there should be no value change.
-        m_sqrt_visit_count = std::sqrt(static_cast<float>(m_visit_count));
-        if (m_parent != nullptr) {
-            m_parent->update_most_visited_child(this);
-            if (m_is_mate)
-                m_parent->backprop_mate_at_internal_vertex(-m_q_value);
-            else
-                m_parent->backprop_at_internal_vertex(-m_q_value);
-        }
+        const std::size_t n = line_size + bytes_of<Proba>(capacity)
+                              + bytes_of<float>(capacity)
+                              + bytes_of<int>(capacity) * 2u
+                              + bytes_of<MateFlags>(num_mate_words(capacity))
+                              + bytes_of<VirtualLoss>(capacity)
+                              + bytes_of<Move>(capacity)
+                              + bytes_of<NodeRef>(capacity);
+        return n / line_size;
     }
-    void update_most_visited_child(NodeGM* const candidate)
+    std::size_t offset_probas() const
     {
-        if (m_most_visited_child == nullptr)
-            m_most_visited_child = candidate;
-        else if (
-            candidate->m_visit_count_excluding_random
-            > m_most_visited_child->m_visit_count_excluding_random)
-            m_most_visited_child = candidate;
-        else if (
-            (candidate->m_visit_count_excluding_random
-             == m_most_visited_child->m_visit_count_excluding_random)
-            && (candidate->m_q_value < m_most_visited_child->m_q_value))
-            m_most_visited_child = candidate;
+        return line_size;
     }
-};
-
-template <class Game, class Move>
-class Searcher
-{
-private:
-    std::unique_ptr<Node<Game, Move>> m_root;
-    const float m_coeff_puct;
-    const int m_non_random_ratio;
-    const int m_random_depth;
-
-public:
-    Searcher(
-        const float coeff_puct,
-        const int non_random_ratio,
-        const int random_depth)
-        : m_root{}, m_coeff_puct(coeff_puct),
-          m_non_random_ratio(non_random_ratio), m_random_depth(random_depth)
+    std::size_t offset_visit_counts() const
     {
+        return offset_probas() + bytes_of<Proba>(m_capacity);
     }
-    void
-    set_game(const Game& g, const float value, const float* const policy_logits)
+    std::size_t offset_q_values() const
     {
-        m_root = std::make_unique<Node<Game, Move>>(
-            g.get_legal_moves(), g.get_turn(), value, policy_logits);
+        return offset_visit_counts() + bytes_of<int>(m_capacity);
     }
-    int get_visit_count() const
+    std::size_t offset_mate_flags() const
     {
-        return m_root->get_visit_count();
+        return offset_q_values() + bytes_of<float>(m_capacity);
     }
-    Node<Game, Move>* select(Game& game)
+    std::size_t offset_virtual_losses() const
     {
-        return m_root->select(
-            game, m_coeff_puct, m_non_random_ratio, m_random_depth);
+        return offset_mate_flags()
+               + bytes_of<MateFlags>(num_mate_words(m_capacity));
     }
-    Searcher<Game, Move>& apply(const Move& action)
+    std::size_t offset_visit_counts_excluding_random() const
     {
-        m_root->apply(action);
-        return *this;
+        return offset_virtual_losses() + bytes_of<VirtualLoss>(m_capacity);
     }
-    const Node<Game, Move>* get_root() const
+    std::size_t offset_actions() const
     {
-        return m_root.get();
+        return offset_visit_counts_excluding_random()
+               + bytes_of<int>(m_capacity);
     }
-    Move get_action_by_visit_max() const
+    std::size_t offset_node_refs() const
     {
-        const Node<Game, Move>* const root = m_root.get();
-        if (root->m_most_visited_child == nullptr)
-            return Move();
-        else
-            return root->m_most_visited_child->m_action;
+        return offset_actions() + bytes_of<Move>(m_capacity);
     }
-    Move get_action_by_visit_distribution(const float temperature) const
+    MateFlags* mate_flags()
+    {
+        return column<MateFlags>(offset_mate_flags());
+    }
+    const MateFlags* mate_flags() const
+    {
+        return column<MateFlags>(offset_mate_flags());
+    }
+    NodeRef* node_refs()
+    {
+        return column<NodeRef>(offset_node_refs());
+    }
+    const NodeRef* node_refs() const
+    {
+        return column<NodeRef>(offset_node_refs());
+    }
+    template <class T>
+    T* column(const std::size_t offset)
+    {
+        return reinterpret_cast<T*>(
+            reinterpret_cast<unsigned char*>(this) + offset);
+    }
+    template <class T>
+    const T* column(const std::size_t offset) const
     {
-        constexpr float eps = 1.f;
+        return reinterpret_cast<const T*>(
+            reinterpret_cast<const unsigned char*>(this) + offset);
+    }
+};
 
-        std::vector<float> probas(m_root->get_num_child());
-        const Node<Game, Move>* ch = m_root->get_child();
-        for (uint ii = 0u; ch != nullptr; ch = ch->m_sibling.get()) {
-            const auto v
-                = static_cast<float>(ch->m_visit_count_excluding_random);
-            probas[ii++] = std::log((v + eps)) / temperature;
-        }
-        softmax(probas);
+template <class Game, class Move, class Layout>
+class Node
+{
+private:
+    using NodeGM = Node<Game, Move, Layout>;
+    using ChildrenGM = Children<Game, Move, Layout>;
+    using ChildrenRef = typename ChildrenGM::Ref;
+    using ArenaGM = typename ChildrenGM::ArenaType;
+    using Proba = typename Layout::Proba;
+    using VirtualLoss = typename Layout::VirtualLoss;
+    using LockGuard = std::lock_guard<SpinLock>;
 
-        float s = dist(engine);
-        ch = m_root->get_child();
-        for (uint ii = 0u; ch != nullptr; ch = ch->m_sibling.get()) {
-            const auto p = probas[ii++];
-            if (s < p)
-                return ch->m_action;
-            s -= p;
+    /**
+     * @brief Maximum depth from the root at which actions may be selected in
+     * random manner.
+     */
+    static constexpr int max_random_depth = 64;
+
+    /**
+     * @brief Block of child nodes, or null reference if not expanded.
+     */
+    ChildrenRef m_children;
+
+    /**
+     * @brief Index of this node in the block it is stored in, `block()`.
+     * Statistics of this node, e.g. visit count, are the elements of the
+     * arrays of the block at this index.
+     * @note They are guarded by the lock of the parent node, or by the lock
+     * of this node if this is the root.
+     */
+    uint m_index;
+
+    /**
+     * @brief Index of the child visited most in non-random manner plus one,
+     * or zero if none.
+     */
+    std::uint32_t m_most_visited_child;
+
+    /**
+     * @brief result of `std::sqrt(static_cast<float>(get_visit_count()))`.
+     * @details Computing this value beforehand to reduce the computation time
+     * of `u_value_of_puct()` function.
+     */
+    float m_sqrt_visit_count;
+
+    /**
+     * @brief 1 ~ -1 scaled probability of the turn player winning the game.
+     * @details This is typically a raw estimate of a machine learning model.
+     * If the turn is black, then this value shows winning rate of black.
+     * If the turn is white, then it shows the rate of white. If the value is
+     * out of [-1, 1] range, then it means that there is a winner.
+     */
+    float m_value;
+
+    /**
+     * @brief True from when a search thread selects this leaf node until its
+     * evaluation is backpropagated. Other threads avoid such a leaf instead
+     * of evaluating it twice.
+     */
+    bool m_is_pending_evaluation;
+
+    /**
+     * @brief Lock guarding `m_most_visited_child` and statistics of the child
+     * nodes including their `m_sqrt_visit_count`, `m_children`, and
+     * `m_is_pending_evaluation`.
+     * @note Lock a parent node before its child to avoid deadlocks.
+     */
+    mutable SpinLock m_lock;
+
+    /**
+     * @brief What a search thread reads from a node while holding the lock
+     * guarding its statistics, so that it is used after releasing the lock.
+     */
+    struct Visit
+    {
+        ChildrenGM* children;
+        float sqrt_visit_count;
+        float q_value;
+
+        /**
+         * @brief True if the node is pending evaluation by another thread.
+         */
+        bool is_collision;
+    };
+
+    /**
+     * @brief Nodes `select()` went through, so that walking back up to the
+     * root reads them from a small buffer instead of the blocks in the tree.
+     * @details Only the deepest `capacity` nodes are kept, above which
+     * parents are read from the blocks.
+     */
+    class Path
+    {
+    public:
+        static constexpr uint capacity = 64u;
+
+    private:
+        NodeGM* m_nodes[capacity];
+
+        /**
+         * @brief Depth of the node whose parent `pop()` returns next.
+         */
+        uint m_depth;
+
+        /**
+         * @brief Number of nodes kept in `m_nodes`.
+         */
+        uint m_size;
+
+    public:
+        Path() : m_depth(0u), m_size(0u)
+        {
+        }
+        uint depth() const
+        {
+            return m_depth;
+        }
+
+        /**
+         * @brief Record a node to descend from.
+         */
+        void push(NodeGM* const node)
+        {
+            m_nodes[m_depth % capacity] = node;
+            ++m_depth;
+            m_size = std::min(m_size + 1u, capacity);
+        }
+
+        /**
+         * @brief Return the parent of a node at the current depth, and move
+         * one level up.
+         */
+        NodeGM* pop(const NodeGM* const node)
+        {
+            if (m_depth > 0u)
+                --m_depth;
+            if (m_size == 0u)
+                return node->parent();
+            --m_size;
+            return m_nodes[m_depth % capacity];
+        }
+    };
+
+    friend class Children<Game, Move, Layout>;
+    friend class Searcher<Game, Move, Layout>;
+
+public:
+    explicit Node(const uint index)
+        : m_children(), m_index(index), m_most_visited_child(0u),
+          m_sqrt_visit_count(0.f), m_value(0.f),
+          m_is_pending_evaluation(false), m_lock()
+    {
+    }
+
+    // Rules of 5
+    ~Node() = default; // 1/5 destructor
+    Node(const Node& other) = delete; // 2/5 copy constructor
+    Node& operator=(const Node& other) = delete; // 3/5 copy assignment
+    Node(Node&& other) = delete; // 4/5 move constructor
+    Node& operator=(Node&& other) = delete; // 5/5 move assignment
+
+    /**
+     * @brief Create a root node in a block of its own, and expand it.
+     *
+     * @param arena Arena to allocate nodes from.
+     * @param actions Legal actions at the root.
+     * @param turn Turn at the root.
+     * @param value Value of the root.
+     * @param policy_logits Policy logits at the root.
+     * @return Node<Game, Move>* Root node.
+     */
+    static NodeGM* create_root(
+        ArenaGM& arena,
+        const std::vector<Move>& actions,
+        const ColorEnum& turn,
+        const float value,
+        const float* const policy_logits)
+    {
+        NodeGM* const root = ChildrenGM::create(arena, nullptr, 1u)->node(0u);
+        root->visit_count() = 1;
+        root->visit_count_excluding_random() = 1;
+        root->virtual_loss() = 1;
+        root->simulate_expand_and_backprop(
+            arena, actions, turn, value, policy_logits);
+        return root;
+    }
+
+    int get_visit_count() const
+    {
+        return block()->visit_counts()[m_index];
+    }
+    int get_visit_count_excluding_random() const
+    {
+        return block()->visit_counts_excluding_random()[m_index];
+    }
+    float get_value() const
+    {
+        return m_value;
+    }
+    float get_q_value(const uint greedy_depth = 0u) const
+    {
+        const NodeGM* const ch = most_visited_child();
+        if ((ch == nullptr) || (greedy_depth == 0u))
+            return q_value();
+        else
+            return -ch->get_q_value(greedy_depth - 1u);
+    }
+    float get_proba() const
+    {
+        return block()->proba(m_index);
+    }
+    Move get_action() const
+    {
+        return block()->actions()[m_index];
+    }
+    bool is_pending_evaluation() const
+    {
+        return m_is_pending_evaluation;
+    }
+    uint get_num_child() const
+    {
+        const ChildrenGM* const children = this->children();
+        return (children == nullptr) ? 0u : children->size();
+    }
+    /**
+     * @brief Return the child node at an index, or null pointer if it has
+     * never been selected. Statistics of every child are read by e.g.
+     * `get_visit_counts()` instead.
+     */
+    const NodeGM* get_child(uint index = 0U) const
+    {
+        const ChildrenGM* const children = this->children();
+        if (children == nullptr)
+            return nullptr;
+        LockGuard lock(m_lock);
+        return children->find_node(std::min(index, children->size() - 1u));
+    }
+    const NodeGM* get_child(const Move& action) const
+    {
+        const ChildrenGM* const children = this->children();
+        if (children == nullptr)
+            return nullptr;
+        const Move* const actions = children->actions();
+        for (uint ii = 0u; ii < children->size(); ++ii) {
+            if (actions[ii] == action) {
+                LockGuard lock(m_lock);
+                return children->find_node(ii);
+            }
+        }
+        return nullptr;
+    }
+    const NodeGM* get_sibling() const
+    {
+        const ChildrenGM* const block = this->block();
+        if (m_index + 1u < block->size()) {
+            LockGuard lock(guard());
+            return block->find_node(m_index + 1u);
+        }
+        return nullptr;
+    }
+    const NodeGM* get_most_visited_child() const
+    {
+        return most_visited_child();
+    }
+
+    /**
+     * @brief Return actions of the children in the order of their indices,
+     * which is the descending order of their prior probabilities.
+     */
+    std::vector<Move> get_actions() const
+    {
+        const ChildrenGM* const children = this->children();
+        if (children == nullptr)
+            return {};
+        const Move* const actions = children->actions();
+        return std::vector<Move>(actions, actions + children->size());
+    }
+    std::vector<float> get_probas() const
+    {
+        const ChildrenGM* const children = this->children();
+        const uint num = (children == nullptr) ? 0u : children->size();
+        std::vector<float> out(num);
+        for (uint ii = 0u; ii < num; ++ii)
+            out[ii] = children->proba(ii);
+        return out;
+    }
+    std::vector<int> get_visit_counts() const
+    {
+        const ChildrenGM* const children = this->children();
+        if (children == nullptr)
+            return {};
+        LockGuard lock(m_lock);
+        const int* const counts = children->visit_counts();
+        return std::vector<int>(counts, counts + children->size());
+    }
+    std::vector<int> get_visit_counts_excluding_random() const
+    {
+        const ChildrenGM* const children = this->children();
+        if (children == nullptr)
+            return {};
+        LockGuard lock(m_lock);
+        const int* const counts = children->visit_counts_excluding_random();
+        return std::vector<int>(counts, counts + children->size());
+    }
+
+    /**
+     * @brief Return `get_q_value(greedy_depth)` of each of the children, which
+     * is from the point of view of the turn player of the child.
+     */
+    std::vector<float> get_q_values(const uint greedy_depth = 0u) const
+    {
+        const ChildrenGM* const children = this->children();
+        const uint num = (children == nullptr) ? 0u : children->size();
+        std::vector<float> out(num);
+        if (num == 0u)
+            return out;
+        LockGuard lock(m_lock);
+        const float* const q_values = children->q_values();
+        for (uint ii = 0u; ii < num; ++ii) {
+            const NodeGM* const ch = children->find_node(ii);
+            out[ii] = ((ch == nullptr) || (greedy_depth == 0u))
+                          ? q_values[ii]
+                          : ch->get_q_value(greedy_depth);
+        }
+        return out;
+    }
+
+    /**
+     * @brief Select a leaf node using PUCT algorithm.
+     * @details This is thread-safe, so that multiple threads may descend the
+     * same tree at once. Each visit in flight counts as a loss of the parent
+     * until it is backpropagated (virtual loss), which spreads threads over
+     * different leaves.
+     * @note https://en.wikipedia.org/wiki/Monte_Carlo_tree_search#Principle_of_operation
+     *
+     * @param [in,out] game The game position of the node. After the end, the
+     * position corresponds to the leaf node.
+     * @param [in] coeff_puct Coefficient of PUCT algorithm. Higher the value is,
+     * stronger the exploration is.
+     * @param [in] non_random_ratio Ratio of selecting actions in non-random manner.
+     * `proba_of_random : proba_of_non_random = 1 : non_random_ratio`.
+     * If the value is negative, no random selection.
+     * @param [in] random_depth Depth of nodes to explore in random manner.
+     * e.g. If `random_depth == 2`, `non_random_ratio` takes effect when
+     * selecting child nodes from root node and from nodes beneath the root
+     * node. `non_random_ratio` takes no effect for the nodes further below.
+     * Values larger than 64 are regarded as 64.
+     * @param [in,out] random Generator used for random selections, which the
+     * calling thread owns.
+     * @param [in,out] stats Statistics to count the selection in, or null.
+     * @param [in] root_index Index of the child of this node to descend to
+     * first instead of selecting it by PUCT algorithm, or negative.
+     * @return Node<Game, Move> Leaf node selected by PUCT algorithm.
+     * If it is game end, or if the leaf is pending evaluation, then
+     * output is null pointer.
+     */
+    NodeGM* select(
+        Game& game,
+        const float coeff_puct,
+        const int non_random_ratio,
+        int random_depth,
+        Random& random,
+        SearchStats* const stats = nullptr,
+        const int root_index = -1)
+    {
+        random_depth = std::min(random_depth, max_random_depth);
+        std::uint64_t random_selections = 0u;
+        NodeGM* node = this;
+        Path path{};
+        Visit visit{};
+        {
+            LockGuard lock(guard());
+            ++visit_count();
+            ++visit_count_excluding_random();
+            ++virtual_loss();
+            visit = enter();
+        }
+        int depth = 0;
+        for (; visit.children != nullptr; ++depth) {
+            NodeGM* ch = nullptr;
+            bool is_random = false;
+            {
+                LockGuard lock(node->m_lock);
+                if ((depth == 0) && (root_index >= 0))
+                    ch = node->visit_child(
+                        *node->children(),
+                        static_cast<uint>(root_index),
+                        false);
+                else
+                    ch = node->select_child(
+                        coeff_puct,
+                        non_random_ratio,
+                        random_depth - depth,
+                        visit,
+                        random,
+                        is_random);
+                visit = ch->enter();
+            }
+            if (is_random)
+                random_selections |= (std::uint64_t{1} << depth);
+            if (visit.children == nullptr)
+                game.apply_nocheck(ch->get_action());
+            else
+                game.apply_mcts_internal_vertex(ch->get_action());
+            path.push(node);
+            node = ch;
+        }
+
+        if (stats != nullptr) {
+            SearchStats::add(stats->num_selections);
+            stats->add_depth(static_cast<std::size_t>(depth));
+        }
+        if (visit.is_collision) {
+            node->cancel_select(path, random_selections);
+            if (stats != nullptr)
+                SearchStats::add(stats->num_collisions);
+            return nullptr;
+        }
+        if (game.get_result() == ResultEnum::ONGOING)
+            return node;
+        const uint num_mates
+            = node->backprop_leaf(path, [&game](NodeGM& leaf) {
+                  leaf.m_is_pending_evaluation = false;
+                  if (leaf.get_visit_count() == leaf.virtual_loss())
+                      leaf.simulate_end_game(game); // First visit to the leaf.
+                  return leaf.q_value();
+              });
+        if (stats != nullptr) {
+            SearchStats::add(stats->num_terminals);
+            SearchStats::add(stats->num_mates, num_mates);
+        }
+        return nullptr;
+    }
+
+    /**
+     * @note https://en.wikipedia.org/wiki/Monte_Carlo_tree_search#Principle_of_operation
+     *
+     * @param arena Arena to allocate child nodes from. It has to be the one
+     * that the other nodes of the tree are allocated from.
+     * @param actions
+     * @param turn
+     * @param value
+     * @param policy_logits
+     */
+    void simulate_expand_and_backprop(
+        ArenaGM& arena,
+        const std::vector<Move>& actions,
+        const ColorEnum& turn,
+        const float value,
+        const float* const policy_logits)
+    {
+        ChildrenGM* const children
+            = create_children(arena, actions, turn, policy_logits);
+        backprop_leaf([children, value](NodeGM& leaf) {
+            leaf.m_value = value;
+            leaf.set_children(children);
+            leaf.m_is_pending_evaluation = false;
+            leaf.simulate_value(value);
+            return value;
+        });
+    }
+
+    /**
+     * @brief Expand this leaf node with prior probabilities already known,
+     * e.g. found in a cache of evaluations, and backpropagate the value.
+     *
+     * @param arena Arena to allocate child nodes from.
+     * @param actions Legal actions of the game position of this leaf node.
+     * @param value Value of the game position.
+     * @param probas Prior probabilities of `actions`.
+     */
+    void simulate_expand_and_backprop_with_probas(
+        ArenaGM& arena,
+        const std::vector<Move>& actions,
+        const float value,
+        const float* const probas)
+    {
+        const auto num = static_cast<uint>(actions.size());
+        ChildrenGM* children = nullptr;
+        if (num > 0u) {
+            children = ChildrenGM::create(arena, this, num);
+            children->assign(actions.data(), probas);
+        }
+        backprop_leaf([children, value](NodeGM& leaf) {
+            leaf.m_value = value;
+            leaf.set_children(children);
+            leaf.m_is_pending_evaluation = false;
+            leaf.simulate_value(value);
+            return value;
+        });
+    }
+    /**
+     * @brief Mark this leaf node as mate, e.g. found by DFPN search, and
+     * backpropagate it.
+     * @return uint Number of nodes newly proven to be mate.
+     */
+    uint simulate_mate_and_backprop()
+    {
+        return backprop_leaf([](NodeGM& leaf) {
+            leaf.m_value = 1.f;
+            leaf.m_is_pending_evaluation = false;
+            leaf.q_value() = 1.f;
+            leaf.set_mate(true);
+            return 1.f;
+        });
+    }
+
+    /**
+     * @brief Make the child node of the action to be this node, and return
+     * the other nodes below this node to the arena.
+     * @note This must not be called while other threads are searching.
+     *
+     * @param arena Arena the nodes below this node are allocated from.
+     * @param action Action to apply.
+     * @return Node<Game, Move>& This node.
+     */
+    NodeGM& apply(ArenaGM& arena, const Move& action)
+    {
+        ChildrenGM* const discarded = apply(action);
+        if (discarded != nullptr)
+            ChildrenGM::release(arena, discarded);
+        return *this;
+    }
+
+    /**
+     * @brief Make the child node of the action to be this node, leaving the
+     * other nodes below this node to the caller to release, in O(1).
+     * @note This must not be called while other threads are searching.
+     *
+     * @param action Action to apply.
+     * @return Children<Game, Move>* Block of nodes discarded, or null pointer
+     * if none.
+     */
+    ChildrenGM* apply(const Move& action)
+    {
+        ChildrenGM* const children = this->children();
+        const uint num = get_num_child();
+        for (uint ii = 0u; ii < num; ++ii) {
+            if (children->actions()[ii] == action) {
+                NodeGM* const ch = children->find_node(ii);
+                action_ref() = action;
+                proba() = children->probas()[ii];
+                visit_count() = children->visit_counts()[ii];
+                visit_count_excluding_random()
+                    = children->visit_counts_excluding_random()[ii];
+                q_value() = children->q_values()[ii];
+                set_mate(children->is_mate(ii));
+                virtual_loss() = children->virtual_losses()[ii];
+                if (ch == nullptr) { // Never accessed
+                    m_sqrt_visit_count = 0.f;
+                    m_value = 0.f;
+                    m_most_visited_child = 0u;
+                    m_is_pending_evaluation = false;
+                    set_children(nullptr);
+                    return children;
+                }
+                m_sqrt_visit_count = ch->m_sqrt_visit_count;
+                m_value = ch->m_value;
+                // Indices of the grandchildren stay valid in their block.
+                m_most_visited_child = ch->m_most_visited_child;
+                m_is_pending_evaluation = ch->m_is_pending_evaluation;
+                set_children(ch->children());
+                if (has_children())
+                    this->children()->set_parent(this);
+                ch->set_children(nullptr); // Keep grandchildren alive.
+                return children;
+            }
+        }
+
+        set_children(nullptr);
+        visit_count() = 0;
+        visit_count_excluding_random() = 0;
+        virtual_loss() = 0;
+        m_sqrt_visit_count = 0.f;
+        m_value = 0.f;
+        q_value() = 0.f;
+        set_mate(false);
+        m_most_visited_child = 0u;
+        m_is_pending_evaluation = false;
+        return children;
+    }
+
+private:
+    /**
+     * @brief Return the block this node is stored in.
+     */
+    ChildrenGM* block() const
+    {
+        return ChildrenGM::block_of(*this);
+    }
+
+    /**
+     * @brief Return the block of child nodes, or null pointer if not
+     * expanded.
+     */
+    ChildrenGM* children() const
+    {
+        if constexpr (Layout::is_compact)
+            return block()->deref(m_children);
+        else
+            return m_children;
+    }
+    void set_children(ChildrenGM* const children)
+    {
+        m_children = ChildrenGM::ref_of(children);
+    }
+    bool has_children() const
+    {
+        return m_children != ChildrenRef();
+    }
+    NodeGM* most_visited_child() const
+    {
+        if (m_most_visited_child == 0u)
+            return nullptr;
+        return children()->find_node(m_most_visited_child - 1u);
+    }
+    int& visit_count()
+    {
+        return block()->visit_counts()[m_index];
+    }
+    int& visit_count_excluding_random()
+    {
+        return block()->visit_counts_excluding_random()[m_index];
+    }
+    VirtualLoss& virtual_loss()
+    {
+        return block()->virtual_losses()[m_index];
+    }
+    int virtual_loss() const
+    {
+        return block()->virtual_losses()[m_index];
+    }
+    float& q_value()
+    {
+        return block()->q_values()[m_index];
+    }
+    float q_value() const
+    {
+        return block()->q_values()[m_index];
+    }
+    bool is_mate() const
+    {
+        return block()->is_mate(m_index);
+    }
+    void set_mate(const bool mate)
+    {
+        block()->set_mate(m_index, mate);
+    }
+    Proba& proba()
+    {
+        return block()->probas()[m_index];
+    }
+    Move& action_ref()
+    {
+        return block()->actions()[m_index];
+    }
+    NodeGM* parent() const
+    {
+        return block()->parent();
+    }
+
+    /**
+     * @brief Return the lock guarding statistics of this node.
+     */
+    SpinLock& guard() const
+    {
+        NodeGM* const p = parent();
+        return (p == nullptr) ? m_lock : p->m_lock;
+    }
+
+    /**
+     * @brief Read this node when a search thread enters it, and claim it if
+     * it is a leaf not pending evaluation.
+     * @note Call this while holding the lock returned by `guard()`.
+     */
+    Visit enter()
+    {
+        Visit out{children(), m_sqrt_visit_count, q_value(), false};
+        if (out.children == nullptr) {
+            out.is_collision = m_is_pending_evaluation;
+            m_is_pending_evaluation = true;
+        }
+        return out;
+    }
+
+private:
+    /**
+     * @note Call this while holding the lock of this node.
+     */
+    NodeGM* select_child(
+        const float coeff_puct,
+        const int non_random_ratio,
+        const int random_depth,
+        const Visit& visit,
+        Random& random,
+        bool& is_random)
+    {
+        ChildrenGM& children = *this->children();
+        is_random
+            = use_random(children, non_random_ratio, random_depth, random);
+        const uint index = is_random ? select_random(children, random)
+                                     : select_max_puct(
+                                         children,
+                                         coeff_puct,
+                                         visit.sqrt_visit_count,
+                                         visit.q_value);
+        return visit_child(children, index, is_random);
+    }
+
+    /**
+     * @brief Count a visit to the child of the index.
+     * @note Call this while holding the lock of this node.
+     */
+    NodeGM*
+    visit_child(ChildrenGM& children, const uint index, const bool is_random)
+    {
+        int* const counts_excluding_random
+            = children.visit_counts_excluding_random();
+        if (!is_random)
+            ++counts_excluding_random[index];
+        ++children.visit_counts()[index];
+        ++children.virtual_losses()[index];
+        children.mark_selected(index);
+        if ((m_most_visited_child == 0u)
+            || (counts_excluding_random[index]
+                > counts_excluding_random[m_most_visited_child - 1u]))
+            m_most_visited_child = index + 1u;
+        return children.node(index);
+    }
+    static bool use_random(
+        const ChildrenGM& children,
+        const int non_random_ratio,
+        const int random_depth,
+        Random& random)
+    {
+        if (random_depth <= 0)
+            return false;
+        const float u = random.uniform();
+        const float p_random = 1.f / static_cast<float>(1 + non_random_ratio);
+        if (u > p_random)
+            return false;
+        if (has_mate_to_win(children))
+            return false;
+        return true;
+    }
+    static bool has_mate_to_win(const ChildrenGM& children)
+    {
+        const float* const q_values = children.q_values();
+        for (uint ii = children.size(); ii--;) {
+            if (children.is_mate(ii) && (q_values[ii] > 0))
+                return true;
+        }
+        return false;
+    }
+    static uint select_random(const ChildrenGM& children, Random& random)
+    {
+        constexpr std::size_t num_max_try = 3;
+        const uint num = children.size();
+        const float* const q_values = children.q_values();
+        uint index = 0u;
+        for (std::size_t ii = num_max_try; ii--;) {
+            const float s = random.uniform() * static_cast<float>(num);
+            index = std::min(static_cast<uint>(s), num - 1u);
+            if (!(children.is_mate(index) && (q_values[index] > 0)))
+                break;
+        }
+        return index;
+    }
+    static uint select_max_puct(
+        const ChildrenGM& children,
+        const float coeff_puct,
+        const float sqrt_visit_count,
+        const float q_of_parent)
+    {
+        return puct_argmax(
+            children.puct_inputs(),
+            coeff_puct,
+            sqrt_visit_count,
+            q_of_parent);
+    }
+
+    /**
+     * @brief Undo the visits in flight from the root down to this node.
+     *
+     * @param path Nodes `select()` went through to this node.
+     * @param random_selections Bit flags, each of which is set if the action
+     * was selected in random manner at the depth.
+     */
+    void cancel_select(Path& path, const std::uint64_t random_selections)
+    {
+        for (NodeGM* node = this;;) {
+            const uint depth = path.depth();
+            NodeGM* const p = path.pop(node);
+            // Selections deeper than `max_random_depth` are never random.
+            const bool is_random
+                = (depth > 0u) && (depth <= static_cast<uint>(max_random_depth))
+                  && ((random_selections >> (depth - 1u)) & std::uint64_t{1});
+            LockGuard lock(node->guard());
+            --node->visit_count();
+            --node->virtual_loss();
+            if (!is_random)
+                --node->visit_count_excluding_random();
+            if (p == nullptr)
+                break;
+            if (p->m_most_visited_child == node->m_index + 1u)
+                p->reset_most_visited_child();
+            node = p;
+        }
+    }
+
+private:
+    /**
+     * @brief Set Q-value of this leaf node by a value of simulation.
+     * @details The value is averaged with the visits already backpropagated,
+     * which remain if this leaf node was pruned.
+     * @note Call this while holding the lock returned by `guard()`.
+     */
+    void simulate_value(const float value)
+    {
+        const int count_before = get_visit_count() - virtual_loss();
+        float& q = q_value();
+        if (count_before <= 0) {
+            q = value;
+            return;
+        }
+        const auto count_after = static_cast<float>(count_before + 1);
+        q *= static_cast<float>(count_before) / count_after;
+        q += value / count_after;
+    }
+
+    /**
+     * @brief Turn this node back into a leaf node keeping its statistics,
+     * unless a search thread is visiting it or it leads to mate.
+     * @note Call this while holding the lock returned by `guard()`.
+     *
+     * @return ChildrenGM* Block of the child nodes detached, which the caller
+     * returns to the arena, or null pointer if nothing is detached.
+     */
+    ChildrenGM* collapse()
+    {
+        if ((!has_children()) || (virtual_loss() != 0) || is_mate())
+            return nullptr;
+        ChildrenGM* const out = children();
+        set_children(nullptr);
+        m_most_visited_child = 0u;
+        return out;
+    }
+
+    void simulate_end_game(const Game& game)
+    {
+        const auto result = game.get_result();
+        if (result == DRAW)
+            return; // Skip simulation as no change from initial values.
+
+        const auto turn = game.get_turn();
+        const auto winner = (result == BLACK_WIN) ? BLACK : WHITE;
+        const auto value = (winner == turn) ? 1.f : -1.f;
+        m_value = value;
+        q_value() = value;
+        set_mate(true);
+    }
+
+private:
+    ChildrenGM* create_children(
+        ArenaGM& arena,
+        const std::vector<Move>& actions,
+        const ColorEnum& turn,
+        const float* const policy_logits)
+    {
+        const auto num = static_cast<uint>(actions.size());
+        if (num == 0)
+            return nullptr;
+        ChildrenGM* const out = ChildrenGM::create(arena, this, num);
+        std::vector<float> probas(num);
+        for (uint ii = num; ii--;)
+            probas[ii]
+                = policy_logits[actions[ii].to_dlshogi_policy_index(turn)];
+        softmax(probas);
+        out->assign(actions.data(), probas.data());
+        return out;
+    }
+
+private:
+    /**
+     * @brief Backpropagate the value of this leaf node up to the root.
+     * @details Statistics of each node on the path are updated while holding
+     * the lock of its parent, one node at a time.
+     *
+     * @param simulate Function to set the value of this leaf node and return
+     * the value to backpropagate, which is called while holding the lock
+     * guarding the statistics of this node.
+     * @return uint Number of nodes newly proven to be mate.
+     */
+    template <class Simulate>
+    uint backprop_leaf(Simulate simulate)
+    {
+        Path path{};
+        return backprop_leaf(path, simulate);
+    }
+
+    /**
+     * @brief Backpropagate the value of this leaf node up to the root along
+     * the nodes `select()` went through.
+     */
+    template <class Simulate>
+    uint backprop_leaf(Path& path, Simulate simulate)
+    {
+        NodeGM* p = path.pop(this);
+        float v = 0.f;
+        bool mate = false;
+        bool next_has_non_mate_child = false;
+        uint num_mates = 0u;
+        {
+            LockGuard lock(guard());
+            const bool was_mate = is_mate();
+            v = -simulate(*this);
+            --virtual_loss();
+            m_sqrt_visit_count = std::sqrt(static_cast<float>(get_visit_count()));
+            mate = is_mate();
+            num_mates += (mate && (!was_mate)) ? 1u : 0u;
+            if (p != nullptr) {
+                p->update_most_visited_child(m_index);
+                if (mate)
+                    next_has_non_mate_child = p->has_non_mate_child();
+            }
+        }
+        for (NodeGM* node = p; node != nullptr; node = p) {
+            p = path.pop(node);
+            LockGuard lock(node->guard());
+            const bool was_mate = node->is_mate();
+            mate = mate && node->backprop_mate(v, next_has_non_mate_child);
+            if (!mate)
+                node->backprop_value(v);
+            else if (!was_mate)
+                ++num_mates;
+            if (p != nullptr) {
+                p->update_most_visited_child(node->m_index);
+                if (mate)
+                    next_has_non_mate_child = p->has_non_mate_child();
+            }
+            v = -v;
+        }
+        return num_mates;
+    }
+
+    /**
+     * @brief Update statistics of this internal node with a value.
+     * @note Call this while holding the lock returned by `guard()`.
+     */
+    void backprop_value(const float v)
+    {
+        --virtual_loss();
+        const int visit_count = get_visit_count();
+        const auto count_after
+            = static_cast<float>(visit_count - virtual_loss());
+        const auto count_before = count_after - 1.f;
+        m_sqrt_visit_count = std::sqrt(static_cast<float>(visit_count));
+
+        float& q = q_value();
+        q *= count_before / count_after;
+        q += v / count_after;
+    }
+
+    /**
+     * @brief Update statistics of this internal node with a value of mate if
+     * the node is in mate or leads to mate.
+     * @note Call this while holding the lock returned by `guard()`.
+     *
+     * @param v Value of this node.
+     * @param has_non_mate_child True if any child node is not in mate.
+     * @return true If this node is in mate or leads to mate.
+     * @return false Otherwise, in which case nothing is updated.
+     */
+    bool backprop_mate(const float v, const bool has_non_mate_child)
+    {
+        if ((!is_mate()) && (v < 0) && has_non_mate_child)
+            return false;
+        --virtual_loss();
+        m_sqrt_visit_count = std::sqrt(static_cast<float>(get_visit_count()));
+        set_mate(true);
+        q_value() = v;
+        return true;
+    }
+    bool has_non_mate_child() const
+    {
+        const ChildrenGM* const children = this->children();
+        for (uint ii = children->size(); ii--;) {
+            if (!children->is_mate(ii))
+                return true;
+        }
+        return false;
+    }
+    void update_most_visited_child(const uint candidate)
+    {
+        if (m_most_visited_child == 0u) {
+            m_most_visited_child = candidate + 1u;
+            return;
+        }
+        const ChildrenGM* const children = this->children();
+        const int* const counts = children->visit_counts_excluding_random();
+        const float* const q_values = children->q_values();
+        const uint current = m_most_visited_child - 1u;
+        if ((counts[candidate] > counts[current])
+            || ((counts[candidate] == counts[current])
+                && (q_values[candidate] < q_values[current])))
+            m_most_visited_child = candidate + 1u;
+    }
+    void reset_most_visited_child()
+    {
+        m_most_visited_child = 0u;
+        const ChildrenGM* const children = this->children();
+        for (uint ii = 0u; ii < children->size(); ++ii) {
+            if ((children->find_node(ii) != nullptr)
+                && (children->visit_counts()[ii] > 0))
+                update_most_visited_child(ii);
+        }
+    }
+};
+
+/**
+ * @brief Monte Carlo tree searcher.
+ * @details `select()`, `simulate_expand_and_backprop()`, and
+ * `simulate_mate_and_backprop()` are thread-safe, so that multiple threads
+ * may search the same tree in parallel. The other member functions must not
+ * be called while searching.
+ *
+ * With an evaluation cache set, a leaf whose game position is found in the
+ * cache is expanded right away with the cached evaluation, instead of being
+ * returned for evaluation, so that transposed game positions are evaluated
+ * once.
+ */
+template <class Game, class Move, class Layout>
+class Searcher
+{
+public:
+    /**
+     * @brief Function evaluating a batch of game positions.
+     * @details `evaluate(n, feature_maps, values, policy_logits)` reads
+     * feature maps of shape `[n, ranks, files, channels]` and writes values of
+     * shape `[n]` and policy logits of shape `[n, num_dlshogi_policy]`.
+     */
+    using Evaluator = std::function<void(uint, const float*, float*, float*)>;
+
+private:
+    using NodeGM = Node<Game, Move, Layout>;
+    using ChildrenGM = Children<Game, Move, Layout>;
+
+    /**
+     * @brief Arena all the nodes of the tree are allocated from.
+     */
+    typename ChildrenGM::ArenaType m_arena;
+
+    NodeGM* m_root;
+    const float m_coeff_puct;
+    const int m_non_random_ratio;
+    const int m_random_depth;
+
+    /**
+     * @brief Leaves selected by `select_batch()` waiting for evaluation, and
+     * legal moves and turns of their game positions.
+     * @note Buffers of `m_batch_actions` are kept across batches, so that it
+     * may be longer than `m_batch_leaves`.
+     */
+    std::vector<NodeGM*> m_batch_leaves;
+    std::vector<std::vector<Move>> m_batch_actions;
+    std::vector<ColorEnum> m_batch_turns;
+    std::vector<std::uint64_t> m_batch_hashes;
+
+    /**
+     * @brief Cache of evaluations consulted before returning a leaf for
+     * evaluation, which may be shared with other searchers, or null.
+     */
+    std::shared_ptr<EvalCache> m_eval_cache;
+
+    /**
+     * @brief Statistics of the search, or null unless enabled.
+     */
+    std::unique_ptr<SearchStats> m_stats;
+
+    /**
+     * @brief Chain of blocks discarded by `apply()` and not returned to the
+     * arena yet. A few of them are returned every time a leaf is expanded.
+     */
+    ChildrenGM* m_discarded;
+    SpinLock m_discarded_lock;
+
+    /**
+     * @brief Number of discarded blocks to return to the arena per expansion,
+     * which is more than the one block allocated by the expansion so that
+     * the discarded blocks are eventually reclaimed.
+     */
+    static constexpr std::size_t num_reclaim_per_expansion = 2u;
+
+    /**
+     * @brief Number of bytes the tree may use, or zero if unlimited.
+     */
+    std::size_t m_memory_budget;
+    SpinLock m_prune_lock;
+
+    /**
+     * @brief Generator seeding the generators of search threads.
+     */
+    mutable Random m_random;
+    mutable SpinLock m_random_lock;
+
+    /**
+     * @brief Visit counts of the children of the root taken by
+     * `snapshot_visit_counts()`, and their sum.
+     */
+    std::vector<int> m_visit_count_snapshot;
+    int m_visit_count_snapshot_sum;
+
+public:
+    /**
+     * @param coeff_puct Coefficient of PUCT algorithm.
+     * @param non_random_ratio Ratio of selecting actions in non-random manner.
+     * @param random_depth Depth of nodes to explore in random manner.
+     * @param seed Seed of random selections, so that a search is reproducible
+     * given the same seed, unless multiple threads search.
+     */
+    Searcher(
+        const float coeff_puct,
+        const int non_random_ratio,
+        const int random_depth,
+        const std::uint64_t seed = 0u)
+        : m_arena(), m_root(nullptr), m_coeff_puct(coeff_puct),
+          m_non_random_ratio(non_random_ratio), m_random_depth(random_depth),
+          m_batch_leaves(), m_batch_actions(), m_batch_turns(),
+          m_batch_hashes(), m_eval_cache(), m_stats(), m_discarded(nullptr), m_discarded_lock(), m_memory_budget(0u),
+          m_prune_lock(), m_random(seed), m_random_lock(),
+          m_visit_count_snapshot(), m_visit_count_snapshot_sum(0)
+    {
+    }
+    Searcher(const Searcher&) = delete;
+    Searcher& operator=(const Searcher&) = delete;
+
+    /**
+     * @brief Set a new game position to search, discarding the current tree
+     * in O(1). Memory of the discarded tree is reused for the new one.
+     */
+    void
+    set_game(const Game& g, const float value, const float* const policy_logits)
+    {
+        m_batch_leaves.clear();
+        m_batch_turns.clear();
+        m_batch_hashes.clear();
+        m_visit_count_snapshot.clear();
+        m_discarded = nullptr;
+        m_arena.reset();
+        m_root = NodeGM::create_root(
+            m_arena, g.get_legal_moves(), g.get_turn(), value, policy_logits);
+    }
+    int get_visit_count() const
+    {
+        return m_root->get_visit_count();
+    }
+
+    /**
+     * @brief Set a cache of evaluations to consult before returning a leaf
+     * for evaluation and to store evaluations into, or null to disable it.
+     * @note This must not be called while searching.
+     */
+    void set_eval_cache(std::shared_ptr<EvalCache> cache)
+    {
+        m_eval_cache = std::move(cache);
+    }
+    const std::shared_ptr<EvalCache>& get_eval_cache() const
+    {
+        return m_eval_cache;
+    }
+
+    /**
+     * @brief Start or stop collecting statistics of the search. Starting
+     * resets them.
+     * @note This must not be called while searching.
+     */
+    void set_stats_enabled(const bool enabled)
+    {
+        if (enabled)
+            m_stats = std::make_unique<SearchStats>();
+        else
+            m_stats = nullptr;
+    }
+
+    /**
+     * @brief Return statistics of the search, or null if not enabled.
+     */
+    SearchStats* get_stats()
+    {
+        return m_stats.get();
+    }
+    const SearchStats* get_stats() const
+    {
+        return m_stats.get();
+    }
+
+    /**
+     * @brief Select a leaf node to evaluate.
+     *
+     * @param [in,out] game Game position of the root. After the end, the
+     * position corresponds to the leaf node.
+     * @return Node<Game, Move>* Leaf node to evaluate, or null pointer if it
+     * is game end, if another thread is evaluating the leaf, or if the leaf
+     * is expanded from the evaluation cache.
+     */
+    NodeGM* select(Game& game)
+    {
+        Random random = fork_random();
+        return select(game, random);
+    }
+
+    /**
+     * @brief Select a leaf node to evaluate, using a generator the calling
+     * thread owns, e.g. one returned by `fork_random()`.
+     */
+    NodeGM* select(Game& game, Random& random)
+    {
+        bool is_expanded = false;
+        return select(game, random, is_expanded);
+    }
+    void simulate_expand_and_backprop(
+        NodeGM* const leaf,
+        const std::vector<Move>& actions,
+        const ColorEnum& turn,
+        const float value,
+        const float* const policy_logits)
+    {
+        prepare_expansion();
+        leaf->simulate_expand_and_backprop(
+            m_arena, actions, turn, value, policy_logits);
+        if (m_stats != nullptr)
+            SearchStats::add(m_stats->num_expanded);
+    }
+
+    /**
+     * @brief Expand a leaf node as `simulate_expand_and_backprop()` does,
+     * storing the evaluation into the evaluation cache if set.
+     *
+     * @param zobrist_hash Zobrist hash of the game position of the leaf.
+     */
+    void simulate_expand_and_backprop(
+        NodeGM* const leaf,
+        const std::vector<Move>& actions,
+        const ColorEnum& turn,
+        const float value,
+        const float* const policy_logits,
+        const std::uint64_t zobrist_hash)
+    {
+        if (m_eval_cache != nullptr) {
+            std::vector<float> probas(actions.size());
+            for (std::size_t ii = 0u; ii < actions.size(); ++ii)
+                probas[ii]
+                    = policy_logits[actions[ii].to_dlshogi_policy_index(turn)];
+            softmax(probas);
+            m_eval_cache->store(
+                zobrist_hash, value, probas.data(), probas.size());
+        }
+        simulate_expand_and_backprop(
+            leaf, actions, turn, value, policy_logits);
+    }
+    void simulate_mate_and_backprop(NodeGM* const leaf)
+    {
+        const uint num_mates = leaf->simulate_mate_and_backprop();
+        if (m_stats != nullptr)
+            SearchStats::add(m_stats->num_mates, num_mates);
+    }
+
+    /**
+     * @brief Select up to `k` distinct leaf nodes to evaluate at once.
+     * @details Selected leaves stay claimed until
+     * `simulate_expand_and_backprop_batch()`, so that their virtual losses
+     * drive the subsequent selections to other leaves. Leaves expanded from
+     * the evaluation cache count toward `k` without
+     * being returned. Selection gives up after `k` attempts not yielding a
+     * new leaf, e.g. because of collisions with leaves already in the batch
+     * or game ends.
+     * @note Only one batch may be pending at a time.
+     *
+     * @param game Game position of the root.
+     * @param k Maximum number of leaves to select.
+     * @param [out] feature_maps Buffer of shape `[k, ranks, files, channels]`
+     * to write feature maps of the selected leaves into.
+     * @return uint Number of selected leaves, whose feature maps are in the
+     * head of `feature_maps`.
+     */
+    uint select_batch(const Game& game, const uint k, float* const feature_maps)
+    {
+        return select_batch(game, k, feature_maps, select_root_by_puct);
+    }
+
+    /**
+     * @brief Expand the leaves selected by the last `select_batch()` and
+     * backpropagate their values.
+     *
+     * @param values Buffer of shape `[n]` of values of the leaves.
+     * @param policy_logits Buffer of shape `[n, num_dlshogi_policy]` of
+     * policy logits of the leaves, where `n` is the number of the leaves.
+     */
+    void simulate_expand_and_backprop_batch(
+        const float* const values, const float* const policy_logits)
+    {
+        constexpr uint policy_size = Game::num_dlshogi_policy();
+        ScopedTimer timer(m_stats ? &m_stats->backprop_ns : nullptr);
+        for (uint ii = 0u; ii < m_batch_leaves.size(); ++ii) {
+            simulate_expand_and_backprop(
+                m_batch_leaves[ii],
+                m_batch_actions[ii],
+                m_batch_turns[ii],
+                values[ii],
+                policy_logits + policy_size * ii,
+                m_batch_hashes[ii]);
+        }
+        m_batch_leaves.clear();
+        m_batch_turns.clear();
+        m_batch_hashes.clear();
+    }
+
+    /**
+     * @brief Search `n` times from the root, evaluating selected leaves in
+     * batches of up to `batch_size` by `evaluate`.
+     * @note If `evaluate` throws, the exception propagates leaving the last
+     * batch of leaves pending evaluation, so the tree should be discarded.
+     * Search stops before `n` selections if every selection collides with a
+     * leaf pending evaluation.
+     *
+     * @param game Game position of the root.
+     * @param n Number of selections.
+     * @param batch_size Maximum number of positions to evaluate at once.
+     * @param evaluate Function evaluating a batch of game positions.
+     * @param kldgain_threshold Search stops before `n` selections once
+     * `get_kldgain()` per visit falls below this value. Non-positive values
+     * disable the stopping.
+     * @param kldgain_interval Minimum number of visits between two checks of
+     * `get_kldgain()`.
+     */
+    void search(
+        const Game& game,
+        const int n,
+        const uint batch_size,
+        const Evaluator& evaluate,
+        const float kldgain_threshold = 0.f,
+        const int kldgain_interval = 100)
+    {
+        const int target = get_visit_count() + n;
+        if (kldgain_threshold > 0.f)
+            snapshot_visit_counts();
+        search_batches(
+            game,
+            batch_size,
+            evaluate,
+            [this, target, kldgain_threshold, kldgain_interval](uint k) {
+                const int visit_count = get_visit_count();
+                if ((kldgain_threshold > 0.f)
+                    && (get_visit_count_since_snapshot() >= kldgain_interval)) {
+                    if (is_converged(kldgain_threshold))
+                        return 0u;
+                    snapshot_visit_counts();
+                }
+                return std::min(
+                    k, static_cast<uint>(std::max(target - visit_count, 0)));
+            });
+    }
+
+    /**
+     * @brief Search from the root until `time_manager` tells the time is up,
+     * or until the remaining time cannot change the most visited action.
+     * @note See `search()` for the other parameters.
+     *
+     * @param time_manager Time manager started for this search.
+     */
+    void search(
+        const Game& game,
+        TimeManager& time_manager,
+        const uint batch_size,
+        const Evaluator& evaluate)
+    {
+        const int start = get_visit_count();
+        search_batches(
+            game, batch_size, evaluate, [this, start, &time_manager](uint k) {
+                const auto count
+                    = static_cast<std::uint64_t>(get_visit_count() - start);
+                if (time_manager.is_time_up(count))
+                    return 0u;
+                if (is_action_decided(time_manager.estimate_remaining_count()))
+                    return 0u;
+                return k;
+            });
+    }
+
+    /**
+     * @brief Search from the root until `is_stop_requested` becomes true,
+     * e.g. set by another thread. It is checked between batches.
+     * @note See `search()` for the other parameters.
+     */
+    void search_until(
+        const Game& game,
+        const std::atomic<bool>& is_stop_requested,
+        const uint batch_size,
+        const Evaluator& evaluate)
+    {
+        search_batches(
+            game, batch_size, evaluate, [&is_stop_requested](uint k) {
+                if (is_stop_requested.load(std::memory_order_relaxed))
+                    return 0u;
+                return k;
+            });
+    }
+
+    /**
+     * @brief Search from the root by Gumbel search instead of PUCT algorithm
+     * at the root, and return the action chosen.
+     * @details `params.num_sampled` actions are sampled without replacement
+     * by adding Gumbel noise to the logits of the prior probabilities. Then
+     * sequential halving repeats visiting each remaining action equally, and
+     * discarding the worse half by `gumbel + logit + sigma(completed_q)`
+     * until one action remains. Below the root, PUCT algorithm selects as
+     * usual. It takes about `n` visits in total, stopping as soon as the
+     * action is decided, so that it needs much fewer visits than PUCT
+     * algorithm to choose a good action.
+     * @note See `search()` for the other parameters, and `GumbelParams` for
+     * the reference.
+     *
+     * @param n Number of selections, at least one per sampled action.
+     * @param params Parameters of Gumbel search.
+     * @return Move Action chosen, or the default action if there are no legal
+     * actions.
+     */
+    Move search_gumbel(
+        const Game& game,
+        const int n,
+        const uint batch_size,
+        const Evaluator& evaluate,
+        const GumbelParams& params = GumbelParams())
+    {
+        const uint num = m_root->get_num_child();
+        if (num == 0u)
+            return Move();
+        const ChildrenGM& children = *m_root->children();
+        const int* const counts = children.visit_counts();
+
+        Random random = fork_random();
+        std::vector<float> scores(num);
+        std::vector<float> probas(num);
+        for (uint ii = 0u; ii < num; ++ii) {
+            probas[ii] = children.proba(ii);
+            scores[ii] = params.gumbel_scale * sample_gumbel(random)
+                         + gumbel_logit(probas[ii]);
+        }
+        std::vector<uint> candidates(num);
+        std::iota(candidates.begin(), candidates.end(), 0u);
+        const uint m = std::min(
+            {std::max(params.num_sampled, 1u),
+             num,
+             static_cast<uint>(std::max(n, 1))});
+        const auto by_score = [&scores](const uint a, const uint b) {
+            return scores[a] > scores[b];
+        };
+        std::partial_sort(
+            candidates.begin(),
+            candidates.begin() + m,
+            candidates.end(),
+            by_score);
+        candidates.resize(m);
+
+        const auto num_phases = static_cast<int>(num_halving_phases(m));
+        std::vector<float> completed_q(num);
+        std::vector<float> ranking(num);
+        while (candidates.size() > 1u) {
+            const auto size = static_cast<int>(candidates.size());
+            const int per_candidate = std::max(n / (num_phases * size), 1);
+            search_candidates(
+                game, candidates, per_candidate, batch_size, evaluate);
+
+            complete_q_values(
+                probas.data(),
+                counts,
+                children.q_values(),
+                num,
+                m_root->m_value,
+                completed_q.data());
+            const int max_visit_count = *std::max_element(counts, counts + num);
+            for (const uint ii : candidates)
+                ranking[ii] = scores[ii]
+                              + gumbel_sigma(
+                                  completed_q[ii], max_visit_count, params);
+            std::stable_sort(
+                candidates.begin(),
+                candidates.end(),
+                [&ranking](const uint a, const uint b) {
+                    return ranking[a] > ranking[b];
+                });
+            candidates.resize(candidates.size() - candidates.size() / 2u);
+        }
+        return children.actions()[candidates.front()];
+    }
+
+    /**
+     * @brief Return the improved policy of the children of the root, which is
+     * `softmax(logit + sigma(completed_q))`, e.g. as a training target of the
+     * policy after `search_gumbel()`.
+     * @note See `improved_policy()` for details.
+     *
+     * @return std::vector<float> Probabilities of the children of the root in
+     * the order of `get_root()->get_actions()`.
+     */
+    std::vector<float>
+    get_improved_policy(const GumbelParams& params = GumbelParams()) const
+    {
+        const uint num = m_root->get_num_child();
+        std::vector<float> out(num);
+        if (num == 0u)
+            return out;
+        const ChildrenGM& children = *m_root->children();
+        std::vector<float> probas(num);
+        for (uint ii = 0u; ii < num; ++ii)
+            probas[ii] = children.proba(ii);
+        improved_policy(
+            probas.data(),
+            children.visit_counts(),
+            children.q_values(),
+            num,
+            m_root->m_value,
+            params,
+            out.data());
+        return out;
+    }
+
+    /**
+     * @brief Take a snapshot of the visit counts of the children of the root,
+     * for `get_kldgain()` to compare with.
+     */
+    void snapshot_visit_counts()
+    {
+        const uint num = m_root->get_num_child();
+        m_visit_count_snapshot.resize(num);
+        m_visit_count_snapshot_sum = sum_child_visits();
+        if (num > 0u)
+            std::copy_n(
+                m_root->children()->visit_counts(),
+                num,
+                m_visit_count_snapshot.data());
+    }
+
+    /**
+     * @brief Return KL divergence of the visit distribution of the root at
+     * the last `snapshot_visit_counts()` from the current one, adding one to
+     * every count.
+     * @note It is infinity if no snapshot is taken since the root is set.
+     */
+    float get_kldgain() const
+    {
+        const uint num = m_root->get_num_child();
+        if ((num == 0u) || (m_visit_count_snapshot.size() != num))
+            return std::numeric_limits<float>::infinity();
+        const int* const counts = m_root->children()->visit_counts();
+        const int* const prev = m_visit_count_snapshot.data();
+        const auto n = static_cast<float>(num);
+        const float curr_norm = static_cast<float>(sum_child_visits()) + n;
+        const float prev_norm
+            = static_cast<float>(m_visit_count_snapshot_sum) + n;
+        float out = 0.f;
+        for (uint ii = 0u; ii < num; ++ii) {
+            const float c = static_cast<float>(counts[ii]) + 1.f;
+            const float p = static_cast<float>(prev[ii]) + 1.f;
+            out += c * std::log((c * prev_norm) / (p * curr_norm));
+        }
+        return out / curr_norm;
+    }
+
+    /**
+     * @brief Return the number of visits to the children of the root since
+     * the last `snapshot_visit_counts()`.
+     */
+    int get_visit_count_since_snapshot() const
+    {
+        return sum_child_visits() - m_visit_count_snapshot_sum;
+    }
+
+    /**
+     * @brief Whether `get_kldgain()` per visit since the last snapshot is
+     * below `threshold`.
+     */
+    bool is_converged(const float threshold) const
+    {
+        const int visits = get_visit_count_since_snapshot();
+        return get_kldgain() < threshold * static_cast<float>(visits);
+    }
+
+    /**
+     * @brief Whether the most visited action at the root stays the most
+     * visited after `n` more visits, wherever they go.
+     */
+    bool is_action_decided(const std::uint64_t n) const
+    {
+        const uint num = m_root->get_num_child();
+        if (num < 2u)
+            return true;
+        const int* const counts
+            = m_root->children()->visit_counts_excluding_random();
+        int first = 0;
+        int second = 0;
+        for (uint ii = 0u; ii < num; ++ii) {
+            const int c = counts[ii];
+            if (c > first) {
+                second = first;
+                first = c;
+            } else if (c > second) {
+                second = c;
+            }
+        }
+        return static_cast<std::uint64_t>(first - second) > n;
+    }
+    /**
+     * @brief Apply an action to the root in O(1) regardless of the size of
+     * the tree. Nodes discarded are returned to the arena little by little
+     * during the subsequent search, or by `reclaim()`.
+     */
+    Searcher<Game, Move, Layout>& apply(const Move& action)
+    {
+        m_visit_count_snapshot.clear();
+        ChildrenGM* const discarded = m_root->apply(action);
+        if (discarded != nullptr)
+            m_discarded = ChildrenGM::chain(discarded, m_discarded);
+        return *this;
+    }
+
+    /**
+     * @brief Return at most `max_blocks` blocks of nodes discarded by
+     * `apply()` to the arena, e.g. while waiting for the opponent.
+     */
+    void reclaim(const std::size_t max_blocks = SIZE_MAX)
+    {
+        std::lock_guard<SpinLock> lock(m_discarded_lock);
+        if (m_discarded != nullptr)
+            m_discarded = ChildrenGM::release(
+                m_arena, m_discarded, max_blocks);
+    }
+    const NodeGM* get_root() const
+    {
+        return m_root;
+    }
+
+    /**
+     * @brief Return number of bytes used by the tree, including the nodes
+     * discarded but not reclaimed yet.
+     */
+    std::size_t get_memory_usage() const
+    {
+        return m_arena.size() * sizeof(typename ChildrenGM::Line);
+    }
+
+    /**
+     * @brief Return number of bytes reserved for the tree, which are kept
+     * until the searcher is destroyed and reused for nodes of any size.
+     */
+    std::size_t get_memory_capacity() const
+    {
+        return m_arena.capacity() * sizeof(typename ChildrenGM::Line);
+    }
+
+    /**
+     * @brief Limit memory usage of the tree. Once the usage exceeds the
+     * budget, the least visited subtrees are pruned into leaf nodes keeping
+     * their statistics, so that the search goes on in fixed memory.
+     * @note This must not be called while searching.
+     *
+     * @param bytes Number of bytes the tree may use, or zero if unlimited.
+     */
+    void set_memory_budget(const std::size_t bytes)
+    {
+        m_memory_budget = bytes;
+    }
+    std::size_t get_memory_budget() const
+    {
+        return m_memory_budget;
+    }
+
+    /**
+     * @brief Prune the least visited subtrees until memory usage of the tree
+     * goes down to three quarters of the budget.
+     * @details Each subtree is turned into a leaf node keeping its statistics,
+     * which is expanded again when it is selected next time. Subtrees being
+     * visited by search threads are left as they are.
+     */
+    void prune()
+    {
+        struct Candidate
+        {
+            /**
+             * @brief Visit count capped by those of the ancestors, so that
+             * every node comes after its descendants when sorted.
+             */
+            int visit_count;
+            int depth;
+            NodeGM* node;
+            ChildrenGM* children;
+        };
+
+        reclaim();
+        const std::size_t target = m_memory_budget - m_memory_budget / 4u;
+        if ((get_memory_usage() > target) && (m_root->children() != nullptr)) {
+            std::vector<Candidate> candidates;
+            std::vector<Candidate> stack{Candidate{
+                std::numeric_limits<int>::max(),
+                0,
+                m_root,
+                m_root->children()}};
+            while (!stack.empty()) {
+                const Candidate c = stack.back();
+                stack.pop_back();
+                std::lock_guard<SpinLock> lock(c.node->m_lock);
+                for (uint ii = c.children->size(); ii--;) {
+                    NodeGM* const node = c.children->find_node(ii);
+                    if (node == nullptr)
+                        continue;
+                    ChildrenGM* const grandchildren = node->children();
+                    if (grandchildren == nullptr)
+                        continue;
+                    const auto ch = Candidate{
+                        std::min(c.visit_count, node->get_visit_count()),
+                        c.depth + 1,
+                        node,
+                        grandchildren};
+                    candidates.emplace_back(ch);
+                    stack.emplace_back(ch);
+                }
+            }
+            std::sort(
+                candidates.begin(),
+                candidates.end(),
+                [](const Candidate& a, const Candidate& b) {
+                    return (a.visit_count < b.visit_count)
+                           || ((a.visit_count == b.visit_count)
+                               && (a.depth > b.depth));
+                });
+            for (const auto& c : candidates) {
+                if (get_memory_usage() <= target)
+                    break;
+                ChildrenGM* detached = nullptr;
+                {
+                    std::lock_guard<SpinLock> lock(c.node->guard());
+                    detached = c.node->collapse();
+                }
+                if (detached != nullptr)
+                    ChildrenGM::release(m_arena, detached);
+            }
+        }
+    }
+    Move get_action_by_visit_max() const
+    {
+        const NodeGM* const root = m_root;
+        if (root->m_most_visited_child == 0u)
+            return Move();
+        else
+            return root->children()->actions()[root->m_most_visited_child - 1u];
+    }
+    Move get_action_by_visit_distribution(const float temperature) const
+    {
+        Random random = fork_random();
+        return get_root_stats().get_action_by_visit_distribution(
+            temperature, random);
+    }
+
+    /**
+     * @brief Return statistics of the children of the root, e.g. to merge
+     * with those of other searchers of the same root.
+     */
+    RootStats<Move> get_root_stats() const
+    {
+        using Entry = typename RootStats<Move>::Entry;
+        const uint num = m_root->get_num_child();
+        std::vector<Entry> entries;
+        entries.reserve(num);
+        if (num > 0u) {
+            const auto* const children = m_root->children();
+            for (uint ii = 0u; ii < num; ++ii) {
+                entries.emplace_back(Entry{
+                    children->actions()[ii],
+                    children->visit_counts()[ii],
+                    children->visit_counts_excluding_random()[ii],
+                    -children->q_values()[ii]});
+            }
+        }
+        return RootStats<Move>(std::move(entries));
+    }
+
+    /**
+     * @brief Return a new generator for a search thread, seeded by the one
+     * of this searcher.
+     */
+    Random fork_random() const
+    {
+        std::lock_guard<SpinLock> lock(m_random_lock);
+        return m_random.fork();
+    }
+
+private:
+    /**
+     * @brief Select a leaf node to evaluate.
+     *
+     * @param [out] is_expanded Whether the leaf is expanded right away from
+     * the evaluation cache, in which case null
+     * pointer is returned.
+     * @param [in] root_index Index of the child of the root to descend to
+     * first, or negative to select it by PUCT algorithm.
+     */
+    NodeGM* select(
+        Game& game,
+        Random& random,
+        bool& is_expanded,
+        const int root_index = -1)
+    {
+        NodeGM* const leaf = m_root->select(
+            game,
+            m_coeff_puct,
+            m_non_random_ratio,
+            m_random_depth,
+            random,
+            m_stats.get(),
+            root_index);
+        if (leaf == nullptr)
+            return nullptr;
+
+        if (m_eval_cache != nullptr) {
+            float value = 0.f;
+            std::vector<float> probas;
+            const auto& actions = game.get_legal_moves();
+            if (m_eval_cache->lookup(game.get_zobrist_hash(), value, probas)
+                && (probas.size() == actions.size())) {
+                prepare_expansion();
+                leaf->simulate_expand_and_backprop_with_probas(
+                    m_arena, actions, value, probas.data());
+                if (m_stats != nullptr)
+                    SearchStats::add(m_stats->num_cache_hits);
+                is_expanded = true;
+                return nullptr;
+            }
+        }
+        return leaf;
+    }
+
+    /**
+     * @brief Select leaf nodes as `select_batch()` does, descending from the
+     * child of the root of index `root_index()` for each selection, or by PUCT
+     * algorithm if it is negative.
+     */
+    template <class RootIndex>
+    uint select_batch(
+        const Game& game,
+        const uint k,
+        float* const feature_maps,
+        RootIndex root_index)
+    {
+        constexpr uint feature_size
+            = Game::ranks() * Game::files() * Game::feature_channels();
+        m_batch_leaves.clear();
+        m_batch_turns.clear();
+        m_batch_hashes.clear();
+        Random random = fork_random();
+
+        // Go down from and back up to the root on one game instead of copying
+        // the root game for every selection.
+        auto g = Game(game);
+        const std::size_t root_length = g.record_length();
+        SearchStats* const stats = m_stats.get();
+        for (uint num_failed = 0u, num_expanded = 0u;
+             (m_batch_leaves.size() + num_expanded < k) && (num_failed < k);) {
+            bool is_expanded = false;
+            NodeGM* leaf = nullptr;
+            {
+                ScopedTimer timer(stats ? &stats->selection_ns : nullptr);
+                leaf = select(g, random, is_expanded, root_index());
+            }
+            if (is_expanded) {
+                ++num_expanded;
+            } else if (leaf == nullptr) {
+                ++num_failed;
+            } else {
+                const std::size_t index = m_batch_leaves.size();
+                ScopedTimer timer(stats ? &stats->feature_ns : nullptr);
+                g.to_feature_map(feature_maps + feature_size * index);
+                if (m_batch_actions.size() == index)
+                    m_batch_actions.emplace_back();
+                const auto& actions = g.get_legal_moves();
+                m_batch_actions[index].assign(actions.cbegin(), actions.cend());
+                m_batch_turns.emplace_back(g.get_turn());
+                m_batch_hashes.emplace_back(g.get_zobrist_hash());
+                m_batch_leaves.emplace_back(leaf);
+            }
+            while (g.record_length() > root_length)
+                g.undo_mcts_internal_vertex();
+        }
+        return static_cast<uint>(m_batch_leaves.size());
+    }
+
+    /**
+     * @brief Make room for a leaf node to expand, by returning some of the
+     * discarded nodes to the arena, and by pruning the tree if over budget.
+     */
+    void prepare_expansion()
+    {
+        reclaim(num_reclaim_per_expansion);
+        if ((m_memory_budget == 0u) || (get_memory_usage() <= m_memory_budget))
+            return;
+        std::unique_lock<SpinLock> lock(m_prune_lock, std::try_to_lock);
+        if (lock.owns_lock())
+            prune();
+    }
+
+    int sum_child_visits() const
+    {
+        const uint num = m_root->get_num_child();
+        if (num == 0u)
+            return 0;
+        const int* const counts = m_root->children()->visit_counts();
+        int out = 0;
+        for (uint ii = 0u; ii < num; ++ii)
+            out += counts[ii];
+        return out;
+    }
+
+    static int select_root_by_puct()
+    {
+        return -1;
+    }
+
+    /**
+     * @brief Visit each of the children of the root of indices `candidates`
+     * `n` more times, taking turns among those short of visits.
+     */
+    void search_candidates(
+        const Game& game,
+        const std::vector<uint>& candidates,
+        const int n,
+        const uint batch_size,
+        const Evaluator& evaluate)
+    {
+        const int* const counts = m_root->children()->visit_counts();
+        const std::size_t size = candidates.size();
+        std::vector<int> targets(size);
+        for (std::size_t ii = 0u; ii < size; ++ii)
+            targets[ii] = counts[candidates[ii]] + n;
+        const auto shortage = [counts, &candidates, &targets, size]() {
+            int out = 0;
+            for (std::size_t ii = 0u; ii < size; ++ii)
+                out += std::max(targets[ii] - counts[candidates[ii]], 0);
+            return out;
+        };
+
+        // A selection colliding with a leaf pending evaluation does not count
+        // as a visit, so the next candidate short of visits is tried instead.
+        std::size_t cursor = 0u;
+        search_batches(
+            game,
+            batch_size,
+            evaluate,
+            [&shortage](uint k) {
+                return std::min(k, static_cast<uint>(shortage()));
+            },
+            [counts, &candidates, &targets, size, &cursor]() {
+                for (std::size_t ii = 0u; ii < size; ++ii) {
+                    const std::size_t c = (cursor + ii) % size;
+                    if (counts[candidates[c]] < targets[c]) {
+                        cursor = (c + 1u) % size;
+                        return static_cast<int>(candidates[c]);
+                    }
+                }
+                // Visits to game ends may exceed the targets within a batch.
+                return static_cast<int>(candidates[cursor]);
+            });
+    }
+
+    /**
+     * @brief Repeat selecting a batch of leaves, evaluating, and expanding
+     * them while `next_batch_size(batch_size)` returns positive batch sizes,
+     * or until no selection reaches a leaf not pending evaluation.
+     */
+    template <class NextBatchSize>
+    void search_batches(
+        const Game& game,
+        const uint batch_size,
+        const Evaluator& evaluate,
+        NextBatchSize next_batch_size)
+    {
+        search_batches(
+            game, batch_size, evaluate, next_batch_size, select_root_by_puct);
+    }
+
+    /**
+     * @brief Search in batches as the other overload does, descending from
+     * the child of the root of index `root_index()` for each selection.
+     */
+    template <class NextBatchSize, class RootIndex>
+    void search_batches(
+        const Game& game,
+        uint batch_size,
+        const Evaluator& evaluate,
+        NextBatchSize next_batch_size,
+        RootIndex root_index)
+    {
+        constexpr uint feature_size
+            = Game::ranks() * Game::files() * Game::feature_channels();
+        constexpr uint policy_size = Game::num_dlshogi_policy();
+        batch_size = std::max(batch_size, 1u);
+        std::vector<float> feature_maps(batch_size * feature_size);
+        std::vector<float> values(batch_size);
+        std::vector<float> policy_logits(batch_size * policy_size);
+
+        for (uint k; (k = next_batch_size(batch_size)) > 0u;) {
+            const int visit_count = get_visit_count();
+            const uint num
+                = select_batch(game, k, feature_maps.data(), root_index);
+            if (num == 0u) {
+                // Every selection collided with a leaf pending evaluation,
+                // e.g. left by `select()` or by an evaluator having thrown,
+                // so that further batches cannot make any progress either.
+                if (get_visit_count() == visit_count)
+                    break;
+                continue;
+            }
+            if (m_stats != nullptr)
+                m_stats->add_batch(k, num);
+            {
+                ScopedTimer timer(m_stats ? &m_stats->evaluation_ns : nullptr);
+                evaluate(
+                    num,
+                    feature_maps.data(),
+                    values.data(),
+                    policy_logits.data());
+            }
+            simulate_expand_and_backprop_batch(
+                values.data(), policy_logits.data());
         }
-        return ch->m_action; // For numerical instability.
     }
+
 };
 
 } // namespace vshogi::engine::mcts
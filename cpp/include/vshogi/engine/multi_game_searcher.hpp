@@ -0,0 +1,306 @@
+#ifndef VSHOGI_ENGINE_MULTI_GAME_SEARCHER_HPP
+#define VSHOGI_ENGINE_MULTI_GAME_SEARCHER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "vshogi/common/result.hpp"
+#include "vshogi/engine/mcts.hpp"
+#include "vshogi/engine/root_stats.hpp"
+
+namespace vshogi::engine::mcts
+{
+
+/**
+ * @brief Driver of many games searched concurrently by Monte Carlo tree
+ * search, e.g. for self-play, evaluating leaves of all the games in one batch
+ * per step.
+ * @details Each game has a searcher of its own. Every `step()` selects
+ * leaves from all the games, evaluates them by one call of the evaluator,
+ * and expands them. Once the root of a game reaches the number of visits,
+ * an action is chosen, the game and its searcher advance by the action
+ * reusing the subtree, and the next search begins. Games ended, or reaching
+ * the maximum number of moves, are kept as records for `pop_records()` and
+ * restarted from the initial game position.
+ *
+ * Roots to set are evaluated in the same batch as the leaves of the other
+ * games, so that the evaluator is called once per step in the steady state.
+ */
+template <class Game, class Move, class Layout = DefaultLayout>
+class MultiGameSearcher
+{
+public:
+    using SearcherType = Searcher<Game, Move, Layout>;
+    using Evaluator = typename SearcherType::Evaluator;
+
+    /**
+     * @brief Statistics of the root of a game when an action is chosen.
+     */
+    struct Ply
+    {
+        Move action;
+        float value; //!< Value of the root by the evaluator.
+        float q_value; //!< Q-value of the root.
+        RootStats<Move> root_stats;
+    };
+
+    /**
+     * @brief Game played till the end, or till the maximum number of moves,
+     * and the statistics of each of its moves.
+     */
+    struct Record
+    {
+        Game game;
+        std::vector<Ply> plies;
+    };
+
+private:
+    struct Slot
+    {
+        std::unique_ptr<Game> game;
+        std::unique_ptr<SearcherType> searcher;
+        std::vector<Ply> plies;
+
+        /**
+         * @brief Whether the root of the searcher has to be set with the
+         * evaluation of the game position.
+         */
+        bool is_root_pending;
+
+        /**
+         * @brief Head of the leaves of this game in the batch of the current
+         * step, and the number of them.
+         */
+        uint batch_begin;
+        uint batch_size;
+    };
+
+    const Game m_initial;
+    const int m_num_searches;
+    const uint m_max_moves;
+    std::vector<Slot> m_slots;
+    std::vector<Record> m_records;
+
+    /**
+     * @brief Number of moves from the initial game position to choose actions
+     * by visit distribution with the temperature, instead of visit max.
+     */
+    uint m_num_random_moves;
+    float m_temperature;
+
+    std::vector<float> m_feature_maps;
+    std::vector<float> m_values;
+    std::vector<float> m_policy_logits;
+
+public:
+    /**
+     * @note See `Searcher` for the parameters of the searchers.
+     *
+     * @param initial Game position all the games start from.
+     * @param num_games Number of games to search concurrently.
+     * @param num_searches Number of visits to the root of a game before
+     * choosing an action, including those reused from the previous move.
+     * @param max_moves Maximum number of moves of a game, after which the game
+     * is recorded as it is.
+     * @param seed Seed of the searchers, each of which gets a different one.
+     */
+    MultiGameSearcher(
+        const Game& initial,
+        const uint num_games,
+        const int num_searches,
+        const uint max_moves,
+        const float coeff_puct,
+        const int non_random_ratio,
+        const int random_depth,
+        const std::uint64_t seed = 0u)
+        : m_initial(initial), m_num_searches(std::max(num_searches, 1)),
+          m_max_moves(max_moves), m_slots(), m_records(),
+          m_num_random_moves(0u), m_temperature(1.f), m_feature_maps(),
+          m_values(), m_policy_logits()
+    {
+        m_slots.reserve(num_games);
+        for (uint ii = 0u; ii < num_games; ++ii) {
+            m_slots.emplace_back(Slot{
+                std::make_unique<Game>(m_initial),
+                std::make_unique<SearcherType>(
+                    coeff_puct,
+                    non_random_ratio,
+                    random_depth,
+                    seed + ii),
+                {},
+                true,
+                0u,
+                0u});
+        }
+    }
+
+    /**
+     * @brief Choose actions by visit distribution with `temperature` for the
+     * first `num_moves` moves of every game, e.g. to diversify self-play.
+     */
+    void set_random_moves(const uint num_moves, const float temperature)
+    {
+        m_num_random_moves = num_moves;
+        m_temperature = temperature;
+    }
+
+    uint get_num_games() const
+    {
+        return static_cast<uint>(m_slots.size());
+    }
+    const Game& get_game(const uint index) const
+    {
+        return *m_slots[index].game;
+    }
+    SearcherType& get_searcher(const uint index)
+    {
+        return *m_slots[index].searcher;
+    }
+    const SearcherType& get_searcher(const uint index) const
+    {
+        return *m_slots[index].searcher;
+    }
+
+    /**
+     * @brief Number of records not popped yet.
+     */
+    std::size_t get_num_records() const
+    {
+        return m_records.size();
+    }
+
+    /**
+     * @brief Return the records of the games finished since the last call.
+     */
+    std::vector<Record> pop_records()
+    {
+        return std::exchange(m_records, {});
+    }
+
+    /**
+     * @brief Select leaves from all the games, evaluate them at once, expand
+     * them, and advance the games whose searches are done.
+     * @note If `evaluate` throws, the exception propagates leaving leaves
+     * pending evaluation, so the searcher should be discarded.
+     *
+     * @param evaluate Function evaluating a batch of game positions.
+     * @param leaves_per_game Maximum number of leaves to select per game.
+     * @return uint Number of game positions evaluated.
+     */
+    uint step(const Evaluator& evaluate, uint leaves_per_game = 1u)
+    {
+        constexpr uint feature_size
+            = Game::ranks() * Game::files() * Game::feature_channels();
+        constexpr uint policy_size = Game::num_dlshogi_policy();
+        leaves_per_game = std::max(leaves_per_game, 1u);
+        const std::size_t capacity = m_slots.size() * leaves_per_game;
+        if (m_values.size() < capacity) {
+            m_feature_maps.resize(capacity * feature_size);
+            m_values.resize(capacity);
+            m_policy_logits.resize(capacity * policy_size);
+        }
+
+        uint num = 0u;
+        for (Slot& s : m_slots) {
+            s.batch_begin = num;
+            if (s.is_root_pending) {
+                s.game->to_feature_map(
+                    m_feature_maps.data() + feature_size * num);
+                s.batch_size = 1u;
+            } else {
+                const int remaining = remaining_searches(s);
+                s.batch_size = s.searcher->select_batch(
+                    *s.game,
+                    std::min(leaves_per_game, static_cast<uint>(remaining)),
+                    m_feature_maps.data() + feature_size * num);
+            }
+            num += s.batch_size;
+        }
+        if (num > 0u)
+            evaluate(
+                num,
+                m_feature_maps.data(),
+                m_values.data(),
+                m_policy_logits.data());
+
+        for (Slot& s : m_slots) {
+            const float* const values = m_values.data() + s.batch_begin;
+            const float* const logits
+                = m_policy_logits.data() + policy_size * s.batch_begin;
+            if (s.is_root_pending) {
+                s.searcher->set_game(*s.game, *values, logits);
+                s.is_root_pending = false;
+            } else if (s.batch_size > 0u) {
+                s.searcher->simulate_expand_and_backprop_batch(values, logits);
+            }
+            if (is_search_done(s))
+                advance(s);
+        }
+        return num;
+    }
+
+private:
+    int remaining_searches(const Slot& s) const
+    {
+        return std::max(m_num_searches + 1 - s.searcher->get_visit_count(), 0);
+    }
+
+    bool is_search_done(const Slot& s) const
+    {
+        if (s.is_root_pending)
+            return false;
+        // The only legal move needs no search.
+        return (s.searcher->get_root()->get_num_child() < 2u)
+               || (remaining_searches(s) == 0);
+    }
+
+    /**
+     * @brief Apply the action chosen by the search, and record and restart
+     * the game if it is over.
+     */
+    void advance(Slot& s)
+    {
+        SearcherType& searcher = *s.searcher;
+        const auto* const root = searcher.get_root();
+        if (root->get_num_child() == 0u) { // No legal moves to begin with.
+            restart(s);
+            return;
+        }
+        Move action;
+        if (root->get_num_child() == 1u) // Searched without any visits.
+            action = root->get_actions().front();
+        else if (s.game->record_length() < m_num_random_moves)
+            action = searcher.get_action_by_visit_distribution(m_temperature);
+        else
+            action = searcher.get_action_by_visit_max();
+        s.plies.emplace_back(Ply{
+            action,
+            root->get_value(),
+            root->get_q_value(),
+            searcher.get_root_stats()});
+
+        s.game->apply(action);
+        if ((s.game->get_result() != ResultEnum::ONGOING)
+            || (s.game->record_length() >= m_max_moves)) {
+            restart(s);
+            return;
+        }
+        searcher.apply(action);
+        s.is_root_pending = (searcher.get_root()->get_num_child() == 0u);
+    }
+
+    void restart(Slot& s)
+    {
+        m_records.emplace_back(
+            Record{std::move(*s.game), std::exchange(s.plies, {})});
+        s.game = std::make_unique<Game>(m_initial);
+        s.is_root_pending = true;
+    }
+};
+
+} // namespace vshogi::engine::mcts
+
+#endif // VSHOGI_ENGINE_MULTI_GAME_SEARCHER_HPP
@@ -0,0 +1,82 @@
+#ifndef VSHOGI_ENGINE_NODE_LAYOUT_HPP
+#define VSHOGI_ENGINE_NODE_LAYOUT_HPP
+
+#include <cstdint>
+
+#include "vshogi/engine/half.hpp"
+
+namespace vshogi::engine::mcts
+{
+
+/**
+ * @brief Layout of statistics of child nodes in full precision.
+ */
+struct FullLayout
+{
+    using Proba = float;
+    using VirtualLoss = int;
+
+    /**
+     * @brief Whether mate flags are packed in bits, nodes and blocks of child
+     * nodes are referred to by their 32-bit indices in the arena instead of
+     * pointers, and two sibling nodes share a line.
+     */
+    static constexpr bool is_compact = false;
+
+    static Proba encode_proba(const float p)
+    {
+        return p;
+    }
+    static float decode_proba(const Proba p)
+    {
+        return p;
+    }
+};
+
+/**
+ * @brief Compact layout of statistics of child nodes for large trees, e.g.
+ * of long analyses.
+ * @details Compared with `FullLayout`, the statistics of a shogi child take
+ * 22 bytes instead of 31, and a node takes half a line instead of a whole
+ * one, so that a tree of shogi searched 10000 times takes 24% fewer bytes.
+ * - Prior probabilities are in IEEE 754 half precision.
+ * - Virtual losses are in 16 bits, so that at most 32767 visits may be in
+ * flight through a child at once.
+ * - Mate flags are packed in bits.
+ * - Nodes and blocks of child nodes are referred to by 32-bit indices in the
+ * arena, so that two sibling nodes fit in a line.
+ *
+ * Visit counts and Q-values stay in 32 bits, because they are updated by
+ * every visit, and a Q-value in 16 bits would stop moving after a few
+ * thousand visits.
+ */
+struct CompactLayout
+{
+    using Proba = std::uint16_t;
+    using VirtualLoss = std::int16_t;
+
+    static constexpr bool is_compact = true;
+
+    static Proba encode_proba(const float p)
+    {
+        return to_half(p);
+    }
+    static float decode_proba(const Proba p)
+    {
+        return from_half(p);
+    }
+};
+
+/**
+ * @brief Layout searchers use unless specified, which is `CompactLayout` if
+ * `VSHOGI_ENGINE_COMPACT_NODE` is defined for the whole build.
+ */
+#ifdef VSHOGI_ENGINE_COMPACT_NODE
+using DefaultLayout = CompactLayout;
+#else
+using DefaultLayout = FullLayout;
+#endif
+
+} // namespace vshogi::engine::mcts
+
+#endif // VSHOGI_ENGINE_NODE_LAYOUT_HPP
@@ -0,0 +1,259 @@
+#ifndef VSHOGI_ENGINE_PIPELINE_HPP
+#define VSHOGI_ENGINE_PIPELINE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "vshogi/engine/mcts.hpp"
+
+namespace vshogi::engine::mcts
+{
+
+/**
+ * @brief Monte Carlo tree search pipelining selection of leaves and their
+ * evaluation.
+ * @details Search threads push leaves pending evaluation onto a queue and go
+ * on selecting other leaves, while a dedicated evaluator thread drains the
+ * queue in batches and expands the leaves. Tree work of the search threads
+ * therefore overlaps with inference of the evaluator.
+ */
+template <class Game, class Move>
+class Pipeline
+{
+public:
+    using Evaluator = typename Searcher<Game, Move>::Evaluator;
+
+private:
+    using NodeGM = Node<Game, Move>;
+
+    static constexpr uint feature_size
+        = Game::ranks() * Game::files() * Game::feature_channels();
+    static constexpr uint policy_size = Game::num_dlshogi_policy();
+
+    struct Request
+    {
+        NodeGM* leaf;
+        std::vector<Move> actions;
+        ColorEnum turn;
+        std::uint64_t zobrist_hash;
+        std::vector<float> feature_map;
+    };
+
+    Searcher<Game, Move>& m_searcher;
+    const Evaluator m_evaluator;
+    const uint m_batch_size;
+
+    /**
+     * @brief Maximum number of leaves either in the queue or being evaluated.
+     * Search threads wait for evaluation when they reach this limit.
+     */
+    const uint m_max_pending;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv_requested;
+    std::condition_variable m_cv_evaluated;
+    std::deque<Request> m_queue;
+    uint m_num_pending;
+    bool m_is_stopped;
+    std::exception_ptr m_error;
+
+    std::thread m_thread;
+
+public:
+    /**
+     * @param searcher Searcher whose tree to search. It must outlive the
+     * pipeline.
+     * @param evaluator Function evaluating a batch of game positions. It is
+     * called from the evaluator thread only.
+     * @param batch_size Maximum number of positions to evaluate at once.
+     * @param max_pending Maximum number of leaves pending evaluation.
+     */
+    Pipeline(
+        Searcher<Game, Move>& searcher,
+        Evaluator evaluator,
+        const uint batch_size,
+        const uint max_pending)
+        : m_searcher(searcher), m_evaluator(std::move(evaluator)),
+          m_batch_size(std::max(batch_size, 1u)),
+          m_max_pending(std::max(max_pending, batch_size)), m_mutex(),
+          m_cv_requested(), m_cv_evaluated(), m_queue(), m_num_pending(0u),
+          m_is_stopped(false), m_error(), m_thread()
+    {
+        m_thread = std::thread([this]() { evaluate_loop(); });
+    }
+
+    // Rules of 5
+    ~Pipeline() // 1/5 destructor
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_is_stopped = true;
+        }
+        m_cv_requested.notify_all();
+        m_thread.join();
+    }
+    Pipeline(const Pipeline& other) = delete; // 2/5 copy constructor
+    Pipeline& operator=(const Pipeline& other) = delete; // 3/5 copy assignment
+    Pipeline(Pipeline&& other) = delete; // 4/5 move constructor
+    Pipeline& operator=(Pipeline&& other) = delete; // 5/5 move assignment
+
+    /**
+     * @brief Select leaves `n` times from multiple threads, and return after
+     * all the selected leaves are evaluated.
+     * @note If the evaluator throws, search stops and the exception is
+     * rethrown here. Leaves left pending evaluation are never selected again
+     * in that case, so both the pipeline and the tree should be discarded.
+     *
+     * @param game Game position of the root.
+     * @param n Number of selections.
+     * @param num_threads Number of search threads.
+     */
+    void search(const Game& game, const int n, const uint num_threads)
+    {
+        std::atomic<int> num_remaining(n);
+        std::vector<std::thread> threads;
+        for (uint ii = std::max(num_threads, 1u); ii--;) {
+            threads.emplace_back([this,
+                                  &game,
+                                  &num_remaining,
+                                  random = m_searcher.fork_random()]() mutable {
+                // Each thread goes down and back up on its own game.
+                auto g = Game(game);
+                const std::size_t root_length = g.record_length();
+                SearchStats* const stats = m_searcher.get_stats();
+                while (num_remaining.fetch_sub(1) > 0) {
+                    NodeGM* leaf = nullptr;
+                    {
+                        ScopedTimer timer(
+                            stats ? &stats->selection_ns : nullptr);
+                        leaf = m_searcher.select(g, random);
+                    }
+                    const bool ok = (leaf == nullptr) || push(leaf, g);
+                    while (g.record_length() > root_length)
+                        g.undo_mcts_internal_vertex();
+                    if (!ok)
+                        return;
+                }
+            });
+        }
+        for (auto&& t : threads)
+            t.join();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv_evaluated.wait(
+            lock, [this]() { return (m_num_pending == 0u) || m_error; });
+        if (m_error)
+            std::rethrow_exception(m_error);
+    }
+
+private:
+    /**
+     * @brief Push a leaf onto the queue, waiting while too many leaves are
+     * pending evaluation.
+     * @return false if the evaluator has failed.
+     */
+    bool push(NodeGM* const leaf, const Game& game)
+    {
+        auto request = Request{
+            leaf,
+            game.get_legal_moves(),
+            game.get_turn(),
+            game.get_zobrist_hash(),
+            std::vector<float>(feature_size)};
+        {
+            SearchStats* const stats = m_searcher.get_stats();
+            ScopedTimer timer(stats ? &stats->feature_ns : nullptr);
+            game.to_feature_map(request.feature_map.data());
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv_evaluated.wait(lock, [this]() {
+                return (m_num_pending < m_max_pending) || m_error;
+            });
+            if (m_error)
+                return false;
+            m_queue.push_back(std::move(request));
+            ++m_num_pending;
+        }
+        m_cv_requested.notify_one();
+        return true;
+    }
+
+    void evaluate_loop()
+    {
+        std::vector<Request> batch;
+        std::vector<float> feature_maps(m_batch_size * feature_size);
+        std::vector<float> values(m_batch_size);
+        std::vector<float> policy_logits(m_batch_size * policy_size);
+        while (true) {
+            batch.clear();
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv_requested.wait(lock, [this]() {
+                    return !m_queue.empty() || m_is_stopped;
+                });
+                if (m_queue.empty())
+                    return;
+                while (!m_queue.empty() && (batch.size() < m_batch_size)) {
+                    batch.emplace_back(std::move(m_queue.front()));
+                    m_queue.pop_front();
+                }
+            }
+
+            const uint n = static_cast<uint>(batch.size());
+            SearchStats* const stats = m_searcher.get_stats();
+            if (stats != nullptr)
+                stats->add_batch(m_batch_size, n);
+            for (uint ii = 0u; ii < n; ++ii)
+                std::copy(
+                    batch[ii].feature_map.cbegin(),
+                    batch[ii].feature_map.cend(),
+                    feature_maps.data() + feature_size * ii);
+            try {
+                ScopedTimer timer(stats ? &stats->evaluation_ns : nullptr);
+                m_evaluator(
+                    n,
+                    feature_maps.data(),
+                    values.data(),
+                    policy_logits.data());
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_error = std::current_exception();
+                }
+                m_cv_evaluated.notify_all();
+                return;
+            }
+            {
+                ScopedTimer timer(stats ? &stats->backprop_ns : nullptr);
+                for (uint ii = 0u; ii < n; ++ii) {
+                    m_searcher.simulate_expand_and_backprop(
+                        batch[ii].leaf,
+                        batch[ii].actions,
+                        batch[ii].turn,
+                        values[ii],
+                        policy_logits.data() + policy_size * ii,
+                        batch[ii].zobrist_hash);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_num_pending -= n;
+            }
+            m_cv_evaluated.notify_all();
+        }
+    }
+};
+
+} // namespace vshogi::engine::mcts
+
+#endif // VSHOGI_ENGINE_PIPELINE_HPP
@@ -0,0 +1,135 @@
+#ifndef VSHOGI_ENGINE_PONDERER_HPP
+#define VSHOGI_ENGINE_PONDERER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <utility>
+
+#include "vshogi/engine/mcts.hpp"
+
+namespace vshogi::engine::mcts
+{
+
+/**
+ * @brief Monte Carlo tree search running on a background thread, e.g. during
+ * the opponent's turn.
+ * @details `start()` returns immediately and the search goes on until
+ * `stop()`. Then `Searcher::apply()` with the opponent's move keeps the
+ * subtree searched meanwhile.
+ * @note The searcher must not be used by other threads while pondering.
+ */
+template <class Game, class Move>
+class Ponderer
+{
+public:
+    using Evaluator = typename Searcher<Game, Move>::Evaluator;
+
+private:
+    Searcher<Game, Move>& m_searcher;
+    const Evaluator m_evaluator;
+    const uint m_batch_size;
+    std::atomic<bool> m_is_stop_requested;
+
+    /**
+     * @brief Whether the background thread is searching, which is cleared
+     * once it exits, e.g. because the evaluator has thrown.
+     */
+    std::atomic<bool> m_is_running;
+
+    std::exception_ptr m_error;
+    std::thread m_thread;
+
+public:
+    /**
+     * @param searcher Searcher whose tree to search. It must outlive the
+     * ponderer.
+     * @param evaluator Function evaluating a batch of game positions. It is
+     * called from the background thread only.
+     * @param batch_size Maximum number of positions to evaluate at once.
+     */
+    Ponderer(
+        Searcher<Game, Move>& searcher,
+        Evaluator evaluator,
+        const uint batch_size)
+        : m_searcher(searcher), m_evaluator(std::move(evaluator)),
+          m_batch_size(std::max(batch_size, 1u)), m_is_stop_requested(false),
+          m_is_running(false), m_error(), m_thread()
+    {
+    }
+
+    // Rules of 5
+    ~Ponderer() // 1/5 destructor
+    {
+        request_stop();
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+    Ponderer(const Ponderer& other) = delete; // 2/5 copy constructor
+    Ponderer& operator=(const Ponderer& other) = delete; // 3/5 copy assignment
+    Ponderer(Ponderer&& other) = delete; // 4/5 move constructor
+    Ponderer& operator=(Ponderer&& other) = delete; // 5/5 move assignment
+
+    /**
+     * @brief Start searching on a background thread, stopping the previous
+     * pondering if any.
+     *
+     * @param game Game position of the root of the searcher.
+     */
+    void start(const Game& game)
+    {
+        stop();
+        m_is_stop_requested.store(false);
+        m_is_running.store(true);
+        m_thread = std::thread([this, game]() {
+            try {
+                m_searcher.search_until(
+                    game, m_is_stop_requested, m_batch_size, m_evaluator);
+            } catch (...) {
+                m_error = std::current_exception();
+            }
+            m_is_running.store(false);
+        });
+    }
+
+    /**
+     * @brief Ask the background thread to stop after the current batch,
+     * without waiting for it.
+     */
+    void request_stop()
+    {
+        m_is_stop_requested.store(true);
+    }
+
+    /**
+     * @brief Stop the background thread, and wait for it.
+     * @note If the evaluator has thrown, the exception is rethrown here.
+     * Leaves pending evaluation are never selected again in that case, so
+     * the tree should be discarded.
+     */
+    void stop()
+    {
+        request_stop();
+        if (m_thread.joinable())
+            m_thread.join();
+        if (m_error) {
+            const auto error = std::exchange(m_error, nullptr);
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * @brief Whether the background thread is started and still searching.
+     * @note This turns false as soon as the thread exits, before `stop()`,
+     * e.g. if the evaluator has thrown.
+     */
+    bool is_pondering() const
+    {
+        return m_is_running.load();
+    }
+};
+
+} // namespace vshogi::engine::mcts
+
+#endif // VSHOGI_ENGINE_PONDERER_HPP
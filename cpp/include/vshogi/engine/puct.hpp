@@ -0,0 +1,429 @@
+#ifndef VSHOGI_ENGINE_PUCT_HPP
+#define VSHOGI_ENGINE_PUCT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "vshogi/common/utils.hpp"
+#include "vshogi/engine/half.hpp"
+
+#if defined(__GNUC__) && defined(__SSE2__)                                     \
+    && (defined(__x86_64__) || defined(__i386__))
+#define VSHOGI_ENGINE_PUCT_X86
+#include <immintrin.h>
+#endif
+
+namespace vshogi::engine::mcts
+{
+
+/**
+ * @brief Statistics of child nodes to compute PUCT scores of.
+ * @details Each pointer points to an array of `size` elements.
+ */
+struct PuctInputs
+{
+    const float* probas;
+    const int* visit_counts;
+    const float* q_values;
+    const bool* is_mate;
+
+    /**
+     * @brief Number of visits to each child in flight, each of which is
+     * regarded as a win of the child until its value is backpropagated.
+     */
+    const int* virtual_losses;
+
+    uint size;
+};
+
+/**
+ * @brief Statistics of child nodes in the compact layout to compute PUCT
+ * scores of.
+ * @details Same as `PuctInputs` except that `probas` are in IEEE 754 half
+ * precision, `is_mate` packs the flags of 64 children in each word, and
+ * `virtual_losses` are in 16 bits.
+ */
+struct CompactPuctInputs
+{
+    const std::uint16_t* probas;
+    const int* visit_counts;
+    const float* q_values;
+    const std::uint64_t* is_mate;
+    const std::int16_t* virtual_losses;
+    uint size;
+};
+
+/**
+ * @brief PUCT score of a child from the parent's point of view.
+ *
+ * @param coeff_puct Coefficient of PUCT algorithm.
+ * @param sqrt_visit_count_of_parent Square root of visit count of the parent.
+ * @param q_of_parent Q value of the parent, which is used for unvisited child.
+ * @param proba Probability to select the child.
+ * @param visit_count Visit count of the child.
+ * @param q_value Q value of the child from the child's point of view.
+ * @param is_mate True if the child is in mate or leads to mate.
+ * @param virtual_loss Number of visits to the child in flight.
+ * @return float PUCT score of the child.
+ */
+inline float puct_score_from_parent_view(
+    const float coeff_puct,
+    const float sqrt_visit_count_of_parent,
+    const float q_of_parent,
+    const float proba,
+    const int visit_count,
+    const float q_value,
+    const bool is_mate,
+    const int virtual_loss)
+{
+    float q = (visit_count == 0) ? q_of_parent : -q_value;
+    if ((virtual_loss > 0) && (!is_mate)) {
+        const auto n = static_cast<float>(visit_count);
+        const auto k = static_cast<float>(virtual_loss);
+        q = -((q_value * (n - k) + k) / n);
+    }
+    if (is_mate && (q_value < 0)) { // Mate to lose for the child.
+        const float p_plus_1 = proba + 1.f;
+        return (q + 2.f) + p_plus_1 * sqrt_visit_count_of_parent * coeff_puct;
+    }
+    const float u = proba * sqrt_visit_count_of_parent
+                    / static_cast<float>(1 + visit_count);
+    return q + u * coeff_puct;
+}
+
+/**
+ * @brief Continue searching the child of the max PUCT score from `begin`.
+ *
+ * @param [in] in Statistics of the children.
+ * @param [in] begin Index of the first child to search.
+ * @param [in,out] max_score Max score of the children before `begin`.
+ * @param [in,out] argmax Index of the child of `max_score`.
+ */
+inline void puct_argmax_scalar_from(
+    const PuctInputs& in,
+    const float coeff_puct,
+    const float sqrt_visit_count_of_parent,
+    const float q_of_parent,
+    const uint begin,
+    float& max_score,
+    uint& argmax)
+{
+    for (uint ii = begin; ii < in.size; ++ii) {
+        const float score = puct_score_from_parent_view(
+            coeff_puct,
+            sqrt_visit_count_of_parent,
+            q_of_parent,
+            in.probas[ii],
+            in.visit_counts[ii],
+            in.q_values[ii],
+            in.is_mate[ii],
+            in.virtual_losses[ii]);
+        if (score > max_score) {
+            max_score = score;
+            argmax = ii;
+        }
+    }
+}
+
+/**
+ * @brief Return index of the first child of the max PUCT score.
+ */
+inline uint puct_argmax_scalar(
+    const PuctInputs& in,
+    const float coeff_puct,
+    const float sqrt_visit_count_of_parent,
+    const float q_of_parent)
+{
+    float max_score = std::numeric_limits<float>::lowest();
+    uint out = 0u;
+    puct_argmax_scalar_from(
+        in,
+        coeff_puct,
+        sqrt_visit_count_of_parent,
+        q_of_parent,
+        0u,
+        max_score,
+        out);
+    return out;
+}
+
+#ifdef VSHOGI_ENGINE_PUCT_X86
+
+/**
+ * @brief Reduce lane-wise max scores to the first index of the max score.
+ */
+template <uint NumLanes>
+inline void puct_reduce_lanes(
+    const float (&scores)[NumLanes],
+    const int (&indices)[NumLanes],
+    float& max_score,
+    uint& argmax)
+{
+    for (uint ii = 0u; ii < NumLanes; ++ii) {
+        const auto index = static_cast<uint>(indices[ii]);
+        if ((scores[ii] > max_score)
+            || ((scores[ii] == max_score) && (index < argmax))) {
+            max_score = scores[ii];
+            argmax = index;
+        }
+    }
+}
+
+/**
+ * @brief Return index of the first child of the max PUCT score, computing
+ * scores of 4 children at a time with SSE2.
+ */
+inline uint puct_argmax_sse2(
+    const PuctInputs& in,
+    const float coeff_puct,
+    const float sqrt_visit_count_of_parent,
+    const float q_of_parent)
+{
+    const __m128 c = _mm_set1_ps(coeff_puct);
+    const __m128 sqrt_n = _mm_set1_ps(sqrt_visit_count_of_parent);
+    const __m128 q_parent = _mm_set1_ps(q_of_parent);
+    const __m128 sign = _mm_set1_ps(-0.f);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 two = _mm_set1_ps(2.f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128i zero_i = _mm_setzero_si128();
+    const __m128i one_i = _mm_set1_epi32(1);
+    const __m128i step = _mm_set1_epi32(4);
+
+    __m128 best_scores = _mm_set1_ps(std::numeric_limits<float>::lowest());
+    __m128i best_indices = _mm_setzero_si128();
+    __m128i indices = _mm_setr_epi32(0, 1, 2, 3);
+    uint ii = 0u;
+    for (; ii + 4u <= in.size; ii += 4u) {
+        const __m128 p = _mm_loadu_ps(in.probas + ii);
+        const __m128i n = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(in.visit_counts + ii));
+        const __m128 q = _mm_loadu_ps(in.q_values + ii);
+        int mate_bytes;
+        std::memcpy(&mate_bytes, in.is_mate + ii, sizeof(mate_bytes));
+        __m128i mate = _mm_cvtsi32_si128(mate_bytes);
+        mate = _mm_unpacklo_epi16(_mm_unpacklo_epi8(mate, zero_i), zero_i);
+        const __m128 is_mate = _mm_castsi128_ps(_mm_cmpgt_epi32(mate, zero_i));
+        const __m128i k = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(in.virtual_losses + ii));
+
+        const __m128 n_f = _mm_cvtepi32_ps(n);
+        const __m128 k_f = _mm_cvtepi32_ps(k);
+        const __m128 q_vl = _mm_div_ps(
+            _mm_add_ps(_mm_mul_ps(q, _mm_sub_ps(n_f, k_f)), k_f),
+            _mm_max_ps(n_f, one));
+        const __m128 has_vl = _mm_andnot_ps(
+            is_mate, _mm_castsi128_ps(_mm_cmpgt_epi32(k, zero_i)));
+        const __m128 q_child = _mm_or_ps(
+            _mm_and_ps(has_vl, q_vl), _mm_andnot_ps(has_vl, q));
+
+        const __m128 unvisited = _mm_castsi128_ps(_mm_cmpeq_epi32(n, zero_i));
+        const __m128 q_view = _mm_or_ps(
+            _mm_and_ps(unvisited, q_parent),
+            _mm_andnot_ps(unvisited, _mm_xor_ps(q_child, sign)));
+        const __m128 to_lose = _mm_and_ps(is_mate, _mm_cmplt_ps(q, zero));
+
+        const __m128 u = _mm_div_ps(
+            _mm_mul_ps(p, sqrt_n), _mm_cvtepi32_ps(_mm_add_epi32(n, one_i)));
+        const __m128 score_default = _mm_add_ps(q_view, _mm_mul_ps(u, c));
+        const __m128 score_to_lose = _mm_add_ps(
+            _mm_add_ps(q_view, two),
+            _mm_mul_ps(_mm_mul_ps(_mm_add_ps(p, one), sqrt_n), c));
+        const __m128 score = _mm_or_ps(
+            _mm_and_ps(to_lose, score_to_lose),
+            _mm_andnot_ps(to_lose, score_default));
+
+        const __m128 greater = _mm_cmpgt_ps(score, best_scores);
+        const __m128i greater_i = _mm_castps_si128(greater);
+        best_scores = _mm_or_ps(
+            _mm_and_ps(greater, score), _mm_andnot_ps(greater, best_scores));
+        best_indices = _mm_or_si128(
+            _mm_and_si128(greater_i, indices),
+            _mm_andnot_si128(greater_i, best_indices));
+        indices = _mm_add_epi32(indices, step);
+    }
+
+    float max_score = std::numeric_limits<float>::lowest();
+    uint out = 0u;
+    if (ii > 0u) {
+        float scores[4];
+        int lane_indices[4];
+        _mm_storeu_ps(scores, best_scores);
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(lane_indices), best_indices);
+        puct_reduce_lanes(scores, lane_indices, max_score, out);
+    }
+    puct_argmax_scalar_from(
+        in,
+        coeff_puct,
+        sqrt_visit_count_of_parent,
+        q_of_parent,
+        ii,
+        max_score,
+        out);
+    return out;
+}
+
+/**
+ * @brief Return index of the first child of the max PUCT score, computing
+ * scores of 8 children at a time with AVX2.
+ * @note Call this only if the CPU supports AVX2.
+ */
+__attribute__((target("avx2"))) inline uint puct_argmax_avx2(
+    const PuctInputs& in,
+    const float coeff_puct,
+    const float sqrt_visit_count_of_parent,
+    const float q_of_parent)
+{
+    const __m256 c = _mm256_set1_ps(coeff_puct);
+    const __m256 sqrt_n = _mm256_set1_ps(sqrt_visit_count_of_parent);
+    const __m256 q_parent = _mm256_set1_ps(q_of_parent);
+    const __m256 sign = _mm256_set1_ps(-0.f);
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256 two = _mm256_set1_ps(2.f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i zero_i = _mm256_setzero_si256();
+    const __m256i one_i = _mm256_set1_epi32(1);
+    const __m256i step = _mm256_set1_epi32(8);
+
+    __m256 best_scores = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+    __m256i best_indices = _mm256_setzero_si256();
+    __m256i indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    uint ii = 0u;
+    for (; ii + 8u <= in.size; ii += 8u) {
+        const __m256 p = _mm256_loadu_ps(in.probas + ii);
+        const __m256i n = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(in.visit_counts + ii));
+        const __m256 q = _mm256_loadu_ps(in.q_values + ii);
+        const __m256i mate = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in.is_mate + ii)));
+        const __m256 is_mate
+            = _mm256_castsi256_ps(_mm256_cmpgt_epi32(mate, zero_i));
+        const __m256i k = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(in.virtual_losses + ii));
+
+        const __m256 n_f = _mm256_cvtepi32_ps(n);
+        const __m256 k_f = _mm256_cvtepi32_ps(k);
+        const __m256 q_vl = _mm256_div_ps(
+            _mm256_add_ps(_mm256_mul_ps(q, _mm256_sub_ps(n_f, k_f)), k_f),
+            _mm256_max_ps(n_f, one));
+        const __m256 has_vl = _mm256_andnot_ps(
+            is_mate, _mm256_castsi256_ps(_mm256_cmpgt_epi32(k, zero_i)));
+        const __m256 q_child = _mm256_blendv_ps(q, q_vl, has_vl);
+
+        const __m256 unvisited
+            = _mm256_castsi256_ps(_mm256_cmpeq_epi32(n, zero_i));
+        const __m256 q_view = _mm256_blendv_ps(
+            _mm256_xor_ps(q_child, sign), q_parent, unvisited);
+        const __m256 to_lose
+            = _mm256_and_ps(is_mate, _mm256_cmp_ps(q, zero, _CMP_LT_OQ));
+
+        const __m256 u = _mm256_div_ps(
+            _mm256_mul_ps(p, sqrt_n),
+            _mm256_cvtepi32_ps(_mm256_add_epi32(n, one_i)));
+        const __m256 score_default = _mm256_add_ps(q_view, _mm256_mul_ps(u, c));
+        const __m256 score_to_lose = _mm256_add_ps(
+            _mm256_add_ps(q_view, two),
+            _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(p, one), sqrt_n), c));
+        const __m256 score
+            = _mm256_blendv_ps(score_default, score_to_lose, to_lose);
+
+        const __m256 greater = _mm256_cmp_ps(score, best_scores, _CMP_GT_OQ);
+        best_scores = _mm256_blendv_ps(best_scores, score, greater);
+        best_indices = _mm256_castps_si256(_mm256_blendv_ps(
+            _mm256_castsi256_ps(best_indices),
+            _mm256_castsi256_ps(indices),
+            greater));
+        indices = _mm256_add_epi32(indices, step);
+    }
+
+    float max_score = std::numeric_limits<float>::lowest();
+    uint out = 0u;
+    if (ii > 0u) {
+        float scores[8];
+        int lane_indices[8];
+        _mm256_storeu_ps(scores, best_scores);
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(lane_indices), best_indices);
+        puct_reduce_lanes(scores, lane_indices, max_score, out);
+    }
+    puct_argmax_scalar_from(
+        in,
+        coeff_puct,
+        sqrt_visit_count_of_parent,
+        q_of_parent,
+        ii,
+        max_score,
+        out);
+    return out;
+}
+
+#endif // VSHOGI_ENGINE_PUCT_X86
+
+/**
+ * @brief Return index of the first child of the max PUCT score using the
+ * fastest kernel the CPU supports.
+ *
+ * @param in Statistics of the children. `in.size` must be positive.
+ * @param coeff_puct Coefficient of PUCT algorithm.
+ * @param sqrt_visit_count_of_parent Square root of visit count of the parent.
+ * @param q_of_parent Q value of the parent.
+ * @return uint Index of the child to select.
+ */
+inline uint puct_argmax(
+    const PuctInputs& in,
+    const float coeff_puct,
+    const float sqrt_visit_count_of_parent,
+    const float q_of_parent)
+{
+#ifdef VSHOGI_ENGINE_PUCT_X86
+    using Kernel = uint (*)(const PuctInputs&, float, float, float);
+    static const Kernel kernel = []() -> Kernel {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return &puct_argmax_avx2;
+        return &puct_argmax_sse2;
+    }();
+    return kernel(in, coeff_puct, sqrt_visit_count_of_parent, q_of_parent);
+#else
+    return puct_argmax_scalar(
+        in, coeff_puct, sqrt_visit_count_of_parent, q_of_parent);
+#endif
+}
+
+/**
+ * @brief Return index of the first child of the max PUCT score in the compact
+ * layout.
+ * @note Unlike `puct_argmax(const PuctInputs&, ...)`, this is not vectorized
+ * as the compact layout trades speed for memory.
+ */
+inline uint puct_argmax(
+    const CompactPuctInputs& in,
+    const float coeff_puct,
+    const float sqrt_visit_count_of_parent,
+    const float q_of_parent)
+{
+    float max_score = std::numeric_limits<float>::lowest();
+    uint out = 0u;
+    for (uint ii = 0u; ii < in.size; ++ii) {
+        const float score = puct_score_from_parent_view(
+            coeff_puct,
+            sqrt_visit_count_of_parent,
+            q_of_parent,
+            from_half(in.probas[ii]),
+            in.visit_counts[ii],
+            in.q_values[ii],
+            (in.is_mate[ii / 64u] >> (ii % 64u)) & 1u,
+            in.virtual_losses[ii]);
+        if (score > max_score) {
+            max_score = score;
+            out = ii;
+        }
+    }
+    return out;
+}
+
+} // namespace vshogi::engine::mcts
+
+#endif // VSHOGI_ENGINE_PUCT_HPP
@@ -0,0 +1,90 @@
+#ifndef VSHOGI_ENGINE_RANDOM_HPP
+#define VSHOGI_ENGINE_RANDOM_HPP
+
+#include <cstdint>
+#include <limits>
+
+namespace vshogi::engine
+{
+
+/**
+ * @brief Small and fast pseudo random number generator, xoshiro128++.
+ * It satisfies `UniformRandomBitGenerator` requirements so that it works with
+ * distributions of `<random>`.
+ * @note Unlike `std::random_device`, seeding is cheap and deterministic.
+ * An instance is not thread-safe, so that each thread should own one, e.g.
+ * created by `fork()`.
+ * @note https://prng.di.unimi.it/
+ */
+class Random
+{
+public:
+    using result_type = std::uint32_t;
+
+private:
+    std::uint32_t m_state[4];
+
+public:
+    explicit Random(std::uint64_t seed)
+    {
+        // Expand the seed by SplitMix64 so that the state is never all zero.
+        for (int ii = 0; ii < 4; ii += 2) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            std::uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= (z >> 31);
+            m_state[ii] = static_cast<std::uint32_t>(z);
+            m_state[ii + 1] = static_cast<std::uint32_t>(z >> 32);
+        }
+    }
+
+    static constexpr result_type min()
+    {
+        return std::numeric_limits<result_type>::min();
+    }
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+    result_type operator()()
+    {
+        std::uint32_t* const s = m_state;
+        const std::uint32_t out = rotl(s[0] + s[3], 7) + s[0];
+        const std::uint32_t t = s[1] << 9;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 11);
+        return out;
+    }
+
+    /**
+     * @brief Return a float uniformly distributed in [0, 1).
+     */
+    float uniform()
+    {
+        return static_cast<float>((*this)() >> 8) * 0x1.0p-24f;
+    }
+
+    /**
+     * @brief Return another generator seeded by this one, e.g. for a thread.
+     */
+    Random fork()
+    {
+        const auto hi = static_cast<std::uint64_t>((*this)());
+        return Random((hi << 32) | (*this)());
+    }
+
+private:
+    static std::uint32_t rotl(const std::uint32_t x, const int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+};
+
+} // namespace vshogi::engine
+
+#endif // VSHOGI_ENGINE_RANDOM_HPP
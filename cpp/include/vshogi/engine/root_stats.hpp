@@ -0,0 +1,192 @@
+#ifndef VSHOGI_ENGINE_ROOT_STATS_HPP
+#define VSHOGI_ENGINE_ROOT_STATS_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vshogi/common/utils.hpp"
+#include "vshogi/engine/random.hpp"
+
+namespace vshogi::engine::mcts
+{
+
+/**
+ * @brief Statistics of the children of a root node, which searchers of the
+ * same root merge for root parallelization.
+ * @details Independent searchers, e.g. with different seeds in different
+ * threads or processes, search the same root. Then merging their statistics
+ * sums up visit counts, and averages Q-values weighted by visit counts.
+ */
+template <class Move>
+class RootStats
+{
+public:
+    struct Entry
+    {
+        Move action;
+        int visit_count;
+        int visit_count_excluding_random;
+        float q_value; //!< Q-value of the action for the turn of the root.
+    };
+
+private:
+    /**
+     * @brief Number of bytes of an entry in `to_bytes()`, which are hash of
+     * the action, visit counts, and Q-value.
+     */
+    static constexpr std::size_t entry_bytes = 16u;
+
+    std::vector<Entry> m_entries;
+
+public:
+    RootStats() : m_entries()
+    {
+    }
+    explicit RootStats(std::vector<Entry> entries)
+        : m_entries(std::move(entries))
+    {
+    }
+    const std::vector<Entry>& get_entries() const
+    {
+        return m_entries;
+    }
+
+    /**
+     * @brief Merge statistics of another searcher of the same root. Actions
+     * missing in this are appended.
+     */
+    RootStats& merge(const RootStats& other)
+    {
+        std::unordered_map<std::uint32_t, std::size_t> indices;
+        indices.reserve(m_entries.size());
+        for (std::size_t ii = 0u; ii < m_entries.size(); ++ii)
+            indices.emplace(m_entries[ii].action.hash(), ii);
+        for (const Entry& e : other.m_entries) {
+            const auto it = indices.find(e.action.hash());
+            if (it == indices.cend()) {
+                m_entries.emplace_back(e);
+                continue;
+            }
+            Entry& self = m_entries[it->second];
+            const int n = self.visit_count + e.visit_count;
+            if (n > 0) {
+                const auto w = static_cast<float>(e.visit_count)
+                               / static_cast<float>(n);
+                self.q_value += w * (e.q_value - self.q_value);
+            }
+            self.visit_count = n;
+            self.visit_count_excluding_random
+                += e.visit_count_excluding_random;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Return the action visited most in non-random manner, or the
+     * default action if there are no actions.
+     */
+    Move get_action_by_visit_max() const
+    {
+        const Entry* best = nullptr;
+        for (const Entry& e : m_entries) {
+            if ((best == nullptr)
+                || (e.visit_count_excluding_random
+                    > best->visit_count_excluding_random))
+                best = &e;
+        }
+        return (best == nullptr) ? Move() : best->action;
+    }
+
+    /**
+     * @brief Sample an action in proportion to `(visit_count + 1) ^ (1 / T)`
+     * where the visit counts exclude random visits and `T` is `temperature`.
+     */
+    Move get_action_by_visit_distribution(
+        const float temperature, Random& random) const
+    {
+        constexpr float eps = 1.f;
+
+        const std::size_t num = m_entries.size();
+        if (num == 0u)
+            return Move();
+        std::vector<float> probas(num);
+        for (std::size_t ii = 0u; ii < num; ++ii) {
+            const auto v = static_cast<float>(
+                m_entries[ii].visit_count_excluding_random);
+            probas[ii] = std::log((v + eps)) / temperature;
+        }
+        softmax(probas);
+
+        float s = random.uniform();
+        for (std::size_t ii = 0u; ii < num; ++ii) {
+            const auto p = probas[ii];
+            if (s < p)
+                return m_entries[ii].action;
+            s -= p;
+        }
+        return m_entries[num - 1u].action; // For numerical instability.
+    }
+
+    /**
+     * @brief Serialize into bytes to send to another process.
+     * @note Numbers are in the native byte order, so the receiver should run
+     * on the same architecture.
+     */
+    std::string to_bytes() const
+    {
+        std::string out(m_entries.size() * entry_bytes, '\0');
+        char* p = out.data();
+        for (const Entry& e : m_entries) {
+            const auto hash = static_cast<std::uint32_t>(e.action.hash());
+            const auto v = static_cast<std::int32_t>(e.visit_count);
+            const auto v_excl
+                = static_cast<std::int32_t>(e.visit_count_excluding_random);
+            std::memcpy(p, &hash, 4u);
+            std::memcpy(p + 4, &v, 4u);
+            std::memcpy(p + 8, &v_excl, 4u);
+            std::memcpy(p + 12, &e.q_value, 4u);
+            p += entry_bytes;
+        }
+        return out;
+    }
+
+    /**
+     * @brief Deserialize bytes returned by `to_bytes()`.
+     * @throw std::invalid_argument if the size of the bytes is invalid.
+     */
+    static RootStats from_bytes(const std::string& bytes)
+    {
+        static_assert(sizeof(float) == 4u);
+        if (bytes.size() % entry_bytes != 0u)
+            throw std::invalid_argument("Invalid size of root stats bytes.");
+        const std::size_t num = bytes.size() / entry_bytes;
+        std::vector<Entry> entries;
+        entries.reserve(num);
+        const char* p = bytes.data();
+        for (std::size_t ii = 0u; ii < num; ++ii, p += entry_bytes) {
+            std::uint32_t hash;
+            std::int32_t v;
+            std::int32_t v_excl;
+            float q;
+            std::memcpy(&hash, p, 4u);
+            std::memcpy(&v, p + 4, 4u);
+            std::memcpy(&v_excl, p + 8, 4u);
+            std::memcpy(&q, p + 12, 4u);
+            entries.emplace_back(Entry{
+                Move(static_cast<decltype(Move().hash())>(hash)),
+                v,
+                v_excl,
+                q});
+        }
+        return RootStats(std::move(entries));
+    }
+};
+
+} // namespace vshogi::engine::mcts
+
+#endif // VSHOGI_ENGINE_ROOT_STATS_HPP
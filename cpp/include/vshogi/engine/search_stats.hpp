@@ -0,0 +1,143 @@
+#ifndef VSHOGI_ENGINE_SEARCH_STATS_HPP
+#define VSHOGI_ENGINE_SEARCH_STATS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+namespace vshogi::engine
+{
+
+/**
+ * @brief Counters describing where a Monte Carlo tree search spends its work
+ * and time.
+ * @details Counters are updated with relaxed atomic operations by any search
+ * thread, so that reading them while searching gives approximate values.
+ * Times are in nanoseconds summed over threads.
+ */
+struct SearchStats
+{
+    using Counter = std::atomic<std::uint64_t>;
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Number of bins of the depth histogram. Selections deeper than
+     * the last bin are counted in it.
+     */
+    static constexpr std::size_t num_depth_bins = 64u;
+
+    Counter num_selections{0u};
+    Counter num_collisions{0u}; //!< Selections of leaves pending evaluation.
+    Counter num_terminals{0u}; //!< Selections reaching game ends.
+    Counter num_mates{0u}; //!< Nodes proven to be mate by backpropagation.
+    Counter num_expanded{0u}; //!< Leaves expanded by evaluation.
+    Counter num_cache_hits{0u}; //!< Leaves expanded from evaluation cache.
+    Counter depth_histogram[num_depth_bins] = {};
+
+    Counter selection_ns{0u};
+    Counter feature_ns{0u}; //!< Time writing feature maps of leaves.
+    Counter evaluation_ns{0u}; //!< Time waiting for evaluators.
+    Counter backprop_ns{0u}; //!< Time expanding leaves and backpropagating.
+
+    Counter num_batches{0u};
+    Counter batch_capacity{0u}; //!< Sum of maximum sizes of the batches.
+    Counter batch_size{0u}; //!< Sum of numbers of leaves in the batches.
+
+    static void add(Counter& counter, const std::uint64_t n = 1u)
+    {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+    static std::uint64_t get(const Counter& counter)
+    {
+        return counter.load(std::memory_order_relaxed);
+    }
+
+    void add_depth(const std::size_t depth)
+    {
+        add(depth_histogram[std::min(depth, num_depth_bins - 1u)]);
+    }
+    void add_batch(const std::uint64_t capacity, const std::uint64_t size)
+    {
+        add(num_batches);
+        add(batch_capacity, capacity);
+        add(batch_size, size);
+    }
+
+    /**
+     * @brief Average ratio of the number of leaves in a batch to its maximum
+     * size, or zero if there are no batches.
+     */
+    double get_batch_fill_ratio() const
+    {
+        const auto capacity = get(batch_capacity);
+        if (capacity == 0u)
+            return 0.;
+        return static_cast<double>(get(batch_size))
+               / static_cast<double>(capacity);
+    }
+
+    /**
+     * @note This must not be called while searching.
+     */
+    void clear()
+    {
+        for (Counter* c : {&num_selections,
+                           &num_collisions,
+                           &num_terminals,
+                           &num_mates,
+                           &num_expanded,
+                           &num_cache_hits,
+                           &selection_ns,
+                           &feature_ns,
+                           &evaluation_ns,
+                           &backprop_ns,
+                           &num_batches,
+                           &batch_capacity,
+                           &batch_size})
+            c->store(0u, std::memory_order_relaxed);
+        for (Counter& c : depth_histogram)
+            c.store(0u, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Timer adding nanoseconds elapsed during its lifetime to a counter
+ * of `SearchStats`, which does nothing if the counter is null.
+ */
+class ScopedTimer
+{
+private:
+    SearchStats::Counter* const m_counter;
+    const SearchStats::Clock::time_point m_start;
+
+public:
+    explicit ScopedTimer(SearchStats::Counter* const counter)
+        : m_counter(counter),
+          m_start(
+              (counter == nullptr) ? SearchStats::Clock::time_point()
+                                   : SearchStats::Clock::now())
+    {
+    }
+
+    // Rules of 5
+    ~ScopedTimer() // 1/5 destructor
+    {
+        if (m_counter == nullptr)
+            return;
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            SearchStats::Clock::now() - m_start);
+        SearchStats::add(*m_counter, static_cast<std::uint64_t>(ns.count()));
+    }
+    ScopedTimer(const ScopedTimer& other) = delete; // 2/5 copy constructor
+    ScopedTimer&
+    operator=(const ScopedTimer& other) = delete; // 3/5 copy assignment
+    ScopedTimer(ScopedTimer&& other) = delete; // 4/5 move constructor
+    ScopedTimer& operator=(ScopedTimer&& other) = delete; // 5/5 move assign
+};
+
+} // namespace vshogi::engine
+
+#endif // VSHOGI_ENGINE_SEARCH_STATS_HPP
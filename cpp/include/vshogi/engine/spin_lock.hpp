@@ -0,0 +1,54 @@
+#ifndef VSHOGI_ENGINE_SPIN_LOCK_HPP
+#define VSHOGI_ENGINE_SPIN_LOCK_HPP
+
+#include <atomic>
+#include <thread>
+
+namespace vshogi::engine
+{
+
+/**
+ * @brief Lock for short critical sections, e.g. updating statistics of a
+ * node. It satisfies `Lockable` requirements so that it works with
+ * `std::lock_guard`.
+ * @note Unlike `std::mutex`, this is trivially destructible and small enough
+ * to be embedded in every node of a search tree.
+ */
+class SpinLock
+{
+private:
+    std::atomic<bool> m_locked;
+
+public:
+    SpinLock() : m_locked(false)
+    {
+    }
+
+    // Rules of 5
+    ~SpinLock() = default; // 1/5 destructor
+    SpinLock(const SpinLock& other) = delete; // 2/5 copy constructor
+    SpinLock& operator=(const SpinLock& other) = delete; // 3/5 copy assignment
+    SpinLock(SpinLock&& other) = delete; // 4/5 move constructor
+    SpinLock& operator=(SpinLock&& other) = delete; // 5/5 move assignment
+
+    void lock()
+    {
+        while (m_locked.exchange(true, std::memory_order_acquire)) {
+            while (m_locked.load(std::memory_order_relaxed))
+                std::this_thread::yield();
+        }
+    }
+    bool try_lock()
+    {
+        return !m_locked.load(std::memory_order_relaxed)
+               && !m_locked.exchange(true, std::memory_order_acquire);
+    }
+    void unlock()
+    {
+        m_locked.store(false, std::memory_order_release);
+    }
+};
+
+} // namespace vshogi::engine
+
+#endif // VSHOGI_ENGINE_SPIN_LOCK_HPP
@@ -0,0 +1,153 @@
+#ifndef VSHOGI_ENGINE_TIME_MANAGER_HPP
+#define VSHOGI_ENGINE_TIME_MANAGER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace vshogi::engine
+{
+
+/**
+ * @brief Wall-clock budget of a search.
+ * @details `is_time_up()` is meant to be called in every iteration of search
+ * loops. It reads the clock only every few milliseconds, predicting the
+ * number of iterations until then from the rate measured so far.
+ * @note An instance is not thread-safe.
+ */
+class TimeManager
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    /**
+     * @brief Maximum interval between two readings of the clock in seconds.
+     */
+    static constexpr double max_check_interval = 0.005;
+
+    const Clock::time_point m_start;
+    const Clock::time_point m_deadline;
+    const double m_check_interval;
+    std::uint64_t m_count_at_last_check;
+    std::uint64_t m_count_at_next_check;
+    double m_elapsed_at_last_check;
+    bool m_is_time_up;
+
+public:
+    /**
+     * @brief Start measuring time.
+     *
+     * @param budget Seconds to search for.
+     */
+    explicit TimeManager(const double budget)
+        : m_start(Clock::now()),
+          m_deadline(
+              m_start
+              + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(std::max(budget, 0.)))),
+          m_check_interval(std::min(max_check_interval, budget / 16.)),
+          m_count_at_last_check(0u), m_count_at_next_check(1u),
+          m_elapsed_at_last_check(0.), m_is_time_up(budget <= 0.)
+    {
+    }
+
+    /**
+     * @brief Start measuring time to spend on a move under a time control.
+     *
+     * @param remaining Seconds remaining on the clock of the player to move.
+     * @param byoyomi Seconds available for every move after `remaining` runs
+     * out.
+     * @param increment Seconds added to the clock after every move.
+     * @param moves_to_go Expected number of moves `remaining` has to cover.
+     * @param margin Seconds kept unused against communication delays etc.
+     * @return TimeManager Time manager with the budget for the move.
+     */
+    static TimeManager from_clock(
+        const double remaining,
+        const double byoyomi = 0.,
+        const double increment = 0.,
+        const int moves_to_go = 30,
+        const double margin = 0.1)
+    {
+        const double share = remaining / std::max(moves_to_go, 1);
+        const double budget = std::min(
+            share + byoyomi + increment, remaining + byoyomi);
+        return TimeManager(budget - margin);
+    }
+
+    /**
+     * @brief Whether the budget has run out.
+     *
+     * @param count Number of iterations done so far, e.g. nodes searched,
+     * which must not decrease between calls.
+     */
+    bool is_time_up(const std::uint64_t count)
+    {
+        if (m_is_time_up || (count < m_count_at_next_check))
+            return m_is_time_up;
+
+        const auto now = Clock::now();
+        m_is_time_up = (now >= m_deadline);
+        m_elapsed_at_last_check = seconds(now - m_start);
+        m_count_at_last_check = count;
+        const double rate = get_rate();
+        const double until_next
+            = std::min(m_check_interval, seconds(m_deadline - now));
+        // At most double the count until the next reading, as the rate
+        // measured by the first few iterations is noisy.
+        const auto predicted = static_cast<std::uint64_t>(rate * until_next);
+        m_count_at_next_check
+            = count + std::clamp(predicted, std::uint64_t{1}, count);
+        return m_is_time_up;
+    }
+
+    /**
+     * @brief Seconds elapsed since the start, as of the last clock reading.
+     */
+    double get_elapsed() const
+    {
+        return m_elapsed_at_last_check;
+    }
+
+    /**
+     * @brief Seconds left until the deadline, as of the last clock reading.
+     */
+    double get_remaining() const
+    {
+        return std::max(seconds(m_deadline - m_start) - get_elapsed(), 0.);
+    }
+
+    /**
+     * @brief Iterations per second measured so far, e.g. nodes per second.
+     */
+    double get_rate() const
+    {
+        if (m_elapsed_at_last_check <= 0.)
+            return 0.;
+        return static_cast<double>(m_count_at_last_check)
+               / m_elapsed_at_last_check;
+    }
+
+    /**
+     * @brief Number of iterations expected to be done in the remaining time,
+     * or the maximum value if the rate is not measured yet.
+     */
+    std::uint64_t estimate_remaining_count() const
+    {
+        if (m_elapsed_at_last_check <= 0.)
+            return std::numeric_limits<std::uint64_t>::max();
+        return static_cast<std::uint64_t>(get_rate() * get_remaining());
+    }
+
+private:
+    static double seconds(const Clock::duration& d)
+    {
+        return std::chrono::duration<double>(d).count();
+    }
+};
+
+} // namespace vshogi::engine
+
+#endif // VSHOGI_ENGINE_TIME_MANAGER_HPP
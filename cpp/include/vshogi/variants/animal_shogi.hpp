@@ -432,12 +432,14 @@ animal_shogi::Game::apply(const animal_shogi::Move& move)
     const auto illegal = !is_legal(move);
     m_zobrist_hash_list.emplace_back(m_zobrist_hash);
     m_move_list.emplace_back(move);
+    m_undo_list.emplace_back();
+    m_undo_list.back().result = m_result;
     if (!move.is_drop()) {
         const auto moving = get_board()[move.source_square()];
         const auto captured = get_board()[move.destination()];
         m_result = animal_shogi::internal::move_result(move, moving, captured);
     }
-    m_current_state.apply(move, &m_zobrist_hash);
+    m_current_state.apply(move, &m_zobrist_hash, &m_undo_list.back().state);
     if (illegal) {
         m_result = (get_turn() == BLACK) ? BLACK_WIN : WHITE_WIN;
         m_legal_moves.clear();
@@ -455,12 +457,14 @@ animal_shogi::Game::apply_nocheck(const animal_shogi::Move& move)
 {
     m_zobrist_hash_list.emplace_back(m_zobrist_hash);
     m_move_list.emplace_back(move);
+    m_undo_list.emplace_back();
+    m_undo_list.back().result = m_result;
     if (!move.is_drop()) {
         const auto moving = get_board()[move.source_square()];
         const auto captured = get_board()[move.destination()];
         m_result = animal_shogi::internal::move_result(move, moving, captured);
     }
-    m_current_state.apply(move, &m_zobrist_hash);
+    m_current_state.apply(move, &m_zobrist_hash, &m_undo_list.back().state);
     if (m_result == ONGOING) {
         update_internals();
     } else {
@@ -478,12 +482,14 @@ animal_shogi::Game::apply_mcts_internal_vertex(const animal_shogi::Move& move)
 
 template <>
 inline animal_shogi::Game::Game(const animal_shogi::State& s)
-    : m_current_state(s), m_zobrist_hash_list(), m_move_list(), m_legal_moves(),
-      m_result(ONGOING), m_zobrist_hash(m_current_state.zobrist_hash()),
+    : m_current_state(s), m_zobrist_hash_list(), m_move_list(),
+      m_undo_list(), m_legal_moves(), m_result(ONGOING),
+      m_zobrist_hash(m_current_state.zobrist_hash()),
       m_initial_sfen_without_ply(m_current_state.to_sfen())
 {
     m_zobrist_hash_list.reserve(128);
     m_move_list.reserve(128);
+    m_undo_list.reserve(128);
     update_internals();
 }
 
@@ -59,6 +59,7 @@ void export_animal_shogi(py::module& m)
 {
     as::Pieces::init_tables();
     as::Squares::init_tables();
+    as::Move::init_tables();
     as::BlackWhiteStands::init_tables();
     as::BitBoard::init_tables();
     as::Board::init_tables();
@@ -112,6 +112,7 @@ void export_minishogi(py::module& m)
 {
     ms::Pieces::init_tables();
     ms::Squares::init_tables();
+    ms::Move::init_tables();
     ms::BlackWhiteStands::init_tables();
     ms::BitBoard::init_tables();
     ms::Board::init_tables();
@@ -234,6 +234,7 @@ void export_shogi(py::module& m)
 {
     sg::Pieces::init_tables();
     sg::Squares::init_tables();
+    sg::Move::init_tables();
     sg::BlackWhiteStands::init_tables();
     sg::Board::init_tables();
     sg::BitBoard::init_tables();
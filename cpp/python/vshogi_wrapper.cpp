@@ -5,6 +5,8 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include "vshogi_wrapper.hpp"
+
 namespace py = pybind11;
 
 void export_animal_shogi(py::module& m);
@@ -31,6 +33,7 @@ PYBIND11_MODULE(_vshogi, m)
 {
     export_color_enum(m);
     export_result_enum(m);
+    pyvshogi::export_eval_cache(m);
 
     auto animal_shogi_module = m.def_submodule("animal_shogi");
     export_animal_shogi(animal_shogi_module);
@@ -3,9 +3,20 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 #include "vshogi/engine/dfpn.hpp"
+#include "vshogi/engine/eval_cache.hpp"
 #include "vshogi/engine/mcts.hpp"
+#include "vshogi/engine/multi_game_searcher.hpp"
+#include "vshogi/engine/pipeline.hpp"
+#include "vshogi/engine/ponderer.hpp"
+#include "vshogi/engine/root_stats.hpp"
+#include "vshogi/engine/search_stats.hpp"
+#include "vshogi/engine/time_manager.hpp"
 
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
@@ -81,7 +92,9 @@ inline void export_move(pybind11::module& m)
         .def("is_drop", &Move::is_drop)
         .def("rotate", &Move::rotate)
         .def("hflip", &Move::hflip)
-        .def("_to_dlshogi_policy_index", &Move::to_dlshogi_policy_index)
+        .def(
+            "_to_dlshogi_policy_index",
+            py::overload_cast<>(&Move::to_dlshogi_policy_index, py::const_))
         .def_static("_num_policy_per_square", &Move::num_policy_per_square)
         .def("__hash__", &Move::hash)
         .def(
@@ -139,11 +152,8 @@ inline void export_state(pybind11::module& m)
                 for (auto it = action_proba.begin(); it != action_proba.end();
                      ++it) {
                     const auto move = it->first.cast<Move>();
-                    const auto index
-                        = (turn == vshogi::BLACK)
-                              ? move.to_dlshogi_policy_index()
-                              : move.rotate().to_dlshogi_policy_index();
-                    data[index] = it->second.cast<float>();
+                    data[move.to_dlshogi_policy_index(turn)]
+                        = it->second.cast<float>();
                 }
                 return out;
             },
@@ -162,11 +172,8 @@ inline void export_state(pybind11::module& m)
                 for (auto it = action_proba.begin(); it != action_proba.end();
                      ++it) {
                     const auto move = it->first.cast<Move>();
-                    const auto index
-                        = (turn == vshogi::BLACK)
-                              ? move.to_dlshogi_policy_index()
-                              : move.rotate().to_dlshogi_policy_index();
-                    data[index] = it->second.cast<float>();
+                    data[move.to_dlshogi_policy_index(turn)]
+                        = it->second.cast<float>();
                 }
             },
             py::arg("action_proba"),
@@ -231,11 +238,8 @@ inline void export_game(pybind11::module& m)
                 for (auto it = visit_proba.begin(); it != visit_proba.end();
                      ++it) {
                     const auto move = it->first.cast<Move>();
-                    const auto index
-                        = (turn == vshogi::BLACK)
-                              ? move.to_dlshogi_policy_index()
-                              : move.rotate().to_dlshogi_policy_index();
-                    data[index] = it->second.cast<float>();
+                    data[move.to_dlshogi_policy_index(turn)]
+                        = it->second.cast<float>();
                 }
                 return out;
             })
@@ -243,17 +247,12 @@ inline void export_game(pybind11::module& m)
             "masked_softmax",
             [](const Game& self, const py::array_t<float>& logits) -> py::dict {
                 py::dict out;
-                const auto is_black_turn = (self.get_turn() == vshogi::BLACK);
+                const auto turn = self.get_turn();
                 const auto& actions = self.get_legal_moves();
                 auto proba = std::vector<float>(actions.size());
                 const auto data = logits.data();
-                for (std::size_t ii = actions.size(); ii--;) {
-                    const auto index
-                        = (is_black_turn)
-                              ? actions[ii].to_dlshogi_policy_index()
-                              : actions[ii].rotate().to_dlshogi_policy_index();
-                    proba[ii] = data[index];
-                }
+                for (std::size_t ii = actions.size(); ii--;)
+                    proba[ii] = data[actions[ii].to_dlshogi_policy_index(turn)];
                 vshogi::softmax(proba);
                 for (std::size_t ii = actions.size(); ii--;) {
                     out[py::cast(actions[ii])] = proba[ii];
@@ -287,33 +286,19 @@ inline void export_mcts_node(pybind11::module& m)
     using Node = vshogi::engine::mcts::Node<Game, Move>;
 
     py::class_<Node>(m, "MctsNode")
-        .def(
-            py::init([](const Game& g,
-                        const float v,
-                        const py::array_t<float>& logits) {
-                return Node(
-                    g.get_legal_moves(), g.get_turn(), v, logits.data());
-            }),
-            py::arg("game"),
-            py::arg("value"),
-            py::arg("policy_logits"))
         .def("get_visit_count", &Node::get_visit_count)
         .def(
             "get_visit_count_excluding_random",
             &Node::get_visit_count_excluding_random)
         .def("get_value", &Node::get_value)
         .def("get_q_value", &Node::get_q_value)
+        .def("get_actions", &Node::get_actions)
+        .def("get_probas", &Node::get_probas)
+        .def("get_visit_counts", &Node::get_visit_counts)
         .def(
-            "get_actions",
-            [](const Node& self) {
-                std::vector<Move> out;
-                out.reserve(self.get_num_child());
-                const Node* ch = self.get_child();
-                for (; ch != nullptr; ch = ch->get_sibling()) {
-                    out.emplace_back(ch->get_action());
-                }
-                return out;
-            })
+            "get_visit_counts_excluding_random",
+            &Node::get_visit_counts_excluding_random)
+        .def("get_q_values", &Node::get_q_values, py::arg("greedy_depth") = 0u)
         .def("get_proba", &Node::get_proba)
         .def(
             "get_child",
@@ -323,54 +308,77 @@ inline void export_mcts_node(pybind11::module& m)
                     return py::none();
                 return py::cast(*out, py::return_value_policy::reference);
             })
-        .def(
-            "simulate_expand_and_backprop",
-            [](Node& self,
-               const Game& game,
-               const float value,
-               const py::array_t<float>& policy_logits) {
-                const auto data = policy_logits.data();
-                self.simulate_expand_and_backprop(
-                    game.get_legal_moves(), game.get_turn(), value, data);
-            })
         .def("simulate_mate_and_backprop", &Node::simulate_mate_and_backprop)
-        .def(
-            "_select_node_to_explore",
-            [](Node& node,
-               Game& game,
-               const float coeff_puct,
-               const int non_random_ratio,
-               const int random_depth) -> py::object {
-                const auto out = node.select(
-                    game, coeff_puct, non_random_ratio, random_depth);
-                if (out == nullptr)
-                    return py::none();
-                return py::cast(*out, py::return_value_policy::reference);
-            })
         .def("get_action_by_proba_max", [](const Node& self) {
-            Move out{};
-            float max_proba = -1.f;
-            for (const Node* ch = self.get_child(); ch != nullptr;
-                 ch = ch->get_sibling()) {
-                const auto p = ch->get_proba();
-                if (p > max_proba) {
-                    max_proba = p;
-                    out = ch->get_action();
-                }
-            }
-            return out;
+            // Children are sorted in descending order of their probabilities.
+            const auto actions = self.get_actions();
+            return actions.empty() ? Move{} : actions.front();
         });
 }
 
+/**
+ * @brief Wrap a Python function evaluating a batch of feature maps so that
+ * C++ search calls it. The wrapper acquires the GIL while calling it, so that
+ * search may run with the GIL released.
+ */
+template <class Game>
+inline auto to_mcts_evaluator(const pybind11::function& batch_policy_value_func)
+{
+    namespace py = pybind11;
+    using Array
+        = py::array_t<float, py::array::c_style | py::array::forcecast>;
+    return [&batch_policy_value_func](
+               const uint k,
+               const float* const feature_maps,
+               float* const values,
+               float* const policy_logits) {
+        py::gil_scoped_acquire acquire;
+        const auto shape = std::vector<py::ssize_t>(
+            {static_cast<py::ssize_t>(k),
+             Game::ranks(),
+             Game::files(),
+             Game::feature_channels()});
+        const auto x = py::array_t<float>(shape, feature_maps);
+        const auto out = batch_policy_value_func(x).cast<py::tuple>();
+        const auto logits = out[0].cast<Array>();
+        const auto v = out[1].cast<Array>();
+        const auto num_policy
+            = static_cast<py::ssize_t>(Game::num_dlshogi_policy());
+        if ((logits.ndim() != 2) || (logits.shape(0) != shape[0])
+            || (logits.shape(1) != num_policy))
+            throw std::invalid_argument(
+                "Policy logits must be of shape [" + std::to_string(k) + ", "
+                + std::to_string(num_policy) + "].");
+        if ((v.ndim() != 1) || (v.shape(0) != shape[0]))
+            throw std::invalid_argument(
+                "Values must be of shape [" + std::to_string(k) + "].");
+        std::copy_n(
+            logits.data(), k * Game::num_dlshogi_policy(), policy_logits);
+        std::copy_n(v.data(), k, values);
+    };
+}
+
 template <class Game, class Move>
 inline void export_mcts_searcher(pybind11::module& m)
 {
     namespace py = pybind11;
     using Node = vshogi::engine::mcts::Node<Game, Move>;
     using Searcher = vshogi::engine::mcts::Searcher<Game, Move>;
+    using Pipeline = vshogi::engine::mcts::Pipeline<Game, Move>;
+    using Ponderer = vshogi::engine::mcts::Ponderer<Game, Move>;
+    using RootStats = vshogi::engine::mcts::RootStats<Move>;
+    using EvalCache = vshogi::engine::EvalCache;
+    using GumbelParams = vshogi::engine::mcts::GumbelParams;
+    using MultiGameSearcher
+        = vshogi::engine::mcts::MultiGameSearcher<Game, Move>;
 
     py::class_<Searcher>(m, "MCTS")
         .def(py::init<const float, const int, const int>())
+        .def(py::init<
+             const float,
+             const int,
+             const int,
+             const std::uint64_t>())
         .def(
             "set_game",
             [](Searcher& self,
@@ -382,12 +390,148 @@ inline void export_mcts_searcher(pybind11::module& m)
         .def(
             "select",
             [](Searcher& self, Game& game) -> py::object {
-                const auto out = self.select(game);
+                Node* out = nullptr;
+                {
+                    py::gil_scoped_release release;
+                    out = self.select(game);
+                }
                 if (out == nullptr)
                     return py::none();
                 return py::cast(*out, py::return_value_policy::reference);
             })
+        .def(
+            "simulate_expand_and_backprop",
+            [](Searcher& self,
+               Node& leaf,
+               const Game& game,
+               const float value,
+               const py::array_t<float>& policy_logits) {
+                const float* const logits = policy_logits.data();
+                py::gil_scoped_release release;
+                self.simulate_expand_and_backprop(
+                    &leaf,
+                    game.get_legal_moves(),
+                    game.get_turn(),
+                    value,
+                    logits,
+                    game.get_zobrist_hash());
+            })
+        .def(
+            "simulate_mate_and_backprop",
+            [](Searcher& self, Node& leaf) {
+                py::gil_scoped_release release;
+                self.simulate_mate_and_backprop(&leaf);
+            })
+        .def(
+            "select_batch",
+            [](Searcher& self,
+               const Game& game,
+               const uint k,
+               py::array_t<float>& feature_maps) {
+                float* const data = feature_maps.mutable_data();
+                py::gil_scoped_release release;
+                return self.select_batch(game, k, data);
+            })
+        .def(
+            "simulate_expand_and_backprop_batch",
+            [](Searcher& self,
+               const py::array_t<float>& values,
+               const py::array_t<float>& policy_logits) {
+                const float* const v = values.data();
+                const float* const logits = policy_logits.data();
+                py::gil_scoped_release release;
+                self.simulate_expand_and_backprop_batch(v, logits);
+            })
+        .def(
+            "search",
+            [](Searcher& self,
+               const Game& game,
+               const int n,
+               const uint batch_size,
+               const py::function& batch_policy_value_func,
+               const float kldgain_threshold,
+               const int kldgain_interval) {
+                const auto evaluate
+                    = to_mcts_evaluator<Game>(batch_policy_value_func);
+                py::gil_scoped_release release;
+                self.search(
+                    game,
+                    n,
+                    batch_size,
+                    evaluate,
+                    kldgain_threshold,
+                    kldgain_interval);
+            },
+            py::arg("game"),
+            py::arg("n"),
+            py::arg("batch_size"),
+            py::arg("batch_policy_value_func"),
+            py::arg("kldgain_threshold") = 0.f,
+            py::arg("kldgain_interval") = 100)
+        .def(
+            "search_for",
+            [](Searcher& self,
+               const Game& game,
+               const double seconds,
+               const uint batch_size,
+               const py::function& batch_policy_value_func) {
+                const auto evaluate
+                    = to_mcts_evaluator<Game>(batch_policy_value_func);
+                py::gil_scoped_release release;
+                auto time_manager = vshogi::engine::TimeManager(seconds);
+                self.search(game, time_manager, batch_size, evaluate);
+            })
+        .def(
+            "search_gumbel",
+            [](Searcher& self,
+               const Game& game,
+               const int n,
+               const uint batch_size,
+               const py::function& batch_policy_value_func,
+               const uint num_sampled,
+               const float gumbel_scale,
+               const float c_visit,
+               const float c_scale) {
+                const auto evaluate
+                    = to_mcts_evaluator<Game>(batch_policy_value_func);
+                const auto params = GumbelParams{
+                    num_sampled, gumbel_scale, c_visit, c_scale};
+                py::gil_scoped_release release;
+                return self.search_gumbel(
+                    game, n, batch_size, evaluate, params);
+            })
+        .def(
+            "get_improved_policy",
+            [](const Searcher& self,
+               const uint num_sampled,
+               const float gumbel_scale,
+               const float c_visit,
+               const float c_scale) {
+                const auto params = GumbelParams{
+                    num_sampled, gumbel_scale, c_visit, c_scale};
+                const auto probas = self.get_improved_policy(params);
+                const auto actions = self.get_root()->get_actions();
+                py::dict out;
+                for (uint ii = 0u; ii < probas.size(); ++ii)
+                    out[py::cast(actions[ii])] = probas[ii];
+                return out;
+            })
+        .def(
+            "search_pipelined",
+            [](Searcher& self,
+               const Game& game,
+               const int n,
+               const uint num_threads,
+               const uint batch_size,
+               const py::function& batch_policy_value_func) {
+                const auto evaluate
+                    = to_mcts_evaluator<Game>(batch_policy_value_func);
+                py::gil_scoped_release release;
+                Pipeline pipeline(self, evaluate, batch_size, 2u * batch_size);
+                pipeline.search(game, n, num_threads);
+            })
         .def("apply", &Searcher::apply)
+        .def("reclaim", [](Searcher& self) { self.reclaim(); })
         .def(
             "get_root",
             [](Searcher& self) -> py::object {
@@ -397,10 +541,228 @@ inline void export_mcts_searcher(pybind11::module& m)
                 return py::cast(*out, py::return_value_policy::reference);
             })
         .def("get_visit_count", &Searcher::get_visit_count)
+        .def(
+            "set_eval_cache",
+            [](Searcher& self, const py::object& cache) {
+                self.set_eval_cache(
+                    cache.is_none()
+                        ? nullptr
+                        : cache.cast<std::shared_ptr<EvalCache>>());
+            })
+        .def("get_eval_cache", &Searcher::get_eval_cache)
+        .def("set_stats_enabled", &Searcher::set_stats_enabled)
+        .def(
+            "get_stats",
+            [](const Searcher& self) -> py::object {
+                const auto stats = self.get_stats();
+                if (stats == nullptr)
+                    return py::none();
+                return to_dict(*stats);
+            })
+        .def("snapshot_visit_counts", &Searcher::snapshot_visit_counts)
+        .def("get_kldgain", &Searcher::get_kldgain)
+        .def(
+            "get_visit_count_since_snapshot",
+            &Searcher::get_visit_count_since_snapshot)
+        .def("is_converged", &Searcher::is_converged)
+        .def("get_memory_usage", &Searcher::get_memory_usage)
+        .def("set_memory_budget", &Searcher::set_memory_budget)
+        .def("get_memory_budget", &Searcher::get_memory_budget)
+        .def("prune", &Searcher::prune)
         .def("get_action_by_visit_max", &Searcher::get_action_by_visit_max)
         .def(
             "get_action_by_visit_distribution",
-            &Searcher::get_action_by_visit_distribution);
+            &Searcher::get_action_by_visit_distribution)
+        .def("get_root_stats", &Searcher::get_root_stats);
+
+    py::class_<RootStats>(m, "MctsRootStats")
+        .def_static(
+            "from_bytes",
+            [](const py::bytes& b) {
+                return RootStats::from_bytes(static_cast<std::string>(b));
+            })
+        .def(
+            "to_bytes",
+            [](const RootStats& self) { return py::bytes(self.to_bytes()); })
+        .def(
+            "merge",
+            [](RootStats& self, const RootStats& other) { self.merge(other); })
+        .def(
+            "get_visit_counts",
+            [](const RootStats& self) {
+                py::dict out;
+                for (const auto& e : self.get_entries())
+                    out[py::cast(e.action)] = e.visit_count;
+                return out;
+            })
+        .def(
+            "get_q_values",
+            [](const RootStats& self) {
+                py::dict out;
+                for (const auto& e : self.get_entries())
+                    out[py::cast(e.action)] = e.q_value;
+                return out;
+            })
+        .def("get_action_by_visit_max", &RootStats::get_action_by_visit_max)
+        .def(
+            "get_action_by_visit_distribution",
+            [](const RootStats& self,
+               const float temperature,
+               const std::uint64_t seed) {
+                auto random = vshogi::engine::Random(seed);
+                return self.get_action_by_visit_distribution(
+                    temperature, random);
+            });
+
+    py::class_<MultiGameSearcher>(m, "MultiGameMCTS")
+        .def(py::init<
+             const Game&,
+             const uint,
+             const int,
+             const uint,
+             const float,
+             const int,
+             const int,
+             const std::uint64_t>())
+        .def("set_random_moves", &MultiGameSearcher::set_random_moves)
+        .def("get_num_games", &MultiGameSearcher::get_num_games)
+        .def(
+            "get_game",
+            &MultiGameSearcher::get_game,
+            py::return_value_policy::reference_internal)
+        .def(
+            "get_searcher",
+            py::overload_cast<const uint>(&MultiGameSearcher::get_searcher),
+            py::return_value_policy::reference_internal)
+        .def("get_num_records", &MultiGameSearcher::get_num_records)
+        .def(
+            "pop_records",
+            [](MultiGameSearcher& self) {
+                py::list out;
+                for (auto& r : self.pop_records()) {
+                    py::list plies;
+                    for (const auto& ply : r.plies) {
+                        py::dict visit_counts;
+                        py::dict visit_counts_excluding_random;
+                        py::dict q_values;
+                        for (const auto& e : ply.root_stats.get_entries()) {
+                            const auto action = py::cast(e.action);
+                            visit_counts[action] = e.visit_count;
+                            visit_counts_excluding_random[action]
+                                = e.visit_count_excluding_random;
+                            q_values[action] = e.q_value;
+                        }
+                        py::dict d;
+                        d["action"] = ply.action;
+                        d["value"] = ply.value;
+                        d["q_value"] = ply.q_value;
+                        d["visit_counts"] = visit_counts;
+                        d["visit_counts_excluding_random"]
+                            = visit_counts_excluding_random;
+                        d["q_values"] = q_values;
+                        plies.append(d);
+                    }
+                    out.append(py::make_tuple(std::move(r.game), plies));
+                }
+                return out;
+            })
+        .def(
+            "step",
+            [](MultiGameSearcher& self,
+               const py::function& batch_policy_value_func,
+               const uint leaves_per_game) {
+                const auto evaluate
+                    = to_mcts_evaluator<Game>(batch_policy_value_func);
+                py::gil_scoped_release release;
+                return self.step(evaluate, leaves_per_game);
+            });
+
+    // Stop the background thread releasing the GIL, which the thread may be
+    // waiting for to call the Python function, before deleting the ponderer.
+    struct StopAndDelete
+    {
+        void operator()(Ponderer* const p) const
+        {
+            {
+                py::gil_scoped_release release;
+                try {
+                    p->stop();
+                } catch (...) {
+                }
+            }
+            delete p;
+        }
+    };
+    py::class_<Ponderer, std::unique_ptr<Ponderer, StopAndDelete>>(
+        m, "MctsPonderer")
+        .def(
+            py::init([](Searcher& searcher,
+                        const py::function& batch_policy_value_func,
+                        const uint batch_size) {
+                // The evaluator owns a copy of the Python function, since it
+                // is called after this constructor returns.
+                auto evaluate = [func = batch_policy_value_func](
+                                    const uint k,
+                                    const float* const feature_maps,
+                                    float* const values,
+                                    float* const policy_logits) {
+                    to_mcts_evaluator<Game>(func)(
+                        k, feature_maps, values, policy_logits);
+                };
+                return std::unique_ptr<Ponderer, StopAndDelete>(
+                    new Ponderer(searcher, std::move(evaluate), batch_size));
+            }),
+            py::keep_alive<1, 2>())
+        .def(
+            "start",
+            &Ponderer::start,
+            py::call_guard<py::gil_scoped_release>())
+        .def("request_stop", &Ponderer::request_stop)
+        .def(
+            "stop", &Ponderer::stop, py::call_guard<py::gil_scoped_release>())
+        .def("is_pondering", &Ponderer::is_pondering);
+}
+
+inline pybind11::dict to_dict(const vshogi::engine::SearchStats& stats)
+{
+    namespace py = pybind11;
+    using vshogi::engine::SearchStats;
+
+    const auto seconds = [](const SearchStats::Counter& ns) {
+        return static_cast<double>(SearchStats::get(ns)) * 1e-9;
+    };
+    py::list depth_histogram;
+    for (const auto& c : stats.depth_histogram)
+        depth_histogram.append(SearchStats::get(c));
+    py::dict out;
+    out["num_selections"] = SearchStats::get(stats.num_selections);
+    out["num_collisions"] = SearchStats::get(stats.num_collisions);
+    out["num_terminals"] = SearchStats::get(stats.num_terminals);
+    out["num_mates"] = SearchStats::get(stats.num_mates);
+    out["num_expanded"] = SearchStats::get(stats.num_expanded);
+    out["num_cache_hits"] = SearchStats::get(stats.num_cache_hits);
+    out["depth_histogram"] = depth_histogram;
+    out["selection_seconds"] = seconds(stats.selection_ns);
+    out["feature_seconds"] = seconds(stats.feature_ns);
+    out["evaluation_seconds"] = seconds(stats.evaluation_ns);
+    out["backprop_seconds"] = seconds(stats.backprop_ns);
+    out["num_batches"] = SearchStats::get(stats.num_batches);
+    out["batch_fill_ratio"] = stats.get_batch_fill_ratio();
+    return out;
+}
+
+inline void export_eval_cache(pybind11::module& m)
+{
+    namespace py = pybind11;
+    using EvalCache = vshogi::engine::EvalCache;
+
+    py::class_<EvalCache, std::shared_ptr<EvalCache>>(m, "EvalCache")
+        .def(py::init<const std::size_t>())
+        .def("clear", &EvalCache::clear)
+        .def("get_capacity", &EvalCache::get_capacity)
+        .def("get_num_lookups", &EvalCache::get_num_lookups)
+        .def("get_num_hits", &EvalCache::get_num_hits)
+        .def("get_hit_rate", &EvalCache::get_hit_rate);
 }
 
 template <class Game, class Move>
@@ -413,11 +775,28 @@ inline void export_dfpn_searcher(pybind11::module& m)
         .def(py::init<>())
         .def("is_ready", &Searcher::is_ready)
         .def("set_game", &Searcher::set_game)
-        .def("explore", &Searcher::explore)
+        .def("explore", py::overload_cast<uint>(&Searcher::explore))
+        .def(
+            "explore_for",
+            [](Searcher& self, const double seconds) {
+                auto time_manager = vshogi::engine::TimeManager(seconds);
+                return self.explore(time_manager);
+            })
         .def("found_mate", &Searcher::found_mate)
         .def("found_no_mate", &Searcher::found_no_mate)
         .def("found_conclusion", &Searcher::found_conclusion)
-        .def("get_mate_moves", &Searcher::get_mate_moves);
+        .def("get_mate_moves", &Searcher::get_mate_moves)
+        .def(
+            "get_stats",
+            [](const Searcher& self) {
+                const auto& stats = self.get_stats();
+                py::dict out;
+                out["num_explorations"] = stats.num_explorations;
+                out["num_nodes_created"] = stats.num_nodes_created;
+                out["num_cache_lookups"] = stats.num_cache_lookups;
+                out["num_cache_hits"] = stats.num_cache_hits;
+                return out;
+            });
 }
 
 template <class Config>
@@ -9,24 +9,28 @@ int main(int argc, char* argv[])
 {
     vshogi::animal_shogi::Pieces::init_tables();
     vshogi::animal_shogi::Squares::init_tables();
+    vshogi::animal_shogi::Move::init_tables();
     vshogi::animal_shogi::BlackWhiteStands::init_tables();
     vshogi::animal_shogi::BitBoard::init_tables();
     vshogi::animal_shogi::Board::init_tables();
 
     vshogi::minishogi::Pieces::init_tables();
     vshogi::minishogi::Squares::init_tables();
+    vshogi::minishogi::Move::init_tables();
     vshogi::minishogi::BlackWhiteStands::init_tables();
     vshogi::minishogi::BitBoard::init_tables();
     vshogi::minishogi::Board::init_tables();
 
     vshogi::judkins_shogi::Pieces::init_tables();
     vshogi::judkins_shogi::Squares::init_tables();
+    vshogi::judkins_shogi::Move::init_tables();
     vshogi::judkins_shogi::BlackWhiteStands::init_tables();
     vshogi::judkins_shogi::BitBoard::init_tables();
     vshogi::judkins_shogi::Board::init_tables();
 
     vshogi::shogi::Pieces::init_tables();
     vshogi::shogi::Squares::init_tables();
+    vshogi::shogi::Move::init_tables();
     vshogi::shogi::BlackWhiteStands::init_tables();
     vshogi::shogi::BitBoard::init_tables();
     vshogi::shogi::Board::init_tables();
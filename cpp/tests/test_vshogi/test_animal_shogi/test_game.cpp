@@ -1,3 +1,7 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "vshogi/variants/animal_shogi.hpp"
 
 #include <CppUTest/TestHarness.h>
@@ -97,4 +101,39 @@ TEST(animal_shogi_game, result)
     }
 }
 
+TEST(animal_shogi_game, undo)
+{
+    const auto check_undo = [](const std::vector<Move>& moves) {
+        auto game = Game();
+        std::vector<std::string> sfens;
+        std::vector<std::uint64_t> hashes;
+        std::vector<std::vector<Move>> legal_moves;
+        std::vector<vshogi::ResultEnum> results;
+        for (auto&& m : moves) {
+            sfens.emplace_back(game.to_sfen());
+            hashes.emplace_back(game.get_zobrist_hash());
+            legal_moves.emplace_back(game.get_legal_moves());
+            results.emplace_back(game.get_result());
+            game.apply(m);
+        }
+        for (std::size_t ii = moves.size(); ii--;) {
+            game.undo();
+            STRCMP_EQUAL(sfens[ii].c_str(), game.to_sfen().c_str());
+            CHECK_EQUAL(hashes[ii], game.get_zobrist_hash());
+            CHECK_TRUE(legal_moves[ii] == game.get_legal_moves());
+            CHECK_EQUAL(results[ii], game.get_result());
+        }
+    };
+    // Chick promotes implicitly capturing lion.
+    check_undo(
+        {Move(SQ_B2, SQ_B3), Move(SQ_A2, SQ_A1), Move(SQ_B1, SQ_B2)});
+    // Drop of a captured piece.
+    check_undo(
+        {Move(SQ_B2, SQ_B3),
+         Move(SQ_A2, SQ_A1),
+         Move(SQ_B3, CH),
+         Move(SQ_B2, SQ_B1),
+         Move(SQ_B2, SQ_B3)});
+}
+
 } // namespace test_vshogi::test_animal_shogi
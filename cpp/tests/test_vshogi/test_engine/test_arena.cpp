@@ -0,0 +1,161 @@
+#include "vshogi/engine/arena.hpp"
+
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_arena
+{
+
+struct Item
+{
+    int value;
+    Item() : value(0)
+    {
+    }
+    Item(const int v) : value(v)
+    {
+    }
+};
+
+using Arena = vshogi::engine::Arena<Item, 4u>;
+
+TEST_GROUP(arena){};
+
+TEST(arena, allocate)
+{
+    auto arena = Arena();
+    CHECK_EQUAL(0, arena.size());
+    CHECK_EQUAL(0, arena.capacity());
+
+    const auto a = arena.allocate(1);
+    const auto b = arena.allocate(2);
+    CHECK_EQUAL(1, a->value);
+    CHECK_EQUAL(2, b->value);
+    CHECK_EQUAL(2, arena.size());
+    CHECK_EQUAL(4, arena.capacity());
+
+    for (int ii = 0; ii < 3; ++ii)
+        arena.allocate(ii);
+    CHECK_EQUAL(5, arena.size());
+    CHECK_EQUAL(8, arena.capacity());
+    CHECK_EQUAL(1, a->value);
+    CHECK_EQUAL(2, b->value);
+}
+
+TEST(arena, release)
+{
+    auto arena = Arena();
+    const auto a = arena.allocate(1);
+    arena.allocate(2);
+    arena.release(a);
+    CHECK_EQUAL(1, arena.size());
+
+    const auto c = arena.allocate(3);
+    CHECK_TRUE(a == c);
+    CHECK_EQUAL(3, c->value);
+    CHECK_EQUAL(2, arena.size());
+    CHECK_EQUAL(4, arena.capacity());
+}
+
+TEST(arena, reset)
+{
+    auto arena = Arena();
+    const auto a = arena.allocate(1);
+    for (int ii = 0; ii < 6; ++ii)
+        arena.allocate(ii);
+    CHECK_EQUAL(8, arena.capacity());
+
+    arena.reset();
+    CHECK_EQUAL(0, arena.size());
+    CHECK_EQUAL(8, arena.capacity());
+
+    const auto b = arena.allocate(-1);
+    CHECK_TRUE(a == b);
+    CHECK_EQUAL(-1, b->value);
+    for (int ii = 0; ii < 7; ++ii)
+        arena.allocate(ii);
+    CHECK_EQUAL(8, arena.size());
+    CHECK_EQUAL(8, arena.capacity());
+}
+
+TEST(arena, allocate_array)
+{
+    auto arena = Arena();
+    const auto a = arena.allocate_array(3u);
+    CHECK_EQUAL(3, arena.size());
+    CHECK_EQUAL(4, arena.capacity());
+
+    const auto b = arena.allocate_array(2u); // Does not fit in the 1st slab.
+    CHECK_EQUAL(5, arena.size());
+    CHECK_EQUAL(8, arena.capacity());
+    CHECK_TRUE((b < a) || (a + 3 < b));
+
+    arena.release_array(a, 3u);
+    CHECK_EQUAL(2, arena.size());
+    CHECK_TRUE(a == arena.allocate_array(3u));
+    CHECK_EQUAL(5, arena.size());
+    CHECK_EQUAL(8, arena.capacity());
+}
+
+TEST(arena, split_released_array)
+{
+    auto arena = Arena();
+    const auto a = arena.allocate_array(4u);
+    arena.release_array(a, 4u);
+
+    // Shorter arrays are carved out of the released one.
+    const auto b = arena.allocate_array(2u);
+    const auto c = arena.allocate(1);
+    const auto d = arena.allocate(2);
+    CHECK_TRUE(a == b);
+    CHECK_TRUE(a + 2 == c);
+    CHECK_TRUE(a + 3 == d);
+    CHECK_EQUAL(4, arena.size());
+    CHECK_EQUAL(4, arena.capacity());
+}
+
+TEST(arena, capacity_bounded_by_varying_lengths)
+{
+    auto arena = Arena();
+    for (int ii = 0; ii < 100; ++ii) {
+        // Arrays of 16 objects in total, whose lengths vary every time.
+        const std::size_t n = 1u + static_cast<std::size_t>(ii) % 4u;
+        std::vector<Item*> arrays;
+        for (std::size_t jj = 16u / n; jj--;)
+            arrays.emplace_back(arena.allocate_array(n));
+        for (const auto a : arrays)
+            arena.release_array(a, n);
+    }
+    CHECK_EQUAL(0, arena.size());
+    CHECK_TRUE(arena.capacity() <= 20u);
+}
+
+TEST(arena, index)
+{
+    auto arena = Arena();
+    const auto a = arena.allocate(1);
+    const auto b = arena.allocate_array(4u); // Does not fit in the 1st slab.
+    CHECK_EQUAL(0u, arena.index_of(a));
+    CHECK_EQUAL(4u, arena.index_of(b));
+    CHECK_EQUAL(6u, arena.index_of(b + 2));
+    CHECK_TRUE(a == arena.at(0u));
+    CHECK_TRUE(b + 2 == arena.at(6u));
+
+    std::vector<Item*> items;
+    for (int ii = 0; ii < 20; ++ii)
+        items.emplace_back(arena.allocate(ii));
+    for (const auto item : items)
+        CHECK_TRUE(item == arena.at(arena.index_of(item)));
+
+    const auto index = arena.allocate_array_index(2u);
+    CHECK_EQUAL(index, arena.index_of(arena.at(index)));
+    CHECK_EQUAL(27, arena.size());
+}
+
+} // namespace test_arena
+
+} // namespace test_vshogi::test_engine
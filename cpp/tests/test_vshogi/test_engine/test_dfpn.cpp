@@ -73,6 +73,47 @@ TEST(dfpn, mate_in_three_white)
     CHECK_TRUE(Move(SQ_3C, KI) == actual[0]);
 }
 
+TEST(dfpn, explore_with_time_manager)
+{
+    using namespace vshogi::minishogi;
+    using Searcher = vshogi::engine::dfpn::Searcher<Game, Move>;
+
+    {
+        auto searcher = Searcher();
+        searcher.set_game(Game("5/2p2/5/2K2/5 w 2g"));
+        auto tm = vshogi::engine::TimeManager(10.);
+        CHECK_TRUE(searcher.explore(tm));
+        CHECK_TRUE(tm.get_elapsed() < 1.);
+    }
+    {
+        auto searcher = Searcher();
+        searcher.set_game(Game("5/2p2/5/2K2/5 w 2g"));
+        auto tm = vshogi::engine::TimeManager(0.);
+        CHECK_FALSE(searcher.explore(tm));
+    }
+}
+
+TEST(dfpn, stats)
+{
+    using namespace vshogi::minishogi;
+    using Searcher = vshogi::engine::dfpn::Searcher<Game, Move>;
+
+    auto searcher = Searcher();
+    searcher.set_game(Game("5/2p2/5/2K2/5 w 2g"));
+    CHECK_TRUE(searcher.explore(100));
+    const auto& stats = searcher.get_stats();
+    CHECK_TRUE(stats.num_explorations > 0u);
+    CHECK_TRUE(stats.num_explorations <= 100u);
+    CHECK_TRUE(stats.num_nodes_created > stats.num_explorations);
+    CHECK_TRUE(stats.num_cache_lookups > 0u);
+    CHECK_TRUE(stats.num_cache_lookups >= stats.num_cache_hits);
+
+    // The mate found above is cached for the same game position.
+    const auto num_cache_hits = stats.num_cache_hits;
+    searcher.set_game(Game("5/2p2/5/2K2/5 w 2g"));
+    CHECK_TRUE(stats.num_cache_hits > num_cache_hits);
+}
+
 TEST(dfpn, mate_in_three_straight_forward)
 {
     using namespace vshogi::minishogi;
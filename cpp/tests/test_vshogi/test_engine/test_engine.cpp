@@ -65,10 +65,14 @@ TEST(shogi_engine, mcts_with_dfpn)
 
             dfpn.set_game(g_copy);
             if (dfpn.explore(100))
-                n->simulate_mate_and_backprop();
+                mcts.simulate_mate_and_backprop(n);
             else
-                n->simulate_expand_and_backprop(
-                    g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
+                mcts.simulate_expand_and_backprop(
+                    n,
+                    g_copy.get_legal_moves(),
+                    g_copy.get_turn(),
+                    0.f,
+                    zeros);
         }
 
         mcts.get_action_by_visit_max();
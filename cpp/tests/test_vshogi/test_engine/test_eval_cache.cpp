@@ -0,0 +1,142 @@
+#include "vshogi/engine/eval_cache.hpp"
+#include "vshogi/engine/mcts.hpp"
+#include "vshogi/variants/animal_shogi.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_eval_cache
+{
+
+using EvalCache = vshogi::engine::EvalCache;
+
+TEST_GROUP(eval_cache){};
+
+TEST(eval_cache, store_and_lookup)
+{
+    auto cache = EvalCache(8u);
+    CHECK_EQUAL(8u, cache.get_capacity());
+    float value = 0.f;
+    std::vector<float> probas;
+    CHECK_FALSE(cache.lookup(3u, value, probas));
+
+    const float stored[] = {0.25f, 0.75f};
+    cache.store(3u, -0.5f, stored, 2u);
+    CHECK_TRUE(cache.lookup(3u, value, probas));
+    CHECK_EQUAL(-0.5f, value);
+    CHECK_EQUAL(2u, probas.size());
+    CHECK_EQUAL(0.25f, probas[0]);
+    CHECK_EQUAL(0.75f, probas[1]);
+
+    // A position in the same slot replaces the other.
+    cache.store(11u, 0.5f, stored, 1u);
+    CHECK_FALSE(cache.lookup(3u, value, probas));
+    CHECK_TRUE(cache.lookup(11u, value, probas));
+    CHECK_EQUAL(1u, probas.size());
+
+    CHECK_EQUAL(4u, cache.get_num_lookups());
+    CHECK_EQUAL(2u, cache.get_num_hits());
+    DOUBLES_EQUAL(0.5, cache.get_hit_rate(), 1e-9);
+
+    cache.clear();
+    CHECK_EQUAL(0u, cache.get_num_lookups());
+    DOUBLES_EQUAL(0., cache.get_hit_rate(), 1e-9);
+    CHECK_FALSE(cache.lookup(11u, value, probas));
+}
+
+TEST(eval_cache, store_and_lookup_in_parallel)
+{
+    constexpr int num_threads = 4;
+    constexpr std::uint64_t num_keys = 1000u;
+    auto cache = EvalCache(100u);
+    std::vector<std::thread> threads;
+    for (int ii = num_threads; ii--;) {
+        threads.emplace_back([&cache]() {
+            float value = 0.f;
+            std::vector<float> probas;
+            for (std::uint64_t key = 0u; key < num_keys; ++key) {
+                const float stored[] = {static_cast<float>(key % 8u)};
+                cache.store(key, 1.f, stored, 1u);
+                if (cache.lookup(key, value, probas))
+                    CHECK_EQUAL(1u, probas.size());
+            }
+        });
+    }
+    for (auto&& t : threads)
+        t.join();
+    CHECK_EQUAL(num_threads * num_keys, cache.get_num_lookups());
+}
+
+} // namespace test_eval_cache
+
+namespace test_animal_shogi
+{
+
+using namespace vshogi::animal_shogi;
+using Searcher = vshogi::engine::mcts::Searcher<Game, Move>;
+using EvalCache = vshogi::engine::EvalCache;
+static constexpr float zeros[Game::num_dlshogi_policy()] = {0.f};
+
+TEST_GROUP(animal_shogi_eval_cache){};
+
+TEST(animal_shogi_eval_cache, search_with_eval_cache)
+{
+    constexpr int n = 200;
+    const auto g = Game();
+    const auto cache = std::make_shared<EvalCache>(1u << 12);
+    uint num_evaluated = 0u;
+    const auto evaluate
+        = [&num_evaluated](
+              const uint k, const float*, float* values, float* logits) {
+              std::fill_n(values, k, 0.f);
+              std::fill_n(logits, k * Game::num_dlshogi_policy(), 0.f);
+              num_evaluated += k;
+          };
+
+    auto first = Searcher(1.f, 0, 0);
+    first.set_eval_cache(cache);
+    first.set_game(g, 0.f, zeros);
+    first.search(g, n, 4u, evaluate);
+    const uint num_evaluated_first = num_evaluated;
+    CHECK_TRUE(num_evaluated_first > 0u);
+
+    // The second search of the same position evaluates none of the positions
+    // the first one did.
+    num_evaluated = 0u;
+    auto second = Searcher(1.f, 0, 0);
+    second.set_eval_cache(cache);
+    second.set_game(g, 0.f, zeros);
+    second.search(g, n, 4u, evaluate);
+    // Selections reaching game ends may exceed `n` within the last batch.
+    const int visit_count = second.get_visit_count();
+    CHECK_TRUE(visit_count >= 1 + n);
+    CHECK_TRUE(num_evaluated < num_evaluated_first);
+    CHECK_TRUE(cache->get_num_hits() > 0u);
+
+    const auto root = second.get_root();
+    int sum = 0;
+    for (uint ii = 0u; ii < root->get_num_child(); ++ii) {
+        const auto ch = root->get_child(ii);
+        if (ch == nullptr)
+            continue;
+        CHECK_FALSE(ch->is_pending_evaluation());
+        CHECK_TRUE(ch->get_num_child() > 0u);
+        sum += ch->get_visit_count();
+    }
+    CHECK_EQUAL(visit_count - 1, sum);
+
+    second.set_eval_cache(nullptr);
+    CHECK_TRUE(second.get_eval_cache() == nullptr);
+}
+
+} // namespace test_animal_shogi
+
+} // namespace test_vshogi::test_engine
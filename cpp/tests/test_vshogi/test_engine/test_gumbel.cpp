@@ -0,0 +1,90 @@
+#include "vshogi/engine/gumbel.hpp"
+
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_gumbel
+{
+
+using vshogi::uint;
+namespace mcts = vshogi::engine::mcts;
+
+TEST_GROUP(gumbel){};
+
+TEST(gumbel, sample)
+{
+    constexpr int num = 100000;
+    auto random = vshogi::engine::Random(0u);
+    double sum = 0.;
+    for (int ii = num; ii--;) {
+        const float g = mcts::sample_gumbel(random);
+        CHECK_TRUE(std::isfinite(g));
+        sum += static_cast<double>(g);
+    }
+    // Mean of the standard Gumbel distribution is Euler's constant.
+    DOUBLES_EQUAL(0.5772, sum / num, 0.02);
+}
+
+TEST(gumbel, num_halving_phases)
+{
+    CHECK_EQUAL(0u, mcts::num_halving_phases(1u));
+    CHECK_EQUAL(1u, mcts::num_halving_phases(2u));
+    CHECK_EQUAL(2u, mcts::num_halving_phases(3u));
+    CHECK_EQUAL(2u, mcts::num_halving_phases(4u));
+    CHECK_EQUAL(3u, mcts::num_halving_phases(5u));
+    CHECK_EQUAL(4u, mcts::num_halving_phases(16u));
+}
+
+TEST(gumbel, complete_q_values)
+{
+    const float probas[] = {0.5f, 0.3f, 0.2f};
+    const int visit_counts[] = {2, 0, 1};
+    const float q_values[] = {-0.5f, 0.f, 0.25f}; // From children's view.
+    float out[3];
+    mcts::complete_q_values(probas, visit_counts, q_values, 3u, 0.1f, out);
+
+    DOUBLES_EQUAL(0.75f, out[0], 1e-6f);
+    DOUBLES_EQUAL(0.375f, out[2], 1e-6f);
+    // (0.1 + 3 * (0.5 * 0.5 + 0.2 * -0.25) / 0.7) / (1 + 3)
+    const float mixed = (0.1f + 3.f * 0.2f / 0.7f) / 4.f;
+    DOUBLES_EQUAL(0.5f * (mixed + 1.f), out[1], 1e-6f);
+
+    // Without visits, every child gets the value of the parent.
+    const int no_visits[] = {0, 0, 0};
+    mcts::complete_q_values(probas, no_visits, q_values, 3u, -0.2f, out);
+    for (const float q : out)
+        DOUBLES_EQUAL(0.4f, q, 1e-6f);
+}
+
+TEST(gumbel, improved_policy)
+{
+    const float probas[] = {0.5f, 0.3f, 0.2f};
+    const float q_values[] = {0.f, 0.f, -1.f}; // The last one wins.
+    float out[3];
+    {
+        // Without visits, it is the prior.
+        const int visit_counts[] = {0, 0, 0};
+        mcts::improved_policy(
+            probas, visit_counts, q_values, 3u, 0.f, {}, out);
+        for (uint ii = 0u; ii < 3u; ++ii)
+            DOUBLES_EQUAL(probas[ii], out[ii], 1e-5f);
+    }
+    {
+        const int visit_counts[] = {1, 1, 1};
+        mcts::improved_policy(
+            probas, visit_counts, q_values, 3u, 0.f, {}, out);
+        DOUBLES_EQUAL(1.f, std::accumulate(out, out + 3, 0.f), 1e-5f);
+        CHECK_TRUE(out[2] > out[0]);
+        CHECK_TRUE(out[0] > out[1]);
+    }
+}
+
+} // namespace test_gumbel
+
+} // namespace test_vshogi::test_engine
@@ -0,0 +1,54 @@
+#include "vshogi/engine/half.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_half
+{
+
+using vshogi::engine::from_half;
+using vshogi::engine::to_half;
+
+TEST_GROUP(half){};
+
+TEST(half, round_trip)
+{
+    for (const float f : {0.f, 1.f, -2.f, 0.5f, 65504.f, 0x1.0p-24f}) {
+        CHECK_EQUAL(f, from_half(to_half(f)));
+    }
+    for (const float f : {0.1f, 0.333f, 1e-3f, 1e-6f, 7.77f}) {
+        const float g = from_half(to_half(f));
+        DOUBLES_EQUAL(f, g, std::max(std::abs(f) * 1e-3f, 0x1.0p-25f));
+    }
+    CHECK_TRUE(std::isinf(from_half(to_half(1e6f))));
+    CHECK_TRUE(std::isnan(
+        from_half(to_half(std::numeric_limits<float>::quiet_NaN()))));
+    CHECK_EQUAL(0.f, from_half(to_half(1e-9f)));
+}
+
+TEST(half, round_ties_to_even)
+{
+    // Halfway between 1 and the next half, 1 + 2^-10, and above it.
+    CHECK_EQUAL(0x3c00u, to_half(1.f + 0x1.0p-11f));
+    CHECK_EQUAL(0x3c02u, to_half(1.f + 0x3.0p-11f));
+    CHECK_EQUAL(0x3c01u, to_half(1.f + 0x1.0p-11f + 0x1.0p-20f));
+    CHECK_EQUAL(0xbc00u, to_half(-1.f - 0x1.0p-11f));
+    CHECK_EQUAL(0x7bffu, to_half(65504.f + 8.f));
+    CHECK_EQUAL(0x7c00u, to_half(65504.f + 16.f));
+
+    // Halfway between subnormals.
+    CHECK_EQUAL(0x0000u, to_half(0x1.0p-25f));
+    CHECK_EQUAL(0x0001u, to_half(0x1.0p-25f + 0x1.0p-40f));
+    CHECK_EQUAL(0x0002u, to_half(0x3.0p-25f));
+    CHECK_EQUAL(0x0002u, to_half(0x5.0p-25f));
+}
+
+} // namespace test_half
+
+} // namespace test_vshogi::test_engine
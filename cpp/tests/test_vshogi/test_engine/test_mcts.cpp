@@ -4,6 +4,15 @@
 #include "vshogi/variants/minishogi.hpp"
 #include "vshogi/variants/shogi.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 #include <CppUTest/TestHarness.h>
 
 namespace test_vshogi::test_engine
@@ -14,81 +23,127 @@ namespace test_animal_shogi
 
 using namespace vshogi::animal_shogi;
 using Node = vshogi::engine::mcts::Node<Game, Move>;
+using Arena = vshogi::engine::mcts::Children<Game, Move>::ArenaType;
 using Searcher = vshogi::engine::mcts::Searcher<Game, Move>;
+using Random = vshogi::engine::Random;
 static constexpr float zeros[Game::num_dlshogi_policy()] = {0.f};
 
 TEST_GROUP(animal_shogi_node){};
 
 TEST(animal_shogi_node, init_default)
 {
-    auto root = Node();
-    CHECK_EQUAL(0, root.get_visit_count());
-    DOUBLES_EQUAL(0.f, root.get_value(), 1e-2f);
-    DOUBLES_EQUAL(0.f, root.get_q_value(), 1e-2f);
+    auto g = Game();
+    auto arena = Arena();
+    auto root = Node::create_root(
+        arena, g.get_legal_moves(), g.get_turn(), 0.5f, zeros);
+    const uint num = root->get_num_child();
+    CHECK_EQUAL(g.get_legal_moves().size(), num);
+    CHECK_EQUAL(num, root->get_actions().size());
+    CHECK_EQUAL(num, root->get_probas().size());
+    for (uint ii = 0u; ii < num; ++ii) {
+        CHECK_EQUAL(0, root->get_visit_counts()[ii]);
+        DOUBLES_EQUAL(0.f, root->get_q_values()[ii], 1e-2f);
+        CHECK_TRUE(nullptr == root->get_child(ii));
+    }
 }
 
 TEST(animal_shogi_node, init_with_args)
 {
-    auto root = Node({}, vshogi::BLACK, -1.f, zeros);
-    CHECK_EQUAL(1, root.get_visit_count());
-    DOUBLES_EQUAL(-1.f, root.get_value(), 1e-2f);
-    DOUBLES_EQUAL(-1.f, root.get_q_value(), 1e-2f);
+    auto arena = Arena();
+    auto root = Node::create_root(arena, {}, vshogi::BLACK, -1.f, zeros);
+    CHECK_EQUAL(1, root->get_visit_count());
+    DOUBLES_EQUAL(-1.f, root->get_value(), 1e-2f);
+    DOUBLES_EQUAL(-1.f, root->get_q_value(), 1e-2f);
+}
+
+TEST(animal_shogi_node, create_child_lazily)
+{
+    auto g = Game();
+    auto arena = Arena();
+    auto random = Random(0u);
+    auto root = Node::create_root(
+        arena, g.get_legal_moves(), g.get_turn(), 0.5f, zeros);
+    const auto size = arena.size();
+
+    // Reading the children allocates none of them.
+    const auto actions = root->get_actions();
+    CHECK_TRUE(nullptr == root->get_child(0u));
+    CHECK_TRUE(nullptr == root->get_child(actions[1]));
+    CHECK_EQUAL(actions.size(), root->get_visit_counts().size());
+    CHECK_EQUAL(size, arena.size());
+
+    auto g_copy = Game(g);
+    const auto ch = root->select(g_copy, 1.f, 0, 0, random);
+    CHECK_TRUE(ch != nullptr);
+    CHECK_EQUAL(size + 1u, arena.size());
+    CHECK_TRUE(ch == root->get_child(ch->get_action()));
+    CHECK_TRUE(nullptr == ch->get_sibling());
+    CHECK_EQUAL(size + 1u, arena.size());
 }
 
 TEST(animal_shogi_node, explore_no_child)
 {
     auto g = Game("3/3/3/3 b -");
-    auto root = Node(g.get_legal_moves(), g.get_turn(), 1.f, zeros);
+    auto arena = Arena();
+    auto random = Random(0u);
+    auto root = Node::create_root(
+        arena, g.get_legal_moves(), g.get_turn(), 1.f, zeros);
 
-    const auto actual = root.select(g, 1.f, 1, 1);
+    const auto actual = root->select(g, 1.f, 1, 1, random);
 
-    CHECK_EQUAL(2, root.get_visit_count());
+    CHECK_EQUAL(2, root->get_visit_count());
     CHECK_TRUE(nullptr == actual);
 }
 
 TEST(animal_shogi_node, explore_game_end)
 {
     auto g = Game("3/1l1/1C1/3 b -");
-    auto root = Node(g.get_legal_moves(), g.get_turn(), 0.f, zeros);
-    DOUBLES_EQUAL(0.f, root.get_q_value(), 1e-2f);
-    const auto actual = root.select(g, 1.f, 0.f, 0);
+    auto arena = Arena();
+    auto random = Random(0u);
+    auto root = Node::create_root(
+        arena, g.get_legal_moves(), g.get_turn(), 0.f, zeros);
+    DOUBLES_EQUAL(0.f, root->get_q_value(), 1e-2f);
+    const auto actual = root->select(g, 1.f, 0.f, 0, random);
     CHECK_TRUE(nullptr == actual);
-    DOUBLES_EQUAL(0.f, root.get_value(), 1e-2f);
-    DOUBLES_EQUAL(1.f, root.get_q_value(), 1e-2f);
+    DOUBLES_EQUAL(0.f, root->get_value(), 1e-2f);
+    DOUBLES_EQUAL(1.f, root->get_q_value(), 1e-2f);
 }
 
 TEST(animal_shogi_node, explore_one_action)
 {
     auto g = Game("1l1/3/1C1/3 b -");
-    auto root = Node(g.get_legal_moves(), g.get_turn(), 0.1f, zeros);
-    DOUBLES_EQUAL(0.1f, root.get_q_value(100), 1e-2f);
+    auto arena = Arena();
+    auto random = Random(0u);
+    auto root = Node::create_root(
+        arena, g.get_legal_moves(), g.get_turn(), 0.1f, zeros);
+    DOUBLES_EQUAL(0.1f, root->get_q_value(100), 1e-2f);
 
-    const auto actual = root.select(g, 1.f, 0.f, 0);
+    const auto actual = root->select(g, 1.f, 0.f, 0, random);
     {
         STRCMP_EQUAL("1l1/1C1/3/3 w - 2", g.to_sfen().c_str());
 
-        CHECK_EQUAL(2, root.get_visit_count());
-        DOUBLES_EQUAL(0.1f, root.get_value(), 1e-2f);
-        DOUBLES_EQUAL(0.1f, root.get_q_value(), 1e-2f);
+        CHECK_EQUAL(2, root->get_visit_count());
+        DOUBLES_EQUAL(0.1f, root->get_value(), 1e-2f);
+        DOUBLES_EQUAL(0.1f, root->get_q_value(), 1e-2f);
 
         CHECK_TRUE(actual != nullptr);
-        CHECK_TRUE(actual != &root);
+        CHECK_TRUE(actual != root);
     }
     actual->simulate_expand_and_backprop(
-        g.get_legal_moves(), g.get_turn(), -0.8f, zeros);
+        arena, g.get_legal_moves(), g.get_turn(), -0.8f, zeros);
     {
-        CHECK_EQUAL(2, root.get_visit_count());
-        DOUBLES_EQUAL(0.1f, root.get_value(), 1e-2f);
-        DOUBLES_EQUAL((0.1f + 0.8f) / 2.f, root.get_q_value(), 1e-2f);
+        CHECK_EQUAL(2, root->get_visit_count());
+        DOUBLES_EQUAL(0.1f, root->get_value(), 1e-2f);
+        DOUBLES_EQUAL((0.1f + 0.8f) / 2.f, root->get_q_value(), 1e-2f);
 
         CHECK_EQUAL(1, actual->get_visit_count());
         DOUBLES_EQUAL(-0.8f, actual->get_value(), 1e-2f);
         DOUBLES_EQUAL(-0.8f, actual->get_q_value(), 1e-2f);
 
-        const auto ch = root.get_child(Move(SQ_B2, SQ_B3));
+        const auto ch = root->get_child(Move(SQ_B2, SQ_B3));
         CHECK_TRUE(actual == ch);
     }
-    DOUBLES_EQUAL(0.8f, root.get_q_value(100), 1e-2f);
+    DOUBLES_EQUAL(0.8f, root->get_q_value(100), 1e-2f);
 }
 
 TEST(animal_shogi_node, explore_two_action)
@@ -135,22 +190,28 @@ TEST(animal_shogi_node, explore_two_action)
     logits[Move(SQ_A3, SQ_A4).to_dlshogi_policy_index()] = 0.202f;
     logits[Move(SQ_B4, SQ_A4).to_dlshogi_policy_index()] = -0.202f;
     auto g = Game("1l1/3/3/G2 b -");
-    auto root = Node(
-        {Move(SQ_A3, SQ_A4), Move(SQ_B4, SQ_A4)}, vshogi::BLACK, 0.f, logits);
+    auto arena = Arena();
+    auto random = Random(0u);
+    auto root = Node::create_root(
+        arena,
+        {Move(SQ_A3, SQ_A4), Move(SQ_B4, SQ_A4)},
+        vshogi::BLACK,
+        0.f,
+        logits);
 
     for (std::size_t ii = 0; ii < 3; ++ii) {
         auto g_copy = Game(g);
-        const auto actual = root.select(g_copy, 1.f, -1, 0);
+        const auto actual = root->select(g_copy, 1.f, -1, 0, random);
         actual->simulate_expand_and_backprop(
-            {}, vshogi::WHITE, input_value[ii], zeros);
+            arena, {}, vshogi::WHITE, input_value[ii], zeros);
 
-        CHECK_EQUAL(root.get_child(moves[ii]), actual);
-        DOUBLES_EQUAL(expected_q_value[ii], root.get_q_value(), 1e-3f);
+        CHECK_EQUAL(root->get_child(moves[ii]), actual);
+        DOUBLES_EQUAL(expected_q_value[ii], root->get_q_value(), 1e-3f);
         CHECK_TRUE(
-            root.get_most_visited_child()->get_action()
+            root->get_most_visited_child()->get_action()
             == expected_most_selected_moves[ii]);
         DOUBLES_EQUAL(
-            expected_greedy_q_values[ii], root.get_q_value(100), 1e-2f);
+            expected_greedy_q_values[ii], root->get_q_value(100), 1e-2f);
     }
 }
 
@@ -194,59 +255,68 @@ TEST(animal_shogi_node, explore_two_layer)
     logits[Move(SQ_A3, SQ_A4).to_dlshogi_policy_index()] = 1.099f;
     logits[Move(SQ_B4, SQ_A4).to_dlshogi_policy_index()] = -1.099f;
     auto g = Game("2g/3/3/G2 b -");
-    auto root = Node(
-        {Move(SQ_A3, SQ_A4), Move(SQ_B4, SQ_A4)}, vshogi::BLACK, 0.f, logits);
+    auto arena = Arena();
+    auto random = Random(0u);
+    auto root = Node::create_root(
+        arena,
+        {Move(SQ_A3, SQ_A4), Move(SQ_B4, SQ_A4)},
+        vshogi::BLACK,
+        0.f,
+        logits);
 
     {
         auto g_copy = Game(g);
-        const auto actual = root.select(g_copy, 1.f, -1, 0);
-        CHECK_EQUAL(root.get_child(Move(SQ_A3, SQ_A4)), actual);
+        const auto actual = root->select(g_copy, 1.f, -1, 0, random);
+        CHECK_EQUAL(root->get_child(Move(SQ_A3, SQ_A4)), actual);
         STRCMP_EQUAL("2g/3/G2/3 w - 2", g_copy.to_sfen().c_str());
         float policy[Game::num_dlshogi_policy()] = {0.f};
         policy[Move(SQ_C2, SQ_C1).rotate().to_dlshogi_policy_index()] = 1.099f;
         policy[Move(SQ_B1, SQ_C1).rotate().to_dlshogi_policy_index()] = -1.099f;
         actual->simulate_expand_and_backprop(
+            arena,
             {Move(SQ_C2, SQ_C1), Move(SQ_B1, SQ_C1)},
             vshogi::WHITE,
             -0.9f,
             policy);
-        DOUBLES_EQUAL((0.f + 0.9f) / 2.f, root.get_q_value(), 1e-3f);
-        DOUBLES_EQUAL(0.9f, root.get_q_value(100), 1e-2f);
+        DOUBLES_EQUAL((0.f + 0.9f) / 2.f, root->get_q_value(), 1e-3f);
+        DOUBLES_EQUAL(0.9f, root->get_q_value(100), 1e-2f);
     }
     {
         auto g_copy = Game("2g/3/3/G2 b -");
-        const auto actual = root.select(g_copy, 1.f, -1, 0);
+        const auto actual = root->select(g_copy, 1.f, -1, 0, random);
         CHECK_EQUAL(
-            root.get_child(Move(SQ_A3, SQ_A4))->get_child(Move(SQ_C2, SQ_C1)),
+            root->get_child(Move(SQ_A3, SQ_A4))->get_child(Move(SQ_C2, SQ_C1)),
             actual);
         STRCMP_EQUAL("3/2g/G2/3 b - 3", g_copy.to_sfen().c_str());
         actual->simulate_expand_and_backprop(
-            g_copy.get_legal_moves(), g_copy.get_turn(), -0.5f, zeros);
-        DOUBLES_EQUAL((0.f + 0.9f + -0.5f) / 3.f, root.get_q_value(), 1e-3f);
+            arena, g_copy.get_legal_moves(), g_copy.get_turn(), -0.5f, zeros);
+        DOUBLES_EQUAL((0.f + 0.9f + -0.5f) / 3.f, root->get_q_value(), 1e-3f);
         CHECK_TRUE(
-            root.get_most_visited_child()->get_action() == Move(SQ_A3, SQ_A4));
-        DOUBLES_EQUAL((0.f + 0.9f + -0.5f) / 3.f, root.get_q_value(0), 1e-2f);
-        DOUBLES_EQUAL((0.9f + -0.5f) / 2.f, root.get_q_value(1), 1e-2f);
-        DOUBLES_EQUAL(-0.5f, root.get_q_value(2), 1e-2f);
-        DOUBLES_EQUAL(-0.5f, root.get_q_value(100), 1e-2f);
+            root->get_most_visited_child()->get_action() == Move(SQ_A3, SQ_A4));
+        DOUBLES_EQUAL((0.f + 0.9f + -0.5f) / 3.f, root->get_q_value(0), 1e-2f);
+        DOUBLES_EQUAL((0.9f + -0.5f) / 2.f, root->get_q_value(1), 1e-2f);
+        DOUBLES_EQUAL(-0.5f, root->get_q_value(2), 1e-2f);
+        DOUBLES_EQUAL(-0.5f, root->get_q_value(100), 1e-2f);
     }
     {
-        CHECK_EQUAL(3, root.get_visit_count());
-        DOUBLES_EQUAL(0.f, root.get_value(), 1e-2f);
-        root.apply(Move(SQ_A3, SQ_A4));
-        CHECK_EQUAL(2, root.get_visit_count());
-        DOUBLES_EQUAL(-0.9f, root.get_value(), 1e-2f);
+        CHECK_EQUAL(3, root->get_visit_count());
+        DOUBLES_EQUAL(0.f, root->get_value(), 1e-2f);
+        const auto num_lines = arena.size();
+        root->apply(arena, Move(SQ_A3, SQ_A4));
+        CHECK_TRUE(arena.size() < num_lines); // released A3A4 and B4A4
+        CHECK_EQUAL(2, root->get_visit_count());
+        DOUBLES_EQUAL(-0.9f, root->get_value(), 1e-2f);
 
         DOUBLES_EQUAL(
-            0.9f, root.get_child(Move(SQ_C2, SQ_C1))->get_proba(), 1e-2f);
-        DOUBLES_EQUAL(
-            0.1f, root.get_child(Move(SQ_B1, SQ_C1))->get_proba(), 1e-2f);
-        DOUBLES_EQUAL((-0.9f + 0.5f) / 2.f, root.get_q_value(), 1e-3f);
+            0.9f, root->get_child(Move(SQ_C2, SQ_C1))->get_proba(), 1e-2f);
+        CHECK_TRUE(Move(SQ_B1, SQ_C1) == root->get_actions()[1]);
+        DOUBLES_EQUAL(0.1f, root->get_probas()[1], 1e-2f);
+        DOUBLES_EQUAL((-0.9f + 0.5f) / 2.f, root->get_q_value(), 1e-3f);
         CHECK_TRUE(
-            root.get_most_visited_child()->get_action() == Move(SQ_C2, SQ_C1));
-        DOUBLES_EQUAL((-0.9f + 0.5f) / 2.f, root.get_q_value(0), 1e-2f);
-        DOUBLES_EQUAL(0.5f, root.get_q_value(1), 1e-2f);
-        DOUBLES_EQUAL(0.5f, root.get_q_value(100), 1e-2f);
+            root->get_most_visited_child()->get_action() == Move(SQ_C2, SQ_C1));
+        DOUBLES_EQUAL((-0.9f + 0.5f) / 2.f, root->get_q_value(0), 1e-2f);
+        DOUBLES_EQUAL(0.5f, root->get_q_value(1), 1e-2f);
+        DOUBLES_EQUAL(0.5f, root->get_q_value(100), 1e-2f);
     }
 }
 
@@ -259,25 +329,132 @@ TEST(animal_shogi_node, explore_after_apply)
         auto g_copy = Game(g);
         const auto n = mcts.select(g_copy);
         if (n != nullptr)
-            n->simulate_expand_and_backprop(
-                g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
+            mcts.simulate_expand_and_backprop(
+                n, g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
     }
 
     const auto move = Move(SQ_B2, SQ_B3);
+    const auto memory_usage = mcts.get_memory_usage();
     mcts.apply(move);
     g.apply(move);
     const auto current_visit_count = mcts.get_visit_count();
     CHECK_TRUE(current_visit_count > 0);
+    CHECK_EQUAL(memory_usage, mcts.get_memory_usage()); // Not reclaimed yet.
+    mcts.reclaim();
+    CHECK_TRUE(mcts.get_memory_usage() < memory_usage);
     for (int ii = 100; ii--;) {
         auto g_copy = Game(g);
         const auto n = mcts.select(g_copy);
         if (n != nullptr)
-            n->simulate_expand_and_backprop(
-                g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
+            mcts.simulate_expand_and_backprop(
+                n, g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
     }
     CHECK_EQUAL(current_visit_count + 100, mcts.get_visit_count());
 }
 
+TEST(animal_shogi_node, reclaim_during_search)
+{
+    auto g = Game();
+    auto mcts = Searcher(4.f, 3, 1);
+    mcts.set_game(g, 0.f, zeros);
+    for (int ii = 300; ii--;) {
+        auto g_copy = Game(g);
+        const auto n = mcts.select(g_copy);
+        if (n != nullptr)
+            mcts.simulate_expand_and_backprop(
+                n, g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
+    }
+    const auto action = mcts.get_action_by_visit_max();
+    mcts.apply(action);
+    g.apply(action);
+    const auto memory_usage = mcts.get_memory_usage();
+
+    // Expanding leaves after `apply()` returns the discarded nodes.
+    for (int ii = 10; ii--;) {
+        auto g_copy = Game(g);
+        const auto n = mcts.select(g_copy);
+        if (n != nullptr)
+            mcts.simulate_expand_and_backprop(
+                n, g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
+    }
+    CHECK_TRUE(mcts.get_memory_usage() < memory_usage);
+}
+
+TEST(animal_shogi_node, prune)
+{
+    auto g = Game();
+    auto mcts = Searcher(4.f, 3, 1);
+    mcts.set_game(g, 0.f, zeros);
+    for (int ii = 500; ii--;) {
+        auto g_copy = Game(g);
+        const auto n = mcts.select(g_copy);
+        if (n != nullptr)
+            mcts.simulate_expand_and_backprop(
+                n, g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
+    }
+    const auto root = mcts.get_root();
+    const auto visit_counts = root->get_visit_counts();
+    const auto q_values = root->get_q_values();
+    const auto memory_usage = mcts.get_memory_usage();
+
+    mcts.set_memory_budget(memory_usage / 2u);
+    mcts.prune();
+
+    CHECK_TRUE(mcts.get_memory_usage() <= memory_usage / 2u);
+    CHECK_EQUAL(501, mcts.get_visit_count());
+    CHECK_TRUE(visit_counts == root->get_visit_counts());
+    for (uint ii = 0u; ii < root->get_num_child(); ++ii)
+        DOUBLES_EQUAL(q_values[ii], root->get_q_values()[ii], 1e-6f);
+}
+
+TEST(animal_shogi_node, reproducible_with_seed)
+{
+    const auto search = [](const std::uint64_t seed) {
+        auto g = Game();
+        auto mcts = Searcher(1.f, 1, 3, seed);
+        mcts.set_game(g, 0.f, zeros);
+        for (int ii = 200; ii--;) {
+            auto g_copy = Game(g);
+            const auto n = mcts.select(g_copy);
+            if (n != nullptr)
+                mcts.simulate_expand_and_backprop(
+                    n,
+                    g_copy.get_legal_moves(),
+                    g_copy.get_turn(),
+                    0.f,
+                    zeros);
+        }
+        return mcts.get_root()->get_visit_counts();
+    };
+    CHECK_TRUE(search(1u) == search(1u));
+    CHECK_TRUE(search(1u) != search(2u));
+}
+
+TEST(animal_shogi_node, explore_within_memory_budget)
+{
+    auto g = Game();
+    auto mcts = Searcher(4.f, 3, 1);
+    mcts.set_game(g, 0.f, zeros);
+    constexpr std::size_t budget = 64u * 1024u;
+    constexpr std::size_t max_block_size = 64u * 64u;
+    mcts.set_memory_budget(budget);
+    for (int ii = 3000; ii--;) {
+        auto g_copy = Game(g);
+        const auto n = mcts.select(g_copy);
+        if (n != nullptr)
+            mcts.simulate_expand_and_backprop(
+                n, g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
+        CHECK_TRUE(mcts.get_memory_usage() <= budget + max_block_size);
+    }
+    CHECK_EQUAL(3001, mcts.get_visit_count());
+
+    const auto root = mcts.get_root();
+    int sum = 0;
+    for (const int count : root->get_visit_counts())
+        sum += count;
+    CHECK_EQUAL(3000, sum);
+}
+
 TEST(animal_shogi_node, explore_until_game_end)
 {
     auto g = Game();
@@ -290,8 +467,8 @@ TEST(animal_shogi_node, explore_until_game_end)
             auto g_copy = Game(g);
             const auto n = mcts.select(g_copy);
             if (n != nullptr)
-                n->simulate_expand_and_backprop(
-                    g_copy.get_legal_moves(), g.get_turn(), 0.f, zeros);
+                mcts.simulate_expand_and_backprop(
+                    n, g_copy.get_legal_moves(), g.get_turn(), 0.f, zeros);
         }
 
         const auto action = mcts.get_action_by_visit_max();
@@ -300,6 +477,528 @@ TEST(animal_shogi_node, explore_until_game_end)
     }
 }
 
+TEST(animal_shogi_node, select_leaf_pending_evaluation)
+{
+    auto g = Game("1l1/3/1C1/3 b -");
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+
+    auto g1 = Game(g);
+    const auto leaf = mcts.select(g1);
+    CHECK_TRUE(leaf != nullptr);
+    CHECK_TRUE(leaf->is_pending_evaluation());
+    CHECK_EQUAL(2, mcts.get_visit_count());
+
+    auto g2 = Game(g);
+    CHECK_TRUE(nullptr == mcts.select(g2)); // The only leaf is pending.
+    CHECK_EQUAL(2, mcts.get_visit_count());
+    CHECK_EQUAL(1, leaf->get_visit_count());
+    CHECK_EQUAL(1, leaf->get_visit_count_excluding_random());
+
+    mcts.simulate_expand_and_backprop(
+        leaf, g1.get_legal_moves(), g1.get_turn(), 0.f, zeros);
+    CHECK_FALSE(leaf->is_pending_evaluation());
+    auto g3 = Game(g);
+    CHECK_TRUE(nullptr != mcts.select(g3));
+    CHECK_EQUAL(3, mcts.get_visit_count());
+    CHECK_EQUAL(2, leaf->get_visit_count());
+}
+
+TEST(animal_shogi_node, select_batch)
+{
+    constexpr uint k = 4u;
+    constexpr uint feature_size
+        = Game::ranks() * Game::files() * Game::feature_channels();
+    const auto g = Game();
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+
+    std::vector<float> feature_maps(k * feature_size, -1.f);
+    const uint n = mcts.select_batch(g, k, feature_maps.data());
+    CHECK_EQUAL(k, n);
+    CHECK_EQUAL(1 + static_cast<int>(k), mcts.get_visit_count());
+
+    // Each of the leaves is a distinct child of the root.
+    const auto root = mcts.get_root();
+    std::vector<float> expected(feature_size);
+    uint num_visited = 0u;
+    for (uint ii = 0u; ii < root->get_num_child(); ++ii) {
+        const auto ch = root->get_child(ii);
+        if (ch == nullptr)
+            continue;
+        CHECK_EQUAL(1, ch->get_visit_count());
+        auto g_ch = Game(g);
+        g_ch.apply(ch->get_action());
+        g_ch.to_feature_map(expected.data());
+        bool found = false;
+        for (uint jj = 0u; jj < n; ++jj) {
+            found = found
+                    || std::equal(
+                        expected.cbegin(),
+                        expected.cend(),
+                        feature_maps.cbegin() + feature_size * jj);
+        }
+        CHECK_TRUE(found);
+        ++num_visited;
+    }
+    CHECK_EQUAL(k, num_visited);
+
+    const std::vector<float> values(k, 0.5f);
+    const std::vector<float> policy_logits(k * Game::num_dlshogi_policy());
+    mcts.simulate_expand_and_backprop_batch(
+        values.data(), policy_logits.data());
+    for (uint ii = 0u; ii < root->get_num_child(); ++ii) {
+        const auto ch = root->get_child(ii);
+        if (ch != nullptr)
+            CHECK_TRUE(ch->get_num_child() > 0u);
+    }
+    CHECK_EQUAL(1 + static_cast<int>(k), mcts.get_visit_count());
+}
+
+TEST(animal_shogi_node, search_with_evaluator)
+{
+    constexpr uint batch_size = 8u;
+    const auto g = Game();
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+
+    uint num_evaluated = 0u;
+    uint max_batch = 0u;
+    mcts.search(
+        g,
+        300,
+        batch_size,
+        [&num_evaluated, &max_batch](
+            const uint n, const float*, float* values, float* logits) {
+            std::fill_n(values, n, 0.f);
+            std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+            num_evaluated += n;
+            max_batch = std::max(max_batch, n);
+        });
+
+    CHECK_EQUAL(1 + 300, mcts.get_visit_count());
+    CHECK_TRUE(num_evaluated > 0u);
+    CHECK_EQUAL(batch_size, max_batch);
+    const auto root = mcts.get_root();
+    int sum = 0;
+    for (uint ii = 0u; ii < root->get_num_child(); ++ii) {
+        const auto ch = root->get_child(ii);
+        CHECK_TRUE((ch == nullptr) || !ch->is_pending_evaluation());
+        sum += root->get_visit_counts()[ii];
+    }
+    CHECK_EQUAL(300, sum);
+}
+
+TEST(animal_shogi_node, search_with_only_child_pending)
+{
+    uint num_evaluated = 0u;
+    const auto evaluate = [&num_evaluated](
+                              const uint n,
+                              const float*,
+                              float* values,
+                              float* logits) {
+        std::fill_n(values, n, 0.f);
+        std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+        num_evaluated += n;
+    };
+    const auto g = Game("1l1/3/1C1/3 b -");
+    {
+        auto mcts = Searcher(1.f, 0, 0);
+        mcts.set_game(g, 0.f, zeros);
+        CHECK_EQUAL(1, mcts.get_root()->get_num_child());
+        auto g1 = Game(g);
+        const auto leaf = mcts.select(g1);
+        CHECK_TRUE(leaf != nullptr);
+
+        // Every selection collides with the leaf left pending evaluation.
+        mcts.search(g, 10, 4u, evaluate);
+        CHECK_EQUAL(0u, num_evaluated);
+        CHECK_EQUAL(2, mcts.get_visit_count());
+        const std::atomic<bool> is_stop_requested(false);
+        mcts.search_until(g, is_stop_requested, 4u, evaluate);
+        CHECK_EQUAL(0u, num_evaluated);
+        CHECK_EQUAL(2, mcts.get_visit_count());
+    }
+    {
+        // The leaf is left pending evaluation by the evaluator throwing.
+        auto mcts = Searcher(1.f, 0, 0);
+        mcts.set_game(g, 0.f, zeros);
+        CHECK_THROWS(
+            std::runtime_error,
+            mcts.search(
+                g,
+                10,
+                4u,
+                [](const uint, const float*, float*, float*) {
+                    throw std::runtime_error("evaluation failed");
+                }));
+        mcts.search(g, 10, 4u, evaluate);
+        CHECK_EQUAL(0u, num_evaluated);
+        CHECK_EQUAL(2, mcts.get_visit_count());
+    }
+}
+
+TEST(animal_shogi_node, search_with_time_manager)
+{
+    const auto evaluate
+        = [](const uint n, const float*, float* values, float* logits) {
+              std::fill_n(values, n, 0.f);
+              std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+          };
+    {
+        const auto g = Game();
+        auto mcts = Searcher(1.f, 0, 0);
+        mcts.set_game(g, 0.f, zeros);
+        auto tm = vshogi::engine::TimeManager(0.05);
+        mcts.search(g, tm, 4u, evaluate);
+        CHECK_TRUE(tm.get_elapsed() < 1.);
+        CHECK_TRUE(mcts.get_visit_count() > 1);
+        const auto count
+            = static_cast<std::uint64_t>(mcts.get_visit_count() - 1);
+        CHECK_TRUE(
+            tm.is_time_up(count)
+            || mcts.is_action_decided(tm.estimate_remaining_count()));
+    }
+    {
+        // The only legal move needs no search.
+        const auto g = Game("1l1/3/1C1/3 b -");
+        auto mcts = Searcher(1.f, 0, 0);
+        mcts.set_game(g, 0.f, zeros);
+        CHECK_EQUAL(1, mcts.get_root()->get_num_child());
+        auto tm = vshogi::engine::TimeManager(10.);
+        mcts.search(g, tm, 4u, evaluate);
+        CHECK_EQUAL(1, mcts.get_visit_count());
+    }
+}
+
+TEST(animal_shogi_node, kldgain)
+{
+    const auto evaluate
+        = [](const uint n, const float*, float* values, float* logits) {
+              std::fill_n(values, n, 0.f);
+              std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+          };
+    const auto g = Game();
+    {
+        auto mcts = Searcher(1.f, 0, 0);
+        mcts.set_game(g, 0.f, zeros);
+        CHECK_TRUE(std::isinf(mcts.get_kldgain()));
+        mcts.search(g, 50, 1u, evaluate);
+        mcts.snapshot_visit_counts();
+        DOUBLES_EQUAL(0.f, mcts.get_kldgain(), 1e-6f);
+        CHECK_EQUAL(0, mcts.get_visit_count_since_snapshot());
+        mcts.search(g, 50, 1u, evaluate);
+        CHECK_EQUAL(50, mcts.get_visit_count_since_snapshot());
+        CHECK_TRUE(mcts.get_kldgain() > 0.f);
+        mcts.apply(Move(SQ_B2, SQ_B3));
+        CHECK_TRUE(std::isinf(mcts.get_kldgain()));
+    }
+    {
+        // Any gain is small enough to stop at the first check.
+        auto mcts = Searcher(1.f, 0, 0);
+        mcts.set_game(g, 0.f, zeros);
+        mcts.search(g, 1000, 1u, evaluate, 1e9f, 30);
+        CHECK_EQUAL(1 + 30, mcts.get_visit_count());
+    }
+    {
+        // No gain is small enough to stop.
+        auto mcts = Searcher(1.f, 0, 0);
+        mcts.set_game(g, 0.f, zeros);
+        mcts.search(g, 300, 1u, evaluate, 1e-30f, 30);
+        CHECK_EQUAL(1 + 300, mcts.get_visit_count());
+    }
+}
+
+TEST(animal_shogi_node, stats)
+{
+    const auto evaluate
+        = [](const uint n, const float*, float* values, float* logits) {
+              std::fill_n(values, n, 0.f);
+              std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+          };
+    const auto g = Game();
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+    CHECK_TRUE(mcts.get_stats() == nullptr);
+    mcts.set_stats_enabled(true);
+    mcts.search(g, 300, 4u, evaluate);
+
+    using vshogi::engine::SearchStats;
+    const SearchStats* const stats = mcts.get_stats();
+    CHECK_TRUE(stats != nullptr);
+    const auto num_selections = SearchStats::get(stats->num_selections);
+    CHECK_EQUAL(
+        static_cast<std::uint64_t>(mcts.get_visit_count() - 1)
+            + SearchStats::get(stats->num_collisions),
+        num_selections);
+    CHECK_EQUAL(
+        SearchStats::get(stats->batch_size),
+        SearchStats::get(stats->num_expanded));
+    std::uint64_t sum = 0u;
+    for (const auto& c : stats->depth_histogram)
+        sum += SearchStats::get(c);
+    CHECK_EQUAL(num_selections, sum);
+    CHECK_EQUAL(0u, SearchStats::get(stats->depth_histogram[0]));
+    CHECK_TRUE(SearchStats::get(stats->num_batches) > 0u);
+    CHECK_TRUE(stats->get_batch_fill_ratio() > 0.);
+    CHECK_TRUE(stats->get_batch_fill_ratio() <= 1.);
+    CHECK_TRUE(SearchStats::get(stats->selection_ns) > 0u);
+    CHECK_TRUE(SearchStats::get(stats->feature_ns) > 0u);
+
+    mcts.set_stats_enabled(false);
+    CHECK_TRUE(mcts.get_stats() == nullptr);
+}
+
+TEST(animal_shogi_node, search_gumbel)
+{
+    const auto evaluate
+        = [](const uint n, const float*, float* values, float* logits) {
+              std::fill_n(values, n, 0.f);
+              std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+          };
+    {
+        // The chick captures the lion to win, which is not favored by prior.
+        const auto g = Game("1l1/1C1/3/1L1 b -");
+        auto mcts = Searcher(1.f, 0, 0);
+        mcts.set_game(g, 0.f, zeros);
+        const uint num = mcts.get_root()->get_num_child();
+        CHECK_TRUE(num > 2u);
+
+        const auto params = vshogi::engine::mcts::GumbelParams{16u, 0.f};
+        const auto action = mcts.search_gumbel(g, 32, 4u, evaluate, params);
+        CHECK_TRUE(Move(SQ_B1, SQ_B2) == action);
+
+        // Each phase visits every remaining action equally.
+        const auto root = mcts.get_root();
+        int sum = 0;
+        int num_visited = 0;
+        for (uint ii = 0u; ii < num; ++ii) {
+            const auto ch = root->get_child(ii);
+            CHECK_TRUE((ch == nullptr) || !ch->is_pending_evaluation());
+            sum += root->get_visit_counts()[ii];
+            num_visited += (root->get_visit_counts()[ii] > 0);
+        }
+        CHECK_EQUAL(static_cast<int>(num), num_visited);
+        CHECK_EQUAL(mcts.get_visit_count() - 1, sum);
+        CHECK_TRUE(sum <= 32);
+        CHECK_EQUAL(sum, root->get_visit_count_excluding_random() - 1);
+
+        const auto policy = mcts.get_improved_policy(params);
+        CHECK_EQUAL(num, policy.size());
+        uint argmax = 0u;
+        for (uint ii = 1u; ii < num; ++ii) {
+            if (policy[ii] > policy[argmax])
+                argmax = ii;
+        }
+        CHECK_TRUE(action == root->get_actions()[argmax]);
+        CHECK_TRUE(policy[argmax] > 0.5f);
+    }
+    {
+        // Without noise, only one sampled action needs no search.
+        const auto g = Game();
+        auto mcts = Searcher(1.f, 0, 0);
+        std::vector<float> logits(Game::num_dlshogi_policy(), 0.f);
+        const auto best = Move(SQ_B2, SQ_B3);
+        logits[best.to_dlshogi_policy_index(g.get_turn())] = 3.f;
+        mcts.set_game(g, 0.f, logits.data());
+        const auto params = vshogi::engine::mcts::GumbelParams{1u, 0.f};
+        CHECK_TRUE(best == mcts.search_gumbel(g, 100, 4u, evaluate, params));
+        CHECK_EQUAL(1, mcts.get_visit_count());
+    }
+    {
+        // Sampled actions are reproducible with the same seed.
+        const auto g = Game();
+        auto a = Searcher(1.f, 0, 0, 7u);
+        auto b = Searcher(1.f, 0, 0, 7u);
+        a.set_game(g, 0.f, zeros);
+        b.set_game(g, 0.f, zeros);
+        const auto params = vshogi::engine::mcts::GumbelParams{2u};
+        CHECK_TRUE(
+            a.search_gumbel(g, 20, 1u, evaluate, params)
+            == b.search_gumbel(g, 20, 1u, evaluate, params));
+        CHECK_EQUAL(a.get_visit_count(), b.get_visit_count());
+    }
+}
+
+TEST(animal_shogi_node, transpositions_with_eval_cache)
+{
+    const auto g = Game();
+    for (const bool use_eval_cache : {false, true}) {
+        auto mcts = Searcher(1.f, 0, 0);
+        if (use_eval_cache)
+            mcts.set_eval_cache(
+                std::make_shared<vshogi::engine::EvalCache>(1024u));
+        mcts.set_game(g, 0.f, zeros);
+
+        int num_evaluated = 0;
+        int num_transposed = 0;
+        for (int ii = 300; ii--;) {
+            auto g_copy = Game(g);
+            const auto n = mcts.select(g_copy);
+            if (n != nullptr) {
+                ++num_evaluated;
+                mcts.simulate_expand_and_backprop(
+                    n,
+                    g_copy.get_legal_moves(),
+                    g_copy.get_turn(),
+                    0.f,
+                    zeros,
+                    g_copy.get_zobrist_hash());
+            } else if (g_copy.get_result() == vshogi::ONGOING) {
+                ++num_transposed;
+            }
+        }
+        CHECK_EQUAL(301, mcts.get_visit_count());
+        CHECK_EQUAL(use_eval_cache, num_transposed > 0);
+        CHECK_TRUE(num_evaluated + num_transposed <= 300);
+
+        const auto root = mcts.get_root();
+        int sum = 0;
+        for (const int count : root->get_visit_counts())
+            sum += count;
+        CHECK_EQUAL(300, sum);
+    }
+}
+
+TEST(animal_shogi_node, explore_in_parallel)
+{
+    constexpr int num_threads = 4;
+    constexpr int num_select_per_thread = 200;
+    const auto g = Game();
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+
+    std::vector<std::thread> threads;
+    for (int ii = num_threads; ii--;) {
+        threads.emplace_back([&mcts, &g]() {
+            for (int jj = num_select_per_thread; jj--;) {
+                auto g_copy = Game(g);
+                const auto n = mcts.select(g_copy);
+                if (n != nullptr)
+                    mcts.simulate_expand_and_backprop(
+                        n,
+                        g_copy.get_legal_moves(),
+                        g_copy.get_turn(),
+                        0.f,
+                        zeros);
+            }
+        });
+    }
+    for (auto&& t : threads)
+        t.join();
+
+    const auto root = mcts.get_root();
+    const int visit_count = root->get_visit_count();
+    CHECK_TRUE(visit_count > 1);
+    CHECK_TRUE(visit_count <= 1 + num_threads * num_select_per_thread);
+    int sum = 0;
+    for (const int count : root->get_visit_counts())
+        sum += count;
+    CHECK_EQUAL(visit_count - 1, sum);
+    CHECK_EQUAL(visit_count, root->get_visit_count_excluding_random());
+}
+
+TEST(animal_shogi_node, compact_layout)
+{
+    using FullSearcher = vshogi::engine::mcts::
+        Searcher<Game, Move, vshogi::engine::mcts::FullLayout>;
+    using CompactSearcher = vshogi::engine::mcts::
+        Searcher<Game, Move, vshogi::engine::mcts::CompactLayout>;
+    auto g = Game();
+    auto full = FullSearcher(4.f, 3, 1);
+    auto compact = CompactSearcher(4.f, 3, 1);
+    full.set_game(g, 0.f, zeros);
+    compact.set_game(g, 0.f, zeros);
+    CHECK_TRUE(compact.get_memory_usage() < full.get_memory_usage());
+    const auto root = compact.get_root();
+    for (uint ii = 0u; ii < root->get_num_child(); ++ii) {
+        DOUBLES_EQUAL(
+            full.get_root()->get_probas()[ii], root->get_probas()[ii], 1e-3f);
+    }
+
+    while (g.get_result() == vshogi::ONGOING) {
+        for (int ii = (100 - compact.get_visit_count()); ii--;) {
+            auto g_copy = Game(g);
+            const auto n = compact.select(g_copy);
+            if (n != nullptr)
+                compact.simulate_expand_and_backprop(
+                    n,
+                    g_copy.get_legal_moves(),
+                    g_copy.get_turn(),
+                    0.f,
+                    zeros);
+        }
+        CHECK_TRUE(compact.get_visit_count() >= 100);
+        int sum = 0;
+        for (const int count : compact.get_root()->get_visit_counts())
+            sum += count;
+        CHECK_EQUAL(compact.get_visit_count() - 1, sum);
+
+        const auto action = compact.get_action_by_visit_max();
+        g.apply(action);
+        compact.apply(action);
+    }
+}
+
+TEST(animal_shogi_node, compact_layout_siblings_share_line)
+{
+    using Children = vshogi::engine::mcts::
+        Children<Game, Move, vshogi::engine::mcts::CompactLayout>;
+    auto arena = Children::ArenaType();
+    const auto block = Children::create(arena, nullptr, 3u);
+    const std::size_t block_size = arena.size();
+    const auto first = block->node(1u);
+    CHECK_EQUAL(block_size + 1u, arena.size());
+    CHECK_TRUE(block->node(0u) != first);
+    CHECK_EQUAL(block_size + 1u, arena.size());
+    block->node(2u);
+    CHECK_EQUAL(block_size + 2u, arena.size());
+    CHECK_EQUAL(first, block->find_node(1u));
+    CHECK_EQUAL(block, Children::block_of(*block->node(0u)));
+    CHECK_EQUAL(block, Children::block_of(*first));
+
+    Children::release(arena, block);
+    CHECK_EQUAL(0u, arena.size());
+}
+
+TEST(animal_shogi_node, compact_layout_in_parallel)
+{
+    using CompactSearcher = vshogi::engine::mcts::
+        Searcher<Game, Move, vshogi::engine::mcts::CompactLayout>;
+    constexpr int num_threads = 4;
+    constexpr int num_select_per_thread = 200;
+    const auto g = Game();
+    auto mcts = CompactSearcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+
+    std::vector<std::thread> threads;
+    for (int ii = num_threads; ii--;) {
+        threads.emplace_back([&mcts, &g]() {
+            for (int jj = num_select_per_thread; jj--;) {
+                auto g_copy = Game(g);
+                const auto n = mcts.select(g_copy);
+                if (n != nullptr)
+                    mcts.simulate_expand_and_backprop(
+                        n,
+                        g_copy.get_legal_moves(),
+                        g_copy.get_turn(),
+                        0.f,
+                        zeros);
+            }
+        });
+    }
+    for (auto&& t : threads)
+        t.join();
+
+    const auto root = mcts.get_root();
+    const int visit_count = root->get_visit_count();
+    CHECK_TRUE(visit_count > 1);
+    int sum = 0;
+    for (const int count : root->get_visit_counts())
+        sum += count;
+    CHECK_EQUAL(visit_count - 1, sum);
+}
+
 } // namespace test_animal_shogi
 
 namespace test_minishogi
@@ -324,8 +1023,12 @@ TEST(minishogi_node, explore_until_game_end)
             auto g_copy = Game(g);
             const auto n = mcts.select(g_copy);
             if (n != nullptr)
-                n->simulate_expand_and_backprop(
-                    g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
+                mcts.simulate_expand_and_backprop(
+                    n,
+                    g_copy.get_legal_moves(),
+                    g_copy.get_turn(),
+                    0.f,
+                    zeros);
         }
 
         const auto action = mcts.get_action_by_visit_max();
@@ -358,8 +1061,12 @@ TEST(judkins_shogi_node, explore_until_game_end)
             auto g_copy = Game(g);
             const auto n = mcts.select(g_copy);
             if (n != nullptr)
-                n->simulate_expand_and_backprop(
-                    g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
+                mcts.simulate_expand_and_backprop(
+                    n,
+                    g_copy.get_legal_moves(),
+                    g_copy.get_turn(),
+                    0.f,
+                    zeros);
         }
 
         const auto action = mcts.get_action_by_visit_max();
@@ -392,8 +1099,12 @@ TEST(shogi_node, explore_until_game_end)
             auto g_copy = Game(g);
             const auto n = mcts.select(g_copy);
             if (n != nullptr)
-                n->simulate_expand_and_backprop(
-                    g_copy.get_legal_moves(), g_copy.get_turn(), 0.f, zeros);
+                mcts.simulate_expand_and_backprop(
+                    n,
+                    g_copy.get_legal_moves(),
+                    g_copy.get_turn(),
+                    0.f,
+                    zeros);
         }
 
         const auto action = mcts.get_action_by_visit_max();
@@ -402,6 +1113,158 @@ TEST(shogi_node, explore_until_game_end)
     }
 }
 
+TEST(shogi_node, memory_capacity_bounded_by_budget)
+{
+    auto random = vshogi::engine::Random(0u);
+    std::vector<float> logits(Game::num_dlshogi_policy());
+    const auto randomize = [&random, &logits]() {
+        for (auto&& x : logits)
+            x = random.uniform() * 8.f;
+        return logits.data();
+    };
+    auto g = Game();
+    auto mcts = Searcher(4.f, 3, 1);
+    constexpr std::size_t budget = 1024u * 1024u;
+    mcts.set_memory_budget(budget);
+    mcts.set_game(g, 0.f, randomize());
+    std::size_t capacity = 0u;
+    for (int ply = 0; (ply < 60) && (g.get_result() == vshogi::ONGOING);
+         ++ply) {
+        // Sizes of the blocks of children vary from a position to another.
+        for (int ii = 1000; ii--;) {
+            auto g_copy = Game(g);
+            const auto n = mcts.select(g_copy);
+            if (n != nullptr)
+                mcts.simulate_expand_and_backprop(
+                    n,
+                    g_copy.get_legal_moves(),
+                    g_copy.get_turn(),
+                    0.f,
+                    randomize());
+        }
+        const auto action = mcts.get_action_by_visit_max();
+        g.apply(action);
+        mcts.apply(action);
+        if (ply == 10)
+            capacity = mcts.get_memory_capacity();
+    }
+    CHECK_TRUE(mcts.get_memory_capacity() <= capacity);
+    CHECK_TRUE(mcts.get_memory_capacity() <= budget * 2u);
+}
+
+TEST(shogi_node, cancel_select_deeper_than_random_depth)
+{
+    using Arena = vshogi::engine::mcts::Children<Game, Move>::ArenaType;
+    constexpr int chain_depth = 80;
+    auto random = vshogi::engine::Random(0u);
+    const auto pick = [&random](const Game& g) {
+        const auto& moves = g.get_legal_moves();
+        return std::vector<Move>{moves[random() % moves.size()]};
+    };
+    const auto g = Game();
+    auto arena = Arena();
+    auto root = Node::create_root(arena, pick(g), g.get_turn(), 0.f, zeros);
+
+    // A chain of nodes, the first of which is selected in random manner.
+    for (int ii = chain_depth; ii--;) {
+        auto g_copy = Game(g);
+        const auto n = root->select(g_copy, 1.f, 0, 1, random);
+        CHECK_TRUE(n != nullptr);
+        n->simulate_expand_and_backprop(
+            arena, pick(g_copy), g_copy.get_turn(), 0.f, zeros);
+    }
+    {
+        auto g_copy = Game(g);
+        CHECK_TRUE(root->select(g_copy, 1.f, 0, 1, random) != nullptr);
+    }
+    std::vector<int> expected;
+    for (const Node* n = root; n != nullptr; n = n->get_child())
+        expected.emplace_back(n->get_visit_count_excluding_random());
+    CHECK_EQUAL(chain_depth + 2, static_cast<int>(expected.size()));
+
+    {
+        // Collides with the leaf pending evaluation.
+        auto g_copy = Game(g);
+        CHECK_TRUE(root->select(g_copy, 1.f, 0, 1, random) == nullptr);
+    }
+    std::vector<int> actual;
+    for (const Node* n = root; n != nullptr; n = n->get_child())
+        actual.emplace_back(n->get_visit_count_excluding_random());
+    CHECK_TRUE(expected == actual);
+}
+
+TEST(shogi_node, children_sorted_by_prior)
+{
+    auto random = vshogi::engine::Random(0u);
+    std::vector<float> logits(Game::num_dlshogi_policy());
+    const auto randomize = [&random, &logits]() {
+        for (auto&& x : logits)
+            x = random.uniform() * 8.f;
+        return logits.data();
+    };
+    // Many drops are legal in this position.
+    const auto g = Game("4k4/9/9/9/9/9/9/9/4K4 b RBGSNLPrbgsnlp 1");
+    auto mcts = Searcher(4.f, 3, 1);
+    mcts.set_game(g, 0.f, randomize());
+    const auto root = mcts.get_root();
+    CHECK_TRUE(root->get_num_child() > 150u);
+    const auto probas = root->get_probas();
+    CHECK_TRUE(std::is_sorted(probas.crbegin(), probas.crend()));
+
+    for (int ii = 500; ii--;) {
+        auto g_copy = Game(g);
+        const auto n = mcts.select(g_copy);
+        if (n != nullptr)
+            mcts.simulate_expand_and_backprop(
+                n,
+                g_copy.get_legal_moves(),
+                g_copy.get_turn(),
+                random.uniform() * 2.f - 1.f,
+                randomize());
+    }
+    int sum = 0;
+    for (const int count : root->get_visit_counts())
+        sum += count;
+    CHECK_EQUAL(mcts.get_visit_count() - 1, sum);
+    CHECK_TRUE(root->get_visit_counts()[0] > 0);
+}
+
+TEST(shogi_node, compact_layout_memory_usage)
+{
+    using FullSearcher = vshogi::engine::mcts::
+        Searcher<Game, Move, vshogi::engine::mcts::FullLayout>;
+    using CompactSearcher = vshogi::engine::mcts::
+        Searcher<Game, Move, vshogi::engine::mcts::CompactLayout>;
+    const auto g = Game();
+    auto full = FullSearcher(4.f, 3, 1);
+    auto compact = CompactSearcher(4.f, 3, 1);
+    full.set_game(g, 0.f, zeros);
+    compact.set_game(g, 0.f, zeros);
+    for (int ii = 100; ii--;) {
+        auto g_full = Game(g);
+        auto g_compact = Game(g);
+        const auto n_full = full.select(g_full);
+        const auto n_compact = compact.select(g_compact);
+        if (n_full != nullptr)
+            full.simulate_expand_and_backprop(
+                n_full,
+                g_full.get_legal_moves(),
+                g_full.get_turn(),
+                0.f,
+                zeros);
+        if (n_compact != nullptr)
+            compact.simulate_expand_and_backprop(
+                n_compact,
+                g_compact.get_legal_moves(),
+                g_compact.get_turn(),
+                0.f,
+                zeros);
+    }
+    CHECK_EQUAL(101, compact.get_visit_count());
+    CHECK_TRUE(
+        compact.get_memory_usage() * 5u < full.get_memory_usage() * 4u);
+}
+
 } // namespace test_shogi
 
 } // namespace test_vshogi::test_engine
@@ -0,0 +1,128 @@
+#include "vshogi/engine/multi_game_searcher.hpp"
+#include "vshogi/variants/animal_shogi.hpp"
+#include "vshogi/variants/shogi.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_multi_game_searcher
+{
+
+using namespace vshogi::animal_shogi;
+using MultiGameSearcher
+    = vshogi::engine::mcts::MultiGameSearcher<Game, Move>;
+
+TEST_GROUP(multi_game_searcher){};
+
+TEST(multi_game_searcher, step)
+{
+    constexpr uint num_games = 4u;
+    constexpr uint leaves_per_game = 4u;
+    constexpr uint max_moves = 10u;
+    auto searcher
+        = MultiGameSearcher(Game(), num_games, 20, max_moves, 1.f, 0, 0);
+    std::vector<uint> batch_sizes;
+    const auto evaluate = [&batch_sizes](
+                              const uint n,
+                              const float*,
+                              float* values,
+                              float* logits) {
+        std::fill_n(values, n, 0.f);
+        std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+        batch_sizes.emplace_back(n);
+    };
+    CHECK_EQUAL(num_games, searcher.get_num_games());
+
+    // Roots of all the games are evaluated at once first.
+    CHECK_EQUAL(num_games, searcher.step(evaluate, leaves_per_game));
+    for (uint ii = 0u; ii < num_games; ++ii)
+        CHECK_EQUAL(1, searcher.get_searcher(ii).get_visit_count());
+
+    for (int ii = 1000; ii-- && (searcher.get_num_records() < num_games);)
+        searcher.step(evaluate, leaves_per_game);
+    CHECK_TRUE(searcher.get_num_records() >= num_games);
+    for (const uint n : batch_sizes)
+        CHECK_TRUE(n <= num_games * leaves_per_game);
+    CHECK_TRUE(
+        *std::max_element(batch_sizes.cbegin(), batch_sizes.cend())
+        > leaves_per_game);
+
+    const auto records = searcher.pop_records();
+    CHECK_EQUAL(0u, searcher.get_num_records());
+    for (const auto& r : records) {
+        CHECK_TRUE(
+            (r.game.get_result() != vshogi::ONGOING)
+            || (r.game.record_length() == max_moves));
+        CHECK_EQUAL(r.game.record_length(), r.plies.size());
+        for (std::size_t ii = 0u; ii < r.plies.size(); ++ii) {
+            const auto& ply = r.plies[ii];
+            CHECK_TRUE(ply.action == r.game.get_move_at(ii));
+            int sum = 0;
+            for (const auto& e : ply.root_stats.get_entries())
+                sum += e.visit_count;
+            CHECK_TRUE(sum >= 1);
+            CHECK_TRUE(sum <= 20 + static_cast<int>(leaves_per_game));
+        }
+    }
+
+    // Restarted games go on from the initial game position.
+    for (uint ii = 0u; ii < num_games; ++ii)
+        CHECK_TRUE(searcher.get_game(ii).record_length() < max_moves);
+}
+
+TEST(multi_game_searcher, random_moves)
+{
+    const auto evaluate
+        = [](const uint n, const float*, float* values, float* logits) {
+              std::fill_n(values, n, 0.f);
+              std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+          };
+    auto searcher = MultiGameSearcher(Game(), 8u, 4, 2u, 1.f, 0, 0, 1u);
+    searcher.set_random_moves(2u, 1e3f);
+    while (searcher.get_num_records() < 8u)
+        searcher.step(evaluate, 2u);
+    const auto records = searcher.pop_records();
+    std::vector<std::pair<Move, Move>> openings;
+    for (const auto& r : records) {
+        CHECK_EQUAL(2u, r.game.record_length());
+        openings.emplace_back(r.game.get_move_at(0), r.game.get_move_at(1));
+    }
+    const auto& first = openings.front();
+    CHECK_TRUE(std::any_of(
+        openings.cbegin(), openings.cend(), [&first](const auto& o) {
+            return !((o.first == first.first) && (o.second == first.second));
+        }));
+}
+
+TEST(multi_game_searcher, single_legal_move)
+{
+    using ShogiGame = vshogi::shogi::Game;
+    using ShogiSearcher = vshogi::engine::mcts::
+        MultiGameSearcher<ShogiGame, vshogi::shogi::Move>;
+    const auto evaluate
+        = [](const uint n, const float*, float* values, float* logits) {
+              std::fill_n(values, n, 0.f);
+              std::fill_n(logits, n * ShogiGame::num_dlshogi_policy(), 0.f);
+          };
+    const auto initial = ShogiGame("r7k/9/9/9/9/9/2s6/9/K8 b - 1");
+    CHECK_EQUAL(1u, initial.get_legal_moves().size());
+    const auto only_move = initial.get_legal_moves()[0];
+    auto searcher = ShogiSearcher(initial, 1u, 10, 1u, 1.f, 0, 0);
+    while (searcher.get_num_records() == 0u)
+        searcher.step(evaluate);
+    const auto records = searcher.pop_records();
+    CHECK_EQUAL(1u, records[0].game.record_length());
+    CHECK_TRUE(only_move == records[0].game.get_move_at(0));
+    CHECK_TRUE(only_move == records[0].plies[0].action);
+    CHECK_EQUAL(vshogi::ONGOING, records[0].game.get_result());
+}
+
+} // namespace test_multi_game_searcher
+
+} // namespace test_vshogi::test_engine
@@ -0,0 +1,117 @@
+#include "vshogi/engine/pipeline.hpp"
+#include "vshogi/variants/animal_shogi.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_pipeline
+{
+
+using namespace vshogi::animal_shogi;
+using Searcher = vshogi::engine::mcts::Searcher<Game, Move>;
+using Pipeline = vshogi::engine::mcts::Pipeline<Game, Move>;
+static constexpr float zeros[Game::num_dlshogi_policy()] = {0.f};
+
+TEST_GROUP(pipeline){};
+
+TEST(pipeline, search)
+{
+    constexpr uint batch_size = 8u;
+    const auto g = Game();
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+
+    std::atomic<uint> num_evaluated(0u);
+    std::atomic<uint> max_batch(0u);
+    {
+        auto pipeline = Pipeline(
+            mcts,
+            [&num_evaluated, &max_batch](
+                const uint n, const float*, float* values, float* logits) {
+                std::fill_n(values, n, 0.f);
+                std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+                num_evaluated += n;
+                if (n > max_batch)
+                    max_batch = n;
+            },
+            batch_size,
+            32u);
+        pipeline.search(g, 500, 4u);
+
+        // All the selected leaves are evaluated when `search()` returns.
+        const auto root = mcts.get_root();
+        const int visit_count = root->get_visit_count();
+        CHECK_TRUE(visit_count > 1);
+        CHECK_TRUE(visit_count <= 1 + 500);
+        CHECK_TRUE(num_evaluated > 0u);
+        CHECK_TRUE(num_evaluated < static_cast<uint>(visit_count));
+        CHECK_TRUE(max_batch <= batch_size);
+        int sum = 0;
+        for (uint ii = 0u; ii < root->get_num_child(); ++ii) {
+            const auto ch = root->get_child(ii);
+            if (ch == nullptr)
+                continue;
+            CHECK_FALSE(ch->is_pending_evaluation());
+            sum += ch->get_visit_count();
+        }
+        CHECK_EQUAL(visit_count - 1, sum);
+
+        pipeline.search(g, 100, 2u);
+        CHECK_TRUE(root->get_visit_count() > visit_count);
+    }
+}
+
+TEST(pipeline, stats)
+{
+    using vshogi::engine::SearchStats;
+    const auto g = Game();
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+    mcts.set_stats_enabled(true);
+    {
+        auto pipeline = Pipeline(
+            mcts,
+            [](const uint n, const float*, float* values, float* logits) {
+                std::fill_n(values, n, 0.f);
+                std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+            },
+            8u,
+            32u);
+        pipeline.search(g, 300, 4u);
+    }
+    const SearchStats* const stats = mcts.get_stats();
+    CHECK_EQUAL(
+        SearchStats::get(stats->batch_size),
+        SearchStats::get(stats->num_expanded));
+    CHECK_TRUE(SearchStats::get(stats->num_batches) > 0u);
+    CHECK_TRUE(stats->get_batch_fill_ratio() <= 1.);
+    CHECK_TRUE(SearchStats::get(stats->selection_ns) > 0u);
+    CHECK_TRUE(SearchStats::get(stats->evaluation_ns) > 0u);
+    CHECK_TRUE(SearchStats::get(stats->backprop_ns) > 0u);
+}
+
+TEST(pipeline, evaluator_throws)
+{
+    const auto g = Game();
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+    auto pipeline = Pipeline(
+        mcts,
+        [](const uint, const float*, float*, float*) {
+            throw std::runtime_error("evaluation failed");
+        },
+        4u,
+        8u);
+
+    CHECK_THROWS(std::runtime_error, pipeline.search(g, 100, 2u));
+}
+
+} // namespace test_pipeline
+
+} // namespace test_vshogi::test_engine
@@ -0,0 +1,98 @@
+#include "vshogi/engine/ponderer.hpp"
+#include "vshogi/variants/animal_shogi.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_ponderer
+{
+
+using namespace vshogi::animal_shogi;
+using Searcher = vshogi::engine::mcts::Searcher<Game, Move>;
+using Ponderer = vshogi::engine::mcts::Ponderer<Game, Move>;
+static constexpr float zeros[Game::num_dlshogi_policy()] = {0.f};
+
+TEST_GROUP(ponderer){};
+
+TEST(ponderer, start_and_stop)
+{
+    auto g = Game();
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+
+    std::atomic<uint> num_evaluated(0u);
+    auto ponderer = Ponderer(
+        mcts,
+        [&num_evaluated](
+            const uint n, const float*, float* values, float* logits) {
+            std::fill_n(values, n, 0.f);
+            std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+            num_evaluated += n;
+        },
+        4u);
+    CHECK_FALSE(ponderer.is_pondering());
+
+    ponderer.start(g);
+    CHECK_TRUE(ponderer.is_pondering());
+    while (num_evaluated < 100u)
+        std::this_thread::yield();
+    ponderer.stop();
+    CHECK_FALSE(ponderer.is_pondering());
+    CHECK_TRUE(mcts.get_visit_count() > 100);
+
+    // The subtree of the opponent's move is kept.
+    const auto action = mcts.get_action_by_visit_max();
+    const auto root = mcts.get_root();
+    const int visit_count = root->get_child(action)->get_visit_count();
+    mcts.apply(action);
+    g.apply(action);
+    CHECK_EQUAL(visit_count, mcts.get_visit_count());
+
+    // Pondering continues from the subtree.
+    num_evaluated = 0u;
+    ponderer.start(g);
+    while (num_evaluated < 10u)
+        std::this_thread::yield();
+    ponderer.request_stop();
+    ponderer.stop();
+    CHECK_FALSE(ponderer.is_pondering());
+    CHECK_TRUE(mcts.get_visit_count() > visit_count);
+}
+
+TEST(ponderer, rethrow_exception_of_evaluator)
+{
+    const auto g = Game();
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+
+    std::atomic<bool> is_called(false);
+    auto ponderer = Ponderer(
+        mcts,
+        [&is_called](const uint, const float*, float*, float*) {
+            is_called = true;
+            throw std::runtime_error("evaluation failed");
+        },
+        4u);
+    ponderer.start(g);
+    while (!is_called)
+        std::this_thread::yield();
+
+    // Not pondering any more once the background thread exits.
+    for (int ii = 10000; ii-- && ponderer.is_pondering();)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK_FALSE(ponderer.is_pondering());
+    CHECK_THROWS(std::runtime_error, ponderer.stop());
+    ponderer.stop(); // Thrown only once.
+}
+
+} // namespace test_ponderer
+
+} // namespace test_vshogi::test_engine
@@ -0,0 +1,181 @@
+#include "vshogi/engine/puct.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_puct
+{
+
+using vshogi::uint;
+namespace mcts = vshogi::engine::mcts;
+using vshogi::engine::mcts::CompactPuctInputs;
+using vshogi::engine::mcts::PuctInputs;
+
+struct Children
+{
+    std::vector<float> probas;
+    std::vector<int> visit_counts;
+    std::vector<float> q_values;
+    std::vector<char> is_mate; // `std::vector<bool>` is not contiguous.
+    std::vector<int> virtual_losses;
+
+    Children(const uint size, const uint seed)
+        : probas(size), visit_counts(size), q_values(size), is_mate(size),
+          virtual_losses(size)
+    {
+        uint x = seed;
+        for (uint ii = 0u; ii < size; ++ii) {
+            x = x * 1103515245u + 12345u;
+            probas[ii] = static_cast<float>((x >> 8u) % 1000u) / 1000.f;
+            visit_counts[ii] = static_cast<int>((x >> 4u) % 5u);
+            q_values[ii] = static_cast<float>((x >> 12u) % 201u) / 100.f - 1.f;
+            is_mate[ii] = ((x >> 20u) % 7u) == 0u;
+            virtual_losses[ii] = static_cast<int>((x >> 24u) % 3u);
+            if (virtual_losses[ii] > visit_counts[ii])
+                virtual_losses[ii] = 0;
+        }
+    }
+    PuctInputs inputs() const
+    {
+        return PuctInputs{
+            probas.data(),
+            visit_counts.data(),
+            q_values.data(),
+            reinterpret_cast<const bool*>(is_mate.data()),
+            virtual_losses.data(),
+            static_cast<uint>(probas.size())};
+    }
+};
+
+TEST_GROUP(puct){};
+
+TEST(puct, scalar)
+{
+    const float probas[] = {0.2f, 0.5f, 0.3f};
+    const int visit_counts[] = {3, 0, 1};
+    const float q_values[] = {-0.5f, 0.f, 0.9f};
+    const bool is_mate[] = {false, false, false};
+    const int virtual_losses[] = {0, 0, 0};
+    const auto in = PuctInputs{
+        probas, visit_counts, q_values, is_mate, virtual_losses, 3u};
+
+    // Scores are {0.5 + 0.2 * 2 / 4, 0.1 + 0.5 * 2, -0.9 + 0.3 * 2 / 2}.
+    CHECK_EQUAL(1u, mcts::puct_argmax_scalar(in, 1.f, 2.f, 0.1f));
+    CHECK_EQUAL(0u, mcts::puct_argmax_scalar(in, 0.f, 2.f, 0.1f));
+}
+
+TEST(puct, scalar_mate_to_lose)
+{
+    const float probas[] = {0.9f, 0.1f};
+    const int visit_counts[] = {0, 1};
+    const float q_values[] = {0.f, -1.f};
+    const bool is_mate[] = {false, true};
+    const int virtual_losses[] = {0, 0};
+    const auto in = PuctInputs{
+        probas, visit_counts, q_values, is_mate, virtual_losses, 2u};
+
+    CHECK_EQUAL(1u, mcts::puct_argmax_scalar(in, 1.f, 1.f, 0.f));
+}
+
+TEST(puct, scalar_tie)
+{
+    const float probas[] = {0.25f, 0.25f, 0.25f, 0.25f};
+    const int visit_counts[] = {0, 0, 0, 0};
+    const float q_values[] = {0.f, 0.f, 0.f, 0.f};
+    const bool is_mate[] = {false, false, false, false};
+    const int virtual_losses[] = {0, 0, 0, 0};
+    const auto in = PuctInputs{
+        probas, visit_counts, q_values, is_mate, virtual_losses, 4u};
+
+    CHECK_EQUAL(0u, mcts::puct_argmax_scalar(in, 1.f, 1.f, 0.f));
+}
+
+TEST(puct, scalar_virtual_loss)
+{
+    const float probas[] = {0.5f, 0.5f};
+    const int visit_counts[] = {2, 2};
+    const float q_values[] = {0.f, 0.25f};
+    const bool is_mate[] = {false, false};
+    const int virtual_losses[] = {1, 0};
+    const auto in = PuctInputs{
+        probas, visit_counts, q_values, is_mate, virtual_losses, 2u};
+
+    // Q values from the parent's view are {-(0 * 1 + 1) / 2, -0.25}.
+    CHECK_EQUAL(1u, mcts::puct_argmax_scalar(in, 0.f, 1.f, 0.f));
+}
+
+TEST(puct, dispatched_kernel_matches_scalar)
+{
+    for (uint size = 1u; size < 100u; ++size) {
+        for (uint seed = 0u; seed < 10u; ++seed) {
+            const auto children = Children(size, seed);
+            const auto in = children.inputs();
+            const auto expected = mcts::puct_argmax_scalar(in, 2.f, 3.f, 0.2f);
+            CHECK_EQUAL(expected, mcts::puct_argmax(in, 2.f, 3.f, 0.2f));
+#ifdef VSHOGI_ENGINE_PUCT_X86
+            CHECK_EQUAL(expected, mcts::puct_argmax_sse2(in, 2.f, 3.f, 0.2f));
+            if (__builtin_cpu_supports("avx2")) {
+                CHECK_EQUAL(
+                    expected, mcts::puct_argmax_avx2(in, 2.f, 3.f, 0.2f));
+            }
+#endif
+        }
+    }
+}
+
+TEST(puct, dispatched_kernel_tie)
+{
+    const auto children = Children(37u, 0u);
+    auto in = children.inputs();
+    const std::vector<float> probas(37u, 0.5f);
+    const std::vector<int> visit_counts(37u, 1);
+    const std::vector<float> q_values(37u, 0.f);
+    in.probas = probas.data();
+    in.visit_counts = visit_counts.data();
+    in.q_values = q_values.data();
+    const std::vector<char> is_mate(37u, 0);
+    in.is_mate = reinterpret_cast<const bool*>(is_mate.data());
+    const std::vector<int> virtual_losses(37u, 0);
+    in.virtual_losses = virtual_losses.data();
+
+    CHECK_EQUAL(0u, mcts::puct_argmax(in, 1.f, 1.f, 0.f));
+}
+
+TEST(puct, compact_kernel_matches_scalar)
+{
+    for (uint size = 1u; size < 150u; ++size) {
+        for (uint seed = 0u; seed < 10u; ++seed) {
+            auto children = Children(size, seed);
+            std::vector<std::uint16_t> probas(size);
+            std::vector<std::uint64_t> is_mate((size + 63u) / 64u, 0u);
+            std::vector<std::int16_t> virtual_losses(size);
+            for (uint ii = 0u; ii < size; ++ii) {
+                probas[ii] = vshogi::engine::to_half(children.probas[ii]);
+                children.probas[ii] = vshogi::engine::from_half(probas[ii]);
+                if (children.is_mate[ii])
+                    is_mate[ii / 64u] |= std::uint64_t{1} << (ii % 64u);
+                virtual_losses[ii]
+                    = static_cast<std::int16_t>(children.virtual_losses[ii]);
+            }
+            const auto in = CompactPuctInputs{
+                probas.data(),
+                children.visit_counts.data(),
+                children.q_values.data(),
+                is_mate.data(),
+                virtual_losses.data(),
+                size};
+            CHECK_EQUAL(
+                mcts::puct_argmax_scalar(children.inputs(), 2.f, 3.f, 0.2f),
+                mcts::puct_argmax(in, 2.f, 3.f, 0.2f));
+        }
+    }
+}
+
+} // namespace test_puct
+
+} // namespace test_vshogi::test_engine
@@ -0,0 +1,55 @@
+#include "vshogi/engine/random.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_random
+{
+
+using Random = vshogi::engine::Random;
+
+TEST_GROUP(random){};
+
+TEST(random, reproducible)
+{
+    auto a = Random(42u);
+    auto b = Random(42u);
+    auto c = Random(43u);
+    bool is_different = false;
+    for (int ii = 0; ii < 100; ++ii) {
+        const auto x = a();
+        CHECK_EQUAL(x, b());
+        is_different |= (x != c());
+    }
+    CHECK_TRUE(is_different);
+}
+
+TEST(random, uniform)
+{
+    auto random = Random(0u);
+    constexpr int n = 10000;
+    float sum = 0.f;
+    for (int ii = 0; ii < n; ++ii) {
+        const float u = random.uniform();
+        CHECK_TRUE(0.f <= u);
+        CHECK_TRUE(u < 1.f);
+        sum += u;
+    }
+    DOUBLES_EQUAL(0.5f, sum / n, 1e-2f);
+}
+
+TEST(random, fork)
+{
+    auto a = Random(0u);
+    auto b = Random(0u);
+    auto fa = a.fork();
+    auto fb = b.fork();
+    CHECK_EQUAL(fa(), fb());
+    CHECK_TRUE(a() != fa());
+}
+
+} // namespace test_random
+
+} // namespace test_vshogi::test_engine
@@ -0,0 +1,149 @@
+#include "vshogi/engine/mcts.hpp"
+#include "vshogi/variants/animal_shogi.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_root_stats
+{
+
+using namespace vshogi::animal_shogi;
+using Searcher = vshogi::engine::mcts::Searcher<Game, Move>;
+using RootStats = vshogi::engine::mcts::RootStats<Move>;
+using Random = vshogi::engine::Random;
+static constexpr float zeros[Game::num_dlshogi_policy()] = {0.f};
+
+TEST_GROUP(root_stats){};
+
+TEST(root_stats, merge)
+{
+    const auto a = RootStats(
+        {{Move(SQ_B2, SQ_B3), 3, 2, 0.5f}, {Move(SQ_A2, SQ_B3), 1, 1, -1.f}});
+    const auto b = RootStats(
+        {{Move(SQ_C2, SQ_B3), 2, 2, 0.f}, {Move(SQ_B2, SQ_B3), 1, 1, 0.1f}});
+    auto merged = RootStats(a);
+    merged.merge(b);
+
+    const auto& entries = merged.get_entries();
+    CHECK_EQUAL(3, entries.size());
+    CHECK_TRUE(Move(SQ_B2, SQ_B3) == entries[0].action);
+    CHECK_EQUAL(4, entries[0].visit_count);
+    CHECK_EQUAL(3, entries[0].visit_count_excluding_random);
+    DOUBLES_EQUAL(0.4f, entries[0].q_value, 1e-6f);
+    CHECK_EQUAL(1, entries[1].visit_count);
+    CHECK_TRUE(Move(SQ_C2, SQ_B3) == entries[2].action);
+    CHECK_EQUAL(2, entries[2].visit_count);
+
+    CHECK_TRUE(Move(SQ_B2, SQ_B3) == merged.get_action_by_visit_max());
+    CHECK_TRUE(Move() == RootStats().get_action_by_visit_max());
+}
+
+TEST(root_stats, bytes)
+{
+    const auto a = RootStats(
+        {{Move(SQ_B2, SQ_B3), 3, 2, 0.5f}, {Move(SQ_C3, CH), 1, 1, -1.f}});
+    const std::string bytes = a.to_bytes();
+    const auto b = RootStats::from_bytes(bytes);
+
+    CHECK_EQUAL(a.get_entries().size(), b.get_entries().size());
+    for (std::size_t ii = 0u; ii < a.get_entries().size(); ++ii) {
+        const auto& x = a.get_entries()[ii];
+        const auto& y = b.get_entries()[ii];
+        CHECK_TRUE(x.action == y.action);
+        CHECK_EQUAL(x.visit_count, y.visit_count);
+        CHECK_EQUAL(
+            x.visit_count_excluding_random, y.visit_count_excluding_random);
+        CHECK_EQUAL(x.q_value, y.q_value);
+    }
+    CHECK_THROWS(
+        std::invalid_argument,
+        RootStats::from_bytes(bytes.substr(0u, bytes.size() - 1u)));
+}
+
+TEST(root_stats, q_values_for_turn_of_root)
+{
+    const auto evaluate
+        = [](const uint n, const float*, float* values, float* logits) {
+              std::fill_n(values, n, 0.f);
+              std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+          };
+    // The chick captures the lion to win.
+    const auto g = Game("1l1/1C1/3/1L1 b -");
+    auto mcts = Searcher(1.f, 0, 0);
+    mcts.set_game(g, 0.f, zeros);
+    mcts.search(g, 50, 4u, evaluate);
+
+    const auto root = mcts.get_root();
+    const auto q_values = root->get_q_values();
+    const auto stats = mcts.get_root_stats();
+    const auto& entries = stats.get_entries();
+    CHECK_EQUAL(root->get_num_child(), entries.size());
+    for (std::size_t ii = 0u; ii < entries.size(); ++ii)
+        DOUBLES_EQUAL(-q_values[ii], entries[ii].q_value, 1e-6f);
+    const auto win = std::find_if(
+        entries.cbegin(), entries.cend(), [](const auto& e) {
+            return e.action == Move(SQ_B1, SQ_B2);
+        });
+    CHECK_TRUE(win->q_value > 0.9f);
+}
+
+TEST(root_stats, merge_searchers_in_threads)
+{
+    constexpr int num_searchers = 4;
+    constexpr int num_explorations = 100;
+    const auto evaluate
+        = [](const uint n, const float*, float* values, float* logits) {
+              std::fill_n(values, n, 0.f);
+              std::fill_n(logits, n * Game::num_dlshogi_policy(), 0.f);
+          };
+    const auto g = Game();
+    std::vector<RootStats> stats(num_searchers);
+    std::vector<std::thread> threads;
+    for (int ii = 0; ii < num_searchers; ++ii) {
+        threads.emplace_back([&stats, &g, &evaluate, ii]() {
+            auto mcts = Searcher(1.f, 2, 1, static_cast<uint>(ii));
+            mcts.set_game(g, 0.f, zeros);
+            mcts.search(g, num_explorations, 1u, evaluate);
+            stats[static_cast<std::size_t>(ii)] = mcts.get_root_stats();
+        });
+    }
+    for (auto&& t : threads)
+        t.join();
+
+    auto merged = RootStats(stats[0]);
+    for (int ii = 1; ii < num_searchers; ++ii)
+        merged.merge(stats[static_cast<std::size_t>(ii)]);
+    CHECK_EQUAL(g.get_legal_moves().size(), merged.get_entries().size());
+    int sum = 0;
+    for (const auto& e : merged.get_entries())
+        sum += e.visit_count;
+    CHECK_EQUAL(num_searchers * num_explorations, sum);
+
+    const auto action = merged.get_action_by_visit_max();
+    const auto& entries = merged.get_entries();
+    const auto best = std::max_element(
+        entries.cbegin(), entries.cend(), [](const auto& x, const auto& y) {
+            return x.visit_count_excluding_random
+                   < y.visit_count_excluding_random;
+        });
+    CHECK_TRUE(best->action == action);
+
+    auto random = Random(0u);
+    const auto sampled = merged.get_action_by_visit_distribution(1.f, random);
+    CHECK_TRUE(std::any_of(
+        entries.cbegin(), entries.cend(), [&sampled](const auto& e) {
+            return e.action == sampled;
+        }));
+}
+
+} // namespace test_root_stats
+
+} // namespace test_vshogi::test_engine
@@ -0,0 +1,62 @@
+#include "vshogi/engine/time_manager.hpp"
+
+#include <cstdint>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi::test_engine
+{
+
+namespace test_time_manager
+{
+
+using TimeManager = vshogi::engine::TimeManager;
+
+TEST_GROUP(time_manager){};
+
+TEST(time_manager, no_budget)
+{
+    auto tm = TimeManager(0.);
+    CHECK_TRUE(tm.is_time_up(0u));
+    CHECK_TRUE(TimeManager(-1.).is_time_up(0u));
+}
+
+TEST(time_manager, time_up)
+{
+    auto tm = TimeManager(0.02);
+    std::uint64_t n = 0u;
+    while (!tm.is_time_up(n))
+        ++n;
+    CHECK_TRUE(tm.get_elapsed() >= 0.02);
+    CHECK_TRUE(tm.get_elapsed() < 1.);
+    CHECK_EQUAL(0.0, tm.get_remaining());
+    CHECK_EQUAL(0u, tm.estimate_remaining_count());
+    CHECK_TRUE(tm.get_rate() > 0.);
+}
+
+TEST(time_manager, estimate_remaining_count)
+{
+    auto tm = TimeManager(10.);
+    CHECK_FALSE(tm.is_time_up(0u));
+    CHECK_EQUAL(UINT64_MAX, tm.estimate_remaining_count());
+    CHECK_FALSE(tm.is_time_up(1u));
+    CHECK_TRUE(tm.get_remaining() > 9.);
+    CHECK_TRUE(tm.estimate_remaining_count() > 1u);
+}
+
+TEST(time_manager, from_clock)
+{
+    // 60 / 30 + 10 - 0.1
+    DOUBLES_EQUAL(
+        11.9, TimeManager::from_clock(60., 10.).get_remaining(), 1e-6);
+    // 60 / 30 + 5 - 0.1
+    DOUBLES_EQUAL(
+        6.9, TimeManager::from_clock(60., 0., 5.).get_remaining(), 1e-6);
+    // No more than the clock has.
+    DOUBLES_EQUAL(
+        0.9, TimeManager::from_clock(1., 0., 5., 1).get_remaining(), 1e-6);
+}
+
+} // namespace test_time_manager
+
+} // namespace test_vshogi::test_engine
@@ -1,3 +1,7 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "vshogi/variants/shogi.hpp"
 
 #include <CppUTest/TestHarness.h>
@@ -39,6 +43,74 @@ TEST(shogi_game, apply)
     }
 }
 
+TEST(shogi_game, undo)
+{
+    auto game = Game();
+    const std::vector<Move> moves = {
+        Move(SQ_7F, SQ_7G),
+        Move(SQ_3D, SQ_3C),
+        Move(SQ_2B, SQ_8H, true), // capture and promote
+        Move(SQ_2B, SQ_3A), // capture promoted piece
+        Move(SQ_5E, KA), // drop
+        Move(SQ_3C, SQ_2B),
+        Move(SQ_7C, SQ_5E, true),
+    };
+    std::vector<std::string> sfens;
+    std::vector<std::uint64_t> hashes;
+    std::vector<std::vector<Move>> legal_moves;
+    for (auto&& m : moves) {
+        sfens.emplace_back(game.to_sfen());
+        hashes.emplace_back(game.get_zobrist_hash());
+        legal_moves.emplace_back(game.get_legal_moves());
+        game.apply(m);
+        CHECK_EQUAL(vshogi::ONGOING, game.get_result());
+    }
+    for (std::size_t ii = moves.size(); ii--;) {
+        game.undo();
+        STRCMP_EQUAL(sfens[ii].c_str(), game.to_sfen().c_str());
+        CHECK_EQUAL(hashes[ii], game.get_zobrist_hash());
+        CHECK_TRUE(legal_moves[ii] == game.get_legal_moves());
+        CHECK_EQUAL(vshogi::ONGOING, game.get_result());
+    }
+}
+
+TEST(shogi_game, undo_mcts_internal_vertex)
+{
+    auto game = Game();
+    const auto sfen = game.to_sfen();
+    const auto hash = game.get_zobrist_hash();
+    game.apply_mcts_internal_vertex(Move(SQ_7F, SQ_7G))
+        .apply_mcts_internal_vertex(Move(SQ_3D, SQ_3C))
+        .apply_nocheck(Move(SQ_2B, SQ_8H, true));
+    game.undo_mcts_internal_vertex()
+        .undo_mcts_internal_vertex()
+        .undo_mcts_internal_vertex();
+    STRCMP_EQUAL(sfen.c_str(), game.to_sfen().c_str());
+    CHECK_EQUAL(hash, game.get_zobrist_hash());
+    CHECK_EQUAL(0, game.record_length());
+    CHECK_EQUAL(vshogi::UNKNOWN, game.get_result());
+}
+
+TEST(shogi_game, undo_after_copy)
+{
+    auto game = Game();
+    const auto sfen = game.to_sfen();
+    game.apply(Move(SQ_7F, SQ_7G)).apply(Move(SQ_3D, SQ_3C));
+    {
+        auto copied = Game(game);
+        copied.undo().undo();
+        STRCMP_EQUAL(sfen.c_str(), copied.to_sfen().c_str());
+        CHECK_EQUAL(0, copied.record_length());
+    }
+    {
+        auto copied = game.copy_and_apply_dfpn_offence(Move(SQ_2B, SQ_8H));
+        const auto sfen_dfpn = copied.to_sfen();
+        copied.apply(Move(SQ_2B, SQ_3A)).undo();
+        STRCMP_EQUAL(sfen_dfpn.c_str(), copied.to_sfen().c_str());
+        CHECK_EQUAL(3, copied.record_length());
+    }
+}
+
 TEST(shogi_game, result)
 {
     {
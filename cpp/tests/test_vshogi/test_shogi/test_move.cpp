@@ -77,4 +77,18 @@ TEST(move, to_dlshogi_policy_index)
         80 * (10 * 2 + 7) + 20 + 2, Move(SQ_1I, KE).to_dlshogi_policy_index());
 }
 
+TEST(move, to_dlshogi_policy_index_by_turn)
+{
+    const Move moves[] = {
+        Move(SQ_3C, SQ_3D), Move(SQ_8B, SQ_9A, true), Move(SQ_1I, KE)};
+    for (const auto& m : moves) {
+        CHECK_EQUAL(
+            m.to_dlshogi_policy_index(),
+            m.to_dlshogi_policy_index(vshogi::BLACK));
+        CHECK_EQUAL(
+            m.rotate().to_dlshogi_policy_index(),
+            m.to_dlshogi_policy_index(vshogi::WHITE));
+    }
+}
+
 } // namespace test_vshogi::test_shogi
@@ -54,6 +54,43 @@ TEST(state, apply)
     }
 }
 
+TEST(state, undo)
+{
+    {
+        const char sfen[] = "8+L/8g/9/9/4k4/9/9/2K6/9 w 2br10PR";
+        auto s = State(sfen);
+        auto hash = s.zobrist_hash();
+        const auto move = Move(SQ_1A, SQ_1B);
+        State::UndoInfo info;
+        s.apply(move, &hash, &info);
+        CHECK_EQUAL(s.zobrist_hash(), hash);
+        s.undo(move, info, &hash);
+        STRCMP_EQUAL(State(sfen).to_sfen().c_str(), s.to_sfen().c_str());
+        CHECK_EQUAL(State(sfen).zobrist_hash(), hash);
+    }
+    {
+        const char sfen[] = "4k4/9/9/9/9/9/9/9/4K4 b P";
+        auto s = State(sfen);
+        const auto move = Move(SQ_5B, FU);
+        State::UndoInfo info;
+        s.apply(move, nullptr, &info);
+        CHECK_TRUE(s.in_check());
+        s.undo(move, info);
+        STRCMP_EQUAL(State(sfen).to_sfen().c_str(), s.to_sfen().c_str());
+        CHECK_FALSE(s.in_check());
+    }
+    {
+        const char sfen[] = "4k4/9/4P4/9/9/9/9/9/4K4 b -";
+        auto s = State(sfen);
+        const auto move = Move(SQ_5B, SQ_5C, true);
+        State::UndoInfo info;
+        s.apply(move, nullptr, &info);
+        CHECK_EQUAL(B_TO, s.get_board()[SQ_5B]);
+        s.undo(move, info);
+        STRCMP_EQUAL(State(sfen).to_sfen().c_str(), s.to_sfen().c_str());
+    }
+}
+
 TEST(state, to_sfen)
 {
     {
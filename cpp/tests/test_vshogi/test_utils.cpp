@@ -0,0 +1,38 @@
+#include "vshogi/common/utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+namespace test_vshogi
+{
+
+using namespace vshogi;
+
+TEST_GROUP(utils){};
+
+TEST(utils, exp_nonpositive)
+{
+    for (float x = 0.f; x > -90.f; x -= 0.37f) {
+        const float expected = std::exp(std::max(x, -87.f));
+        DOUBLES_EQUAL(expected, exp_nonpositive(x), expected * 1e-6f);
+    }
+}
+
+TEST(utils, softmax)
+{
+    auto actual = std::vector<float>{1.f, 2.f, -3.f, 1.f};
+    softmax(actual);
+
+    float sum = 0.f;
+    for (auto&& e : std::vector<float>{1.f, 2.f, -3.f, 1.f})
+        sum += std::exp(e);
+    DOUBLES_EQUAL(std::exp(1.f) / sum, actual[0], 1e-6f);
+    DOUBLES_EQUAL(std::exp(2.f) / sum, actual[1], 1e-6f);
+    DOUBLES_EQUAL(std::exp(-3.f) / sum, actual[2], 1e-6f);
+    DOUBLES_EQUAL(actual[0], actual[3], 1e-6f);
+}
+
+} // namespace test_vshogi
@@ -66,6 +66,7 @@ class Args:
     validations: int = config(type=int, default=10, help='# of validation plays per model, default=10')
     win_ratio_threshold: float = config(type=float, default=0.55, help='Threshold of win ratio to adopt new model against previous one, default=0.55')
     jobs: int = config(short=False, type=int, default=1, help='# of jobs to run self-play in parallel, default=1')
+    self_play_games: int = config(type=int, default=1, help='# of self-play games played concurrently in one process, evaluating their positions in one NN batch, default=1')
     output: str = config(short=True, type=str, help='Output path of self-play datasets and trained NN models, default=`shogi`')
 
 
@@ -180,11 +181,19 @@ class PolicyValueFunction:
         input_details = self._interpreter.get_input_details()[0]
         self._input_placeholder = np.empty(input_details['shape'], dtype=np.float32)
         self._input_index = input_details['index']
+        self._input_shape = tuple(input_details['shape'])
         output_details = self._interpreter.get_output_details()
         self._value_index = output_details[0]['index']
         self._policy_index = output_details[1]['index']
 
+    def _resize_input(self, shape: tp.Tuple[int, ...]):
+        if self._input_shape != tuple(shape):
+            self._interpreter.resize_tensor_input(self._input_index, shape)
+            self._interpreter.allocate_tensors()
+            self._input_shape = tuple(shape)
+
     def __call__(self, game: vshogi.Game) -> tp.Tuple[np.ndarray, float]:
+        self._resize_input(self._input_placeholder.shape)
         game.to_dlshogi_features(out=self._input_placeholder)
         self._interpreter.set_tensor(self._input_index, self._input_placeholder)
         self._interpreter.invoke()
@@ -192,6 +201,14 @@ class PolicyValueFunction:
         policy_logits = self._interpreter.get_tensor(self._policy_index)
         return policy_logits, value
 
+    def batch(self, x: np.ndarray) -> tp.Tuple[np.ndarray, np.ndarray]:
+        self._resize_input(x.shape)
+        self._interpreter.set_tensor(self._input_index, x.astype(np.float32, copy=False))
+        self._interpreter.invoke()
+        value = self._interpreter.get_tensor(self._value_index).reshape(len(x))
+        policy_logits = self._interpreter.get_tensor(self._policy_index).reshape(len(x), -1)
+        return policy_logits, value
+
     def save_model_as_tflite(self, output_path: str):
         if self._model_content is None:
             raise ValueError('Cannot save tflite binary.')
@@ -343,6 +360,45 @@ def play_game_and_dump_record(
     return game.result
 
 
+def self_play_in_batch_and_dump_records(args: Args, index: int, max_moves: int = 320):
+    """Self-play `args.self_play_games` games concurrently with one NN batch per step.
+
+    Unlike `play_game()`, the number of random moves is the same for all the games, and DFPN
+    search is not used.
+    """
+    pv_func = PolicyValueFunction(f'models/model_{index - 1:04d}.tflite')
+    num_random_moves = int(min(args._num_random_moves, max_moves))
+    searcher = vshogi.engine.MultiGameMcts(
+        args._shogi.Game(),
+        pv_func.batch,
+        num_games=args.self_play_games,
+        n=args.mcts_explorations,
+        max_moves=max_moves,
+        coeff_puct=args.mcts_coeff_puct,
+        num_random_moves=num_random_moves,
+        temperature=args.mcts_temperature,
+    )
+    nth_game = args.self_play_index_from
+    nth_game_end = args.self_play_index_from + args.self_play
+    with tqdm(total=args.self_play, ncols=100, desc=f'{index-1} vs {index-1}') as bar:
+        while nth_game < nth_game_end:
+            searcher.step()
+            for game, plies in searcher.pop_records():
+                if (game.result == vshogi.ONGOING) or (nth_game >= nth_game_end):
+                    continue
+                game.v_value_record = [p['value'] for p in plies]
+                game.q_value_record = [p['q_value'] for p in plies]
+                game.visit_count_record = [
+                    {m.to_usi(): v + 1 for m, v in p['visit_counts_excluding_random'].items()}
+                    for p in plies
+                ]
+                game.z_weight_record = [0. if i < num_random_moves else 0.5 for i in range(len(plies))]
+                path = f'datasets/dataset_{index:04d}/record_{nth_game:05d}.tsv'
+                dump_game_records_and_convert_to_tfrecord(path, game, args)
+                nth_game += 1
+                bar.update()
+
+
 def read_kifu(tsv_path: str, fraction: float = None) -> pd.DataFrame:
     df = pd.read_csv(
         tsv_path, sep='\t',
@@ -443,7 +499,9 @@ def run_self_play(args: Args):
 
 
     def self_play_and_dump_records(index: int, index_another: tp.List[int]):
-        if args.jobs == 1:
+        if (args.self_play_games > 1) and all(i is None for i in index_another):
+            self_play_in_batch_and_dump_records(args, index)
+        elif args.jobs == 1:
             player = load_player_of(index - 1)
             player_another = [None if i is None else load_player_of(i) for i in index_another]
             for i in tqdm(
@@ -67,5 +67,16 @@ def test_dfpn_vertex():
     assert shogi.Move("3e4e") == engine.select()
 
 
+def test_dfpn_stats():
+    dfpn = DfpnSearcher()
+    assert dfpn.stats == {}
+    dfpn.set_game(shogi.Game("2rbk/2p1p/2P1P/3G1/3R1 b B"))
+    assert dfpn.search(n=10000)
+    stats = dfpn.stats
+    assert 0 < stats['num_explorations'] <= 10000
+    assert stats['num_nodes_created'] > stats['num_explorations']
+    assert stats['num_cache_lookups'] >= stats['num_cache_hits']
+
+
 if __name__ == '__main__':
     pytest.main([__file__])
@@ -1,14 +1,20 @@
+import time
+
 import numpy as np
 import pytest
 
 import vshogi.animal_shogi as shogi
-from vshogi.engine import Mcts
+from vshogi.engine import EvalCache, Mcts
 
 
 def uniform_pv_func(game):
     return np.zeros(game.num_dlshogi_policy), 0.
 
 
+def uniform_batch_pv_func(x):
+    return np.zeros((len(x), shogi.Game.num_dlshogi_policy)), np.zeros(len(x))
+
+
 def test_is_ready():
     # Turn: BLACK
     # White: -
@@ -53,6 +59,260 @@ def test_num_searched():
     assert searcher.num_searched == 100 + 1
 
 
+
+def test_num_searched_in_batch():
+    game = shogi.Game('g1e/1cl/1CL/E1G b -')
+
+    searcher = Mcts(
+        uniform_pv_func, batch_policy_value_func=uniform_batch_pv_func)
+    searcher.set_game(game)
+    searcher.search(n=100, batch_size=8)
+    assert searcher.num_searched == 100 + 1
+
+
+def test_search_in_cpp_with_batch_policy_value_func():
+    game = shogi.Game('g1e/1cl/1CL/E1G b -')
+
+    games = []
+
+    def pv_func(game):
+        games.append(game)
+        return uniform_pv_func(game)
+
+    searcher = Mcts(pv_func, batch_policy_value_func=uniform_batch_pv_func)
+    searcher.set_game(game)
+    searcher.search(n=100)
+    assert searcher.num_searched == 100 + 1
+    assert len(games) == 1  # Only the root is evaluated by `pv_func`.
+
+
+@pytest.mark.parametrize('batch_pv_func', [
+    lambda x: (np.zeros(shogi.Game.num_dlshogi_policy), np.zeros(len(x))),
+    lambda x: (np.zeros((shogi.Game.num_dlshogi_policy, len(x))),
+               np.zeros(len(x))),
+    lambda x: (np.zeros((len(x), shogi.Game.num_dlshogi_policy)),
+               np.zeros(len(x) + 1)),
+])
+def test_search_with_batch_policy_value_func_of_wrong_shape(batch_pv_func):
+    game = shogi.Game('g1e/1cl/1CL/E1G b -')
+
+    searcher = Mcts(uniform_pv_func, batch_policy_value_func=batch_pv_func)
+    searcher.set_game(game)
+    with pytest.raises(ValueError):
+        searcher.search(n=100, batch_size=4)
+
+
+def test_search_with_time_limit():
+    game = shogi.Game('g1e/1cl/1CL/E1G b -')
+
+    searcher = Mcts(
+        uniform_pv_func, batch_policy_value_func=uniform_batch_pv_func)
+    searcher.set_game(game)
+    searcher.search(time_limit=0.05, batch_size=4)
+    assert searcher.num_searched > 1
+
+    searcher = Mcts(uniform_pv_func)
+    searcher.set_game(game)
+    with pytest.raises(ValueError):
+        searcher.search(time_limit=0.05)
+
+
+def test_search_with_kldgain_threshold():
+    game = shogi.Game('g1e/1cl/1CL/E1G b -')
+
+    searcher = Mcts(
+        uniform_pv_func, batch_policy_value_func=uniform_batch_pv_func)
+    searcher.set_game(game)
+    searcher.search(n=1000, kldgain_threshold=1e9, kldgain_interval=30)
+    assert searcher.num_searched == 1 + 30
+
+
+def test_ponder():
+    game = shogi.Game('g1e/1cl/1CL/E1G b -')
+
+    searcher = Mcts(
+        uniform_pv_func, batch_policy_value_func=uniform_batch_pv_func)
+    searcher.set_game(game)
+    searcher.search(n=10)
+    move = searcher.select()
+    game.apply(move)
+    searcher.apply(move)
+    num_searched = searcher.num_searched
+
+    searcher.start_pondering(batch_size=4)
+    assert searcher.is_pondering
+    time.sleep(0.05)
+    searcher.stop_pondering()
+    assert not searcher.is_pondering
+    assert searcher.num_searched > num_searched
+
+    counts = searcher.get_visit_counts()
+    move = max(counts, key=counts.get)
+    searcher.start_pondering()
+    searcher.cancel_pondering()
+    searcher.apply(move)
+    assert not searcher.is_pondering
+    assert searcher.num_searched >= counts[move]
+
+
+def test_ponder_with_batch_policy_value_func_raising():
+    def raise_error(x):
+        raise RuntimeError('evaluation failed')
+
+    searcher = Mcts(uniform_pv_func, batch_policy_value_func=raise_error)
+    searcher.set_game(shogi.Game())
+    searcher.start_pondering(batch_size=4)
+    for _ in range(1000):
+        if not searcher.is_pondering:
+            break
+        time.sleep(0.01)
+    assert not searcher.is_pondering
+    with pytest.raises(RuntimeError):
+        searcher.stop_pondering()
+
+
+def test_ponder_without_batch_policy_value_func():
+    searcher = Mcts(uniform_pv_func)
+    searcher.set_game(shogi.Game())
+    with pytest.raises(ValueError):
+        searcher.start_pondering()
+
+
+def test_eval_cache():
+    game = shogi.Game()
+    cache = EvalCache(1 << 12)
+    num_evaluated = []
+
+    def batch_pv_func(x):
+        num_evaluated.append(len(x))
+        return uniform_batch_pv_func(x)
+
+    for _ in range(2):
+        searcher = Mcts(
+            uniform_pv_func, batch_policy_value_func=batch_pv_func,
+            eval_cache=cache)
+        searcher.set_game(game)
+        searcher.search(n=100, batch_size=4)
+        assert searcher.num_searched >= 101
+    assert searcher.eval_cache is cache
+    assert cache.get_num_hits() > 0
+    assert 0 < cache.get_hit_rate() <= 1
+    assert cache.get_num_lookups() >= cache.get_num_hits()
+    assert sum(num_evaluated) < 200
+
+
+def test_stats():
+    searcher = Mcts(uniform_pv_func)
+    searcher.set_game(shogi.Game())
+    assert searcher.stats is None
+
+    searcher = Mcts(
+        uniform_pv_func, batch_policy_value_func=uniform_batch_pv_func,
+        collect_stats=True)
+    searcher.set_game(shogi.Game())
+    searcher.search(n=100, batch_size=4)
+    stats = searcher.stats
+    assert stats['num_selections'] >= 100
+    assert sum(stats['depth_histogram']) == stats['num_selections']
+    assert stats['num_expanded'] > 0
+    assert stats['num_batches'] > 0
+    assert 0 < stats['batch_fill_ratio'] <= 1
+    assert stats['evaluation_seconds'] > 0
+
+
+def test_merge_root_stats():
+    game = shogi.Game()
+    searchers = [
+        Mcts(uniform_pv_func, random_depth=1, seed=seed)
+        for seed in range(3)
+    ]
+    for searcher in searchers:
+        searcher.set_game(game)
+        searcher.search(n=50)
+    stats = [searcher.get_root_stats() for searcher in searchers]
+    assert all(isinstance(b, bytes) for b in stats)
+
+    searcher = searchers[0]
+    searcher.merge_root_stats(stats[1:])
+    merged = searcher._merged_root_stats.get_visit_counts()
+    assert sum(merged.values()) == 150
+    assert searcher.select() in merged
+    assert searcher.select(temperature=1.) in merged
+
+    searcher.merge_root_stats([])
+    assert searcher._merged_root_stats.get_visit_counts() == (
+        searcher.get_visit_counts())
+    merged_q_values = searcher._merged_root_stats.get_q_values()
+    for action, q in searcher.get_q_values().items():
+        assert merged_q_values[action] == pytest.approx(q)
+    searcher.search(n=1)
+    assert searcher._merged_root_stats is None
+
+    with pytest.raises(ValueError):
+        searcher.merge_root_stats([b'\x00'])
+
+
+def test_search_gumbel():
+    # The chick captures the lion to win.
+    game = shogi.Game('1l1/1C1/3/1L1 b -')
+
+    searcher = Mcts(
+        uniform_pv_func, batch_policy_value_func=uniform_batch_pv_func)
+    searcher.set_game(game)
+    searcher.search(
+        n=32, batch_size=4, gumbel_num_sampled=16, gumbel_scale=0.)
+    assert 1 < searcher.num_searched <= 32 + 1
+    action = searcher.select()
+    assert action == shogi.Move(shogi.B1, shogi.B2)
+
+    policy = searcher.get_improved_policy()
+    assert set(policy) == set(game.get_legal_moves())
+    assert sum(policy.values()) == pytest.approx(1.)
+    assert max(policy, key=policy.get) == action
+
+    searcher.search(n=1)
+    assert searcher.select() in policy
+
+    searcher = Mcts(uniform_pv_func)
+    searcher.set_game(game)
+    with pytest.raises(ValueError):
+        searcher.search(n=32, gumbel_num_sampled=16)
+
+
+def test_search_pipelined():
+    game = shogi.Game('g1e/1cl/1CL/E1G b -')
+
+    searcher = Mcts(
+        uniform_pv_func, batch_policy_value_func=uniform_batch_pv_func)
+    searcher.set_game(game)
+    searcher.search(n=100, num_threads=2, batch_size=8)
+    assert 1 < searcher.num_searched <= 100 + 1
+
+
+def test_memory_budget():
+    game = shogi.Game()
+
+    searcher = Mcts(uniform_pv_func, memory_budget=32 * 1024)
+    searcher.set_game(game)
+    searcher.search(n=2000)
+    assert searcher.num_searched == 2000 + 1
+    assert searcher.memory_usage <= searcher.memory_budget + 4096
+
+
+def test_seed():
+    game = shogi.Game()
+
+    def search(seed):
+        searcher = Mcts(
+            uniform_pv_func, non_random_ratio=1, random_depth=3, seed=seed)
+        searcher.set_game(game)
+        searcher.search(n=200)
+        return searcher.get_visit_counts()
+
+    assert search(1) == search(1)
+    assert search(1) != search(2)
+
+
 # def test_apply():
 #     game = shogi.Game()
 #     searcher = Mcts(uniform_pv_func)
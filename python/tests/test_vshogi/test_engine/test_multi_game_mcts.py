@@ -0,0 +1,43 @@
+import numpy as np
+
+import vshogi.animal_shogi as shogi
+from vshogi.engine import MultiGameMcts
+
+
+def uniform_batch_pv_func(x):
+    return np.zeros((len(x), shogi.Game.num_dlshogi_policy)), np.zeros(len(x))
+
+
+def test_step():
+    num_evaluated = []
+
+    def pv_func(x):
+        num_evaluated.append(len(x))
+        return uniform_batch_pv_func(x)
+
+    searcher = MultiGameMcts(
+        shogi.Game(), pv_func, num_games=4, n=20, max_moves=8, seed=0)
+    assert searcher.num_games == 4
+    assert searcher.step(leaves_per_game=2) == 4  # Roots of all the games.
+    for _ in range(10):
+        searcher.step(leaves_per_game=2)
+    assert num_evaluated[0] == 4
+    assert all(n <= 4 * 2 for n in num_evaluated)
+    assert max(num_evaluated) > 2
+
+
+def test_play():
+    searcher = MultiGameMcts(
+        shogi.Game(), uniform_batch_pv_func, num_games=4, n=10, max_moves=6,
+        seed=0, num_random_moves=2)
+    records = searcher.play(num_records=5, leaves_per_game=2)
+    assert len(records) >= 5
+    assert searcher.num_records == 0
+    for game, plies in records:
+        assert isinstance(game, shogi.Game)
+        assert (game.result != shogi.ONGOING) or (game.record_length == 6)
+        assert len(plies) == game.record_length
+        for i, p in enumerate(plies):
+            assert p['action'] == game.get_move_at(i)
+            assert 1 <= sum(p['visit_counts'].values()) <= 10 + 2
+            assert set(p['q_values']) == set(p['visit_counts'])
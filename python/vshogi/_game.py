@@ -42,6 +42,16 @@ class Game(abc.ABC):
     def _get_mcts_searcher_class(cls) -> type:
         pass
 
+    @classmethod
+    @abc.abstractmethod
+    def _get_mcts_ponderer_class(cls) -> type:
+        pass
+
+    @classmethod
+    @abc.abstractmethod
+    def _get_mcts_multi_game_searcher_class(cls) -> type:
+        pass
+
     @classmethod
     @abc.abstractmethod
     def _get_dfpn_searcher_class(cls) -> type:
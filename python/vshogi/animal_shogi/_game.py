@@ -1,7 +1,8 @@
 import warnings
 
 from vshogi._game import Game as BaseGame
-from vshogi._vshogi.animal_shogi import MCTS, MctsNode, Move
+from vshogi._vshogi.animal_shogi import MCTS, MctsNode, MctsPonderer, Move
+from vshogi._vshogi.animal_shogi import MultiGameMCTS
 from vshogi._vshogi.animal_shogi import Stand
 from vshogi._vshogi.animal_shogi import _Game as _AnimalshogiGame
 
@@ -92,6 +93,14 @@ class Game(BaseGame):
     def _get_mcts_searcher_class(cls) -> type:
         return MCTS
 
+    @classmethod
+    def _get_mcts_ponderer_class(cls) -> type:
+        return MctsPonderer
+
+    @classmethod
+    def _get_mcts_multi_game_searcher_class(cls) -> type:
+        return MultiGameMCTS
+
     @classmethod
     def _get_dfpn_searcher_class(cls) -> type:
         raise NotImplementedError(
@@ -1,9 +1,11 @@
 """Module for Shogi engine."""
 
+from vshogi._vshogi import EvalCache
 from vshogi.engine._dfpn import DfpnSearcher
 from vshogi.engine._dfpn_mcts import DfpnMcts
 from vshogi.engine._engine import Engine
 from vshogi.engine._mcts import Mcts
+from vshogi.engine._multi_game_mcts import MultiGameMcts
 
 
 _classes = [
@@ -11,6 +13,7 @@ _classes = [
     DfpnSearcher,
     Engine,
     Mcts,
+    MultiGameMcts,
 ]
 
 
@@ -18,7 +21,7 @@ for _cls in _classes:
     _cls.__module__ = __name__
 
 
-__all__ = [_cls.__name__ for _cls in _classes]
+__all__ = [_cls.__name__ for _cls in _classes] + ['EvalCache']
 
 
 del _cls
@@ -73,7 +73,25 @@ class DfpnSearcher(Engine):
         # flake8: noqa
         raise NotImplementedError
 
-    def search(self, n: int = 100) -> bool:
+    @property
+    def stats(self) -> tp.Dict[str, int]:
+        """Return statistics of the searches done so far.
+
+        Returns
+        -------
+        tp.Dict[str, int]
+            Numbers of explorations, nodes created, and lookups and hits of
+            the cache of mates. Empty if no game is set yet.
+        """
+        if self._searcher is None:
+            return {}
+        return self._searcher.get_stats()
+
+    def search(
+        self,
+        n: int = 100,
+        time_limit: tp.Optional[float] = None,
+    ) -> bool:
         """Search for mate-moves.
 
         If you call this method multiple times, the following calls does not
@@ -84,6 +102,8 @@ class DfpnSearcher(Engine):
         ----------
         n : int, optional
             Number of nodes to search for, by default 100
+        time_limit : float, optional
+            Seconds to search for instead of `n` nodes, by default None.
 
         Returns
         -------
@@ -98,6 +118,8 @@ class DfpnSearcher(Engine):
         """
         if self._searcher is None:
             return False
+        if time_limit is not None:
+            return self._searcher.explore_for(time_limit)
         return self._searcher.explore(n)
 
     def select(self) -> Move:
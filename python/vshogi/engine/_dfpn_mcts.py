@@ -1,7 +1,5 @@
 import typing as tp
 
-import numpy as np
-
 from vshogi._game import Game
 from vshogi.engine._dfpn import DfpnSearcher
 from vshogi.engine._engine import Engine
@@ -103,49 +101,29 @@ class DfpnMcts(Engine):
             self._found_mate = True
             return
 
-        prev_visits = None
+        searcher = self._mcts._searcher
         kldgain_steps = 100
-        for ii in range(mcts_searches):
-            if ((ii % kldgain_steps == 0) and (kldgain_threshold is not None)):
-                if prev_visits is None:
-                    prev_visits = self._mcts.get_visit_counts()
-                else:
-                    kldgain = self._kldgain(prev_visits)
-                    if kldgain < kldgain_threshold * kldgain_steps:
-                        break
+        if kldgain_threshold is not None:
+            searcher.snapshot_visit_counts()
+        for _ in range(mcts_searches):
+            if ((kldgain_threshold is not None) and (
+                    searcher.get_visit_count_since_snapshot()
+                    >= kldgain_steps)):
+                if searcher.is_converged(kldgain_threshold):
+                    break
+                searcher.snapshot_visit_counts()
             game = self._mcts._game.copy()
-            node = self._mcts._searcher.select(game._game)
+            node = searcher.select(game._game)
             if node is None:
                 continue
 
             self._dfpn.set_game(game)
             if self._dfpn.search(dfpn_searches_at_vertex):
-                node.simulate_mate_and_backprop()
+                searcher.simulate_mate_and_backprop(node)
             else:
                 policy, value = self._mcts._policy_value_func(game)
-                node.simulate_expand_and_backprop(game._game, value, policy)
-
-    def _kldgain(self, prev_visits: tp.Dict[Move, int]) -> float:
-        prev_visits_added = {m: v + 1 for m, v in prev_visits.items()}
-        prev_visits_sum = sum(prev_visits_added.values())
-        prev_probas = {
-            m: prev_visits_added[m] / prev_visits_sum
-            for m in prev_visits_added.keys()
-        }
-        curr_visits = self._mcts.get_visit_counts()
-        curr_visits_added = {m: v + 1 for m, v in curr_visits.items()}
-        curr_visits_sum = sum(curr_visits_added.values())
-        curr_probas = {
-            m: curr_visits_added[m] / curr_visits_sum
-            for m in curr_visits_added.keys()
-        }
-        kldgain = sum(
-            curr_probas[m] * np.log(curr_probas[m] / prev_probas[m])
-            for m in prev_probas.keys()
-        )
-        for m in prev_visits.keys():
-            prev_visits[m] = curr_visits[m]
-        return kldgain
+                searcher.simulate_expand_and_backprop(
+                    node, game._game, value, policy)
 
     def select(self, temperature: tp.Optional[float] = None) -> Move:
         """Select action based on MCTS or DFPN.
@@ -212,12 +190,7 @@ class DfpnMcts(Engine):
         tp.Dict[Move, float]
             Raw probabilities of selecting actions by `policy_value_func`.
         """
-        move_proba_pair_list = [
-            (m, self._mcts._root.get_child(m).get_proba())
-            for m in self._mcts._root.get_actions()
-        ]
-        move_proba_pair_list.sort(key=lambda t: t[1], reverse=True)
-        return {m: p for m, p in move_proba_pair_list}
+        return self._mcts.get_probas()
 
     def get_q_values(self, greedy_depth: int = 0) -> tp.Dict[Move, float]:
         """Return Q value of each action.
@@ -233,12 +206,7 @@ class DfpnMcts(Engine):
         tp.Dict[Move, float]
             Q value of each action.
         """
-        move_q_pair_list = [
-            (m, -self._mcts._root.get_child(m).get_q_value(greedy_depth))
-            for m in self._mcts._root.get_actions()
-        ]
-        move_q_pair_list.sort(key=lambda a: a[1], reverse=True)
-        return {m: q for m, q in move_q_pair_list}
+        return self._mcts.get_q_values(greedy_depth=greedy_depth)
 
     def get_visit_counts(
         self,
@@ -1,8 +1,11 @@
+from concurrent.futures import ThreadPoolExecutor
+import random
 import typing as tp
 
 import numpy as np
 
 from vshogi._game import Game
+from vshogi._vshogi import EvalCache
 from vshogi.engine._engine import Engine
 
 
@@ -10,6 +13,10 @@ Move = tp.TypeVar('Move')
 Policy = tp.Dict[Move, float]
 Value = float
 
+# `c_visit` and `c_scale` of `sigma(q) = (c_visit + max_n) * c_scale * q`
+# scaling completed Q values in Gumbel search and improved policy.
+_GUMBEL_SIGMA_COEFFS = (50., 0.1)
+
 
 def _repr_node(n, greedy_detph: int = 0) -> str:
     d = greedy_detph
@@ -31,6 +38,7 @@ def _tree(
     if depth == 0:
         return out
     children = [(a, root.get_child(a)) for a in root.get_actions()]
+    children = [(a, c) for a, c in children if c is not None]  # Visited ones
     children.sort(key=lambda t: sort_key(t[1]), reverse=False)
     if breadth > 0:
         children = children[:breadth]
@@ -59,6 +67,12 @@ class Mcts(Engine):
         coeff_puct: float = 1.,
         non_random_ratio: int = 3,
         random_depth: int = 1,
+        batch_policy_value_func: tp.Optional[tp.Callable[
+            [np.ndarray], tp.Tuple[np.ndarray, np.ndarray]]] = None,
+        memory_budget: int = 0,
+        seed: tp.Optional[int] = None,
+        eval_cache: tp.Optional[EvalCache] = None,
+        collect_stats: bool = False,
     ) -> None:
         """Initialize MCT searcher.
 
@@ -75,18 +89,57 @@ class Mcts(Engine):
         random_depth : int, optional
             Default depth of explorations to select action in a random manner,
             by default 1.
+        batch_policy_value_func : tp.Callable[
+            [np.ndarray], tp.Tuple[np.ndarray, np.ndarray]], optional
+            Function to return policy logits of shape `[k, num_dlshogi_policy]`
+            and values of shape `[k]` given feature maps of shape
+            `[k, ranks, files, feature_channels]`. It is required to search
+            with `batch_size` more than 1, by default None.
+        memory_budget : int, optional
+            Number of bytes the search tree may use, by default 0 (unlimited).
+            Once the tree reaches the budget, the least visited subtrees are
+            pruned so that the search continues in fixed memory.
+        seed : tp.Optional[int], optional
+            Seed of random selections in search. Searches with the same seed
+            are reproducible unless searching in multiple threads. By default
+            None, which seeds randomly.
+        eval_cache : tp.Optional[EvalCache], optional
+            Cache of evaluations keyed by game position, which may be shared
+            with other searchers, e.g. of other self-play games, by default
+            None. Game positions found in it are not evaluated again.
+        collect_stats : bool, optional
+            Collect statistics of search available as `stats`, by default
+            False. It costs a few clock readings per selection.
         """
         self._policy_value_func = policy_value_func
+        self._batch_policy_value_func = batch_policy_value_func
         self._searcher = None
+        self._ponderer = None
+        self._merged_root_stats = None
+        self._gumbel_action = None
 
         self._coeff_puct = coeff_puct
         self._non_random_ratio = non_random_ratio
         self._random_depth = random_depth
+        self._memory_budget = memory_budget
+        self._seed = seed
+        self._eval_cache = eval_cache
+        self._collect_stats = collect_stats
 
     def _set_game(self, game: Game):
+        self.stop_pondering()
+        self._merged_root_stats = None
+        self._gumbel_action = None
         policy_logits, value = self._policy_value_func(game)
         self._searcher = game._get_mcts_searcher_class()(
-            self._coeff_puct, self._non_random_ratio, self._random_depth)
+            self._coeff_puct,
+            self._non_random_ratio,
+            self._random_depth,
+            random.getrandbits(64) if self._seed is None else self._seed,
+        )
+        self._searcher.set_memory_budget(self._memory_budget)
+        self._searcher.set_eval_cache(self._eval_cache)
+        self._searcher.set_stats_enabled(self._collect_stats)
         self._searcher.set_game(game._game, value, policy_logits)
         self._game = game
 
@@ -94,6 +147,9 @@ class Mcts(Engine):
         return self._searcher is not None
 
     def _clear(self) -> None:
+        self.stop_pondering()
+        self._merged_root_stats = None
+        self._gumbel_action = None
         self._searcher = None
         self._game = None
 
@@ -104,10 +160,80 @@ class Mcts(Engine):
         ----------
         move : Move
             Move to apply
+
+        Notes
+        -----
+        It stops pondering, keeping the searches done under the move.
         """
+        self.stop_pondering()
+        self._merged_root_stats = None
+        self._gumbel_action = None
         if self._is_ready():
             self._searcher.apply(move)
 
+    def start_pondering(self, batch_size: int = 1) -> None:
+        """Start searching on a background thread, and return immediately.
+
+        It is meant to search during opponent's turn after applying own move.
+        Searches done under the opponent's move are kept by `apply()`.
+
+        Parameters
+        ----------
+        batch_size : int, optional
+            Maximum number of game positions to evaluate at once by
+            `batch_policy_value_func`, by default 1.
+
+        Notes
+        -----
+        It requires `batch_policy_value_func`. `set_game()`, `apply()`, and
+        `search()` stop pondering by themselves. Stop pondering before calling
+        the other methods.
+        """
+        self._raise_error_if_not_ready()
+        if self._batch_policy_value_func is None:
+            raise ValueError('batch_policy_value_func is required to ponder.')
+        self.stop_pondering()
+        self._merged_root_stats = None
+        self._gumbel_action = None
+        self._ponderer = self._game._get_mcts_ponderer_class()(
+            self._searcher, self._batch_policy_value_func, batch_size)
+        self._ponderer.start(self._game._game)
+
+    def stop_pondering(self) -> None:
+        """Stop searching on the background thread, and wait for it.
+
+        Searches done so far are kept. An exception raised by
+        `batch_policy_value_func` during pondering is raised here.
+        """
+        if self._ponderer is not None:
+            ponderer, self._ponderer = self._ponderer, None
+            ponderer.stop()
+
+    def cancel_pondering(self) -> None:
+        """Ask the background thread to stop without waiting for it.
+
+        The thread stops after evaluating the current batch. The next call of
+        `stop_pondering()`, `set_game()`, `apply()`, or `search()` waits for
+        it.
+        """
+        if self._ponderer is not None:
+            self._ponderer.request_stop()
+
+    @property
+    def is_pondering(self) -> bool:
+        """Return true if searching on the background thread.
+
+        Returns
+        -------
+        bool
+            True if pondering is started and the background thread is still
+            searching, which turns false once it exits, e.g. because
+            `batch_policy_value_func` has raised. Then `stop_pondering()`
+            raises the error.
+        """
+        return (
+            self._ponderer is not None and self._ponderer.is_pondering())
+
     @property
     def num_searched(self) -> int:
         """Return number of game positions searched so far.
@@ -121,21 +247,186 @@ class Mcts(Engine):
             return 0
         return self._searcher.get_visit_count()
 
-    def search(self, n: int = 100):
+    @property
+    def memory_budget(self) -> int:
+        """Return number of bytes the search tree may use, 0 if unlimited.
+
+        Returns
+        -------
+        int
+            Number of bytes the search tree may use.
+        """
+        return self._memory_budget
+
+    @memory_budget.setter
+    def memory_budget(self, value: int):
+        self._memory_budget = value
+        if self._searcher is not None:
+            self._searcher.set_memory_budget(value)
+
+    @property
+    def memory_usage(self) -> int:
+        """Return number of bytes used by the search tree.
+
+        Returns
+        -------
+        int
+            Number of bytes used by the search tree.
+        """
+        if self._searcher is None:
+            return 0
+        return self._searcher.get_memory_usage()
+
+    @property
+    def stats(self) -> tp.Optional[tp.Dict[str, tp.Any]]:
+        """Return statistics of search since the game is set.
+
+        Returns
+        -------
+        tp.Optional[tp.Dict[str, tp.Any]]
+            Counts of selections, collisions with leaves pending evaluation,
+            game ends, nodes proven to be mate, and leaves expanded by
+            evaluation and from `eval_cache`, histogram
+            of selection depths, seconds spent on selection, feature
+            extraction, evaluation, and backpropagation, number of batches,
+            and the average batch fill ratio. None unless `collect_stats` is
+            true.
+        """
+        if self._searcher is None:
+            return None
+        return self._searcher.get_stats()
+
+    @property
+    def eval_cache(self) -> tp.Optional[EvalCache]:
+        """Return cache of evaluations the searcher consults, if any.
+
+        Returns
+        -------
+        tp.Optional[EvalCache]
+            Cache of evaluations with its hit-rate statistics.
+        """
+        return self._eval_cache
+
+    def search(
+        self,
+        n: int = 100,
+        num_threads: int = 1,
+        batch_size: int = 1,
+        time_limit: tp.Optional[float] = None,
+        kldgain_threshold: tp.Optional[float] = None,
+        kldgain_interval: int = 100,
+        gumbel_num_sampled: tp.Optional[int] = None,
+        gumbel_scale: float = 1.,
+    ):
         """Explore from root node for n times.
 
         Parameters
         ----------
         n : int, optional
             Number of game positions to search, by default 100
+        num_threads : int, optional
+            Number of threads exploring the tree concurrently, by default 1.
+            `policy_value_func` must be thread-safe if this is more than 1.
+        batch_size : int, optional
+            Maximum number of game positions to evaluate at once by
+            `batch_policy_value_func`, by default 1. If both `batch_size` and
+            `num_threads` are more than 1, search threads keep selecting
+            leaves while a dedicated thread evaluates the selected ones.
+        time_limit : float, optional
+            Seconds to search for instead of `n` times, by default None.
+            Search stops earlier if the remaining time cannot change the most
+            visited action. It requires `batch_policy_value_func` and runs in
+            a single thread.
+        kldgain_threshold : float, optional
+            Stop search before `n` times once KL divergence gain of the visit
+            distribution at the root per visit falls below this value, by
+            default None. It requires `batch_policy_value_func` and runs in a
+            single thread.
+        kldgain_interval : int, optional
+            Minimum number of visits between two checks of KL divergence gain,
+            by default 100.
+        gumbel_num_sampled : int, optional
+            Number of actions to sample at the root by Gumbel noise, which
+            are narrowed down to one by sequential halving within about `n`
+            visits instead of PUCT algorithm at the root, by default None.
+            The action is returned by `select()`, and `get_improved_policy()`
+            gives a training target of the policy. It requires
+            `batch_policy_value_func` and runs in a single thread.
+        gumbel_scale : float, optional
+            Scale of the Gumbel noise, by default 1. Zero samples actions of
+            the highest prior probabilities, e.g. for evaluation games.
+
+        Notes
+        -----
+        If `batch_policy_value_func` is given, the whole search loop runs in
+        C++ without holding the GIL except while calling the function.
         """
+        self.stop_pondering()
+        self._merged_root_stats = None
+        self._gumbel_action = None
+        if (batch_size > 1) and (self._batch_policy_value_func is None):
+            raise ValueError(
+                'batch_policy_value_func is required to search in batch.')
+        if time_limit is not None:
+            if self._batch_policy_value_func is None:
+                raise ValueError(
+                    'batch_policy_value_func is required to search with '
+                    'time_limit.')
+            self._searcher.search_for(
+                self._game._game, time_limit, batch_size,
+                self._batch_policy_value_func)
+            return
+        if gumbel_num_sampled is not None:
+            if self._batch_policy_value_func is None:
+                raise ValueError(
+                    'batch_policy_value_func is required to search with '
+                    'gumbel_num_sampled.')
+            self._gumbel_action = self._searcher.search_gumbel(
+                self._game._game, n, batch_size,
+                self._batch_policy_value_func, gumbel_num_sampled,
+                gumbel_scale, *_GUMBEL_SIGMA_COEFFS)
+            return
+        if kldgain_threshold is not None:
+            if self._batch_policy_value_func is None:
+                raise ValueError(
+                    'batch_policy_value_func is required to search with '
+                    'kldgain_threshold.')
+            self._searcher.search(
+                self._game._game, n, batch_size,
+                self._batch_policy_value_func, kldgain_threshold,
+                kldgain_interval)
+            return
+        if self._batch_policy_value_func is not None:
+            if (batch_size > 1) and (num_threads > 1):
+                self._searcher.search_pipelined(
+                    self._game._game, n, num_threads, batch_size,
+                    self._batch_policy_value_func)
+            else:
+                self._searcher.search(
+                    self._game._game, n, batch_size,
+                    self._batch_policy_value_func)
+            return
+        if num_threads <= 1:
+            self._search(n)
+            return
+        with ThreadPoolExecutor(max_workers=num_threads) as executor:
+            futures = [
+                executor.submit(
+                    self._search, n // num_threads + (i < n % num_threads))
+                for i in range(num_threads)
+            ]
+            for f in futures:
+                f.result()
+
+    def _search(self, n: int):
         for _ in range(n):
             game = self._game.copy()
             node = self._searcher.select(game._game)
             if node is None:
                 continue
             policy_logits, value = self._policy_value_func(game)
-            node.simulate_expand_and_backprop(game._game, value, policy_logits)
+            self._searcher.simulate_expand_and_backprop(
+                node, game._game, value, policy_logits)
 
     def get_value(self) -> float:
         """Return raw value estimate of the current game position.
@@ -172,10 +463,7 @@ class Mcts(Engine):
             Raw probabilities of selecting actions by `policy_value_func`.
         """
         root = self._searcher.get_root()
-        move_proba_pair_list = [
-            (m, root.get_child(m).get_proba())
-            for m in root.get_actions()
-        ]
+        move_proba_pair_list = list(zip(root.get_actions(), root.get_probas()))
         move_proba_pair_list.sort(key=lambda t: t[1], reverse=True)
         return {m: p for m, p in move_proba_pair_list}
 
@@ -195,12 +483,27 @@ class Mcts(Engine):
         """
         root = self._searcher.get_root()
         move_q_pair_list = [
-            (m, -root.get_child(m).get_q_value(greedy_depth))
-            for m in root.get_actions()
+            (m, -q) for m, q in zip(
+                root.get_actions(), root.get_q_values(greedy_depth))
         ]
         move_q_pair_list.sort(key=lambda a: a[1], reverse=True)
         return {m: q for m, q in move_q_pair_list}
 
+    def get_improved_policy(self) -> tp.Dict[Move, float]:
+        """Return improved policy, softmax of the sum of the logit of the
+        prior probability and the completed Q value of each action.
+
+        It is a training target of the policy better than visit counts for
+        small numbers of visits, especially after Gumbel search.
+
+        Returns
+        -------
+        tp.Dict[Move, float]
+            Probability of each action.
+        """
+        return self._searcher.get_improved_policy(
+            0, 0., *_GUMBEL_SIGMA_COEFFS)
+
     def get_visit_counts(
         self,
         include_random: bool = True,
@@ -218,18 +521,49 @@ class Mcts(Engine):
             Visit counts of each action.
         """
         root = self._searcher.get_root()
-        move_visit_count_pair_list = [
-            (
-                m,
-                root.get_child(m).get_visit_count()
-                if include_random else
-                root.get_child(m).get_visit_count_excluding_random(),
-            )
-            for m in root.get_actions()
-        ]
+        move_visit_count_pair_list = list(zip(
+            root.get_actions(),
+            root.get_visit_counts() if include_random
+            else root.get_visit_counts_excluding_random(),
+        ))
         move_visit_count_pair_list.sort(key=lambda a: a[1], reverse=True)
         return {m: v for m, v in move_visit_count_pair_list}
 
+    def get_root_stats(self) -> bytes:
+        """Return statistics of the root's children as compact bytes.
+
+        They are meant to be sent from worker processes searching the same
+        game position, e.g. with different seeds, to `merge_root_stats()`.
+
+        Returns
+        -------
+        bytes
+            Action, visit counts, and Q-value of each child of the root in
+            native byte order.
+        """
+        self._raise_error_if_not_ready()
+        return self._searcher.get_root_stats().to_bytes()
+
+    def merge_root_stats(self, others: tp.Iterable[bytes]) -> None:
+        """Merge root statistics of other searchers into those of this one.
+
+        `select()` uses the merged statistics, summing up visit counts and
+        averaging Q-values weighted by visit counts, until the next call of
+        `set_game()`, `apply()`, `search()`, or `start_pondering()`.
+
+        Parameters
+        ----------
+        others : tp.Iterable[bytes]
+            Return values of `get_root_stats()` of other searchers of the
+            same game position.
+        """
+        self._raise_error_if_not_ready()
+        merged = self._searcher.get_root_stats()
+        for b in others:
+            merged.merge(type(merged).from_bytes(b))
+        self._merged_root_stats = merged
+        self._gumbel_action = None
+
     def select(self, temperature: tp.Optional[float] = None) -> Move:
         """Return selected action based on visit counts.
 
@@ -242,8 +576,17 @@ class Mcts(Engine):
         Returns
         -------
         Move
-            Selected action.
+            Selected action, or the one chosen by the last Gumbel search
+            regardless of `temperature`.
         """
+        if self._gumbel_action is not None:
+            return self._gumbel_action
+        if self._merged_root_stats is not None:
+            merged = self._merged_root_stats
+            if (temperature is None) or np.isclose(temperature, 0):
+                return merged.get_action_by_visit_max()
+            return merged.get_action_by_visit_distribution(
+                temperature, random.getrandbits(64))
         if (temperature is None) or np.isclose(temperature, 0):
             return self._searcher.get_action_by_visit_max()
         else:
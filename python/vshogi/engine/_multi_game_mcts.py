@@ -0,0 +1,165 @@
+import random
+import typing as tp
+
+import numpy as np
+
+from vshogi._game import Game
+
+
+class MultiGameMcts:
+    """Monte Carlo Tree Searcher playing many games concurrently, e.g. for
+    self-play, evaluating game positions of all the games in one batch.
+
+    Examples
+    --------
+    >>> import vshogi.animal_shogi as shogi
+    >>> def uniform(x):
+    ...     return (
+    ...         np.zeros((len(x), shogi.Game.num_dlshogi_policy)),
+    ...         np.zeros(len(x)))
+    >>> searcher = MultiGameMcts(
+    ...     shogi.Game(), uniform, num_games=4, n=10, max_moves=6, seed=0)
+    >>> records = searcher.play(num_records=4)
+    >>> len(records) >= 4
+    True
+    >>> game, plies = records[0]
+    >>> len(plies) == game.record_length
+    True
+    """
+
+    def __init__(
+        self,
+        game: Game,
+        batch_policy_value_func: tp.Callable[
+            [np.ndarray], tp.Tuple[np.ndarray, np.ndarray]],
+        num_games: int = 64,
+        n: int = 100,
+        max_moves: int = 320,
+        coeff_puct: float = 1.,
+        non_random_ratio: int = 3,
+        random_depth: int = 1,
+        seed: tp.Optional[int] = None,
+        num_random_moves: int = 0,
+        temperature: float = 1.,
+    ) -> None:
+        """Initialize searcher of concurrent games.
+
+        Parameters
+        ----------
+        game : Game
+            Game position all the games start from, and restart from once
+            finished.
+        batch_policy_value_func : tp.Callable[
+            [np.ndarray], tp.Tuple[np.ndarray, np.ndarray]]
+            Function to return policy logits of shape `[k, num_dlshogi_policy]`
+            and values of shape `[k]` given feature maps of shape
+            `[k, ranks, files, feature_channels]`. It is called once per step
+            with game positions of all the games.
+        num_games : int, optional
+            Number of games to play concurrently, by default 64.
+        n : int, optional
+            Number of visits to the root of a game before choosing an action,
+            including those reused from the previous move, by default 100.
+        max_moves : int, optional
+            Maximum number of moves of a game, after which the game is
+            recorded even if it is ongoing, by default 320.
+        coeff_puct : float, optional
+            Coefficient of PUCT score, by default 1.
+        non_random_ratio : int, optional
+            Ratio of selecting action in a non-random manner, by default 3.
+        random_depth : int, optional
+            Depth of explorations to select action in a random manner,
+            by default 1.
+        seed : tp.Optional[int], optional
+            Seed of the searches, by default None, which seeds randomly.
+        num_random_moves : int, optional
+            Number of moves from the initial game position to choose actions
+            by visit distribution with `temperature` instead of the most
+            visited ones, by default 0.
+        temperature : float, optional
+            Temperature of the visit distribution, by default 1.
+        """
+        self._game_class = type(game)
+        self._batch_policy_value_func = batch_policy_value_func
+        self._searcher = game._get_mcts_multi_game_searcher_class()(
+            game._game,
+            num_games,
+            n,
+            max_moves,
+            coeff_puct,
+            non_random_ratio,
+            random_depth,
+            random.getrandbits(64) if seed is None else seed,
+        )
+        self._searcher.set_random_moves(num_random_moves, temperature)
+
+    @property
+    def num_games(self) -> int:
+        """Number of games played concurrently."""
+        return self._searcher.get_num_games()
+
+    @property
+    def num_records(self) -> int:
+        """Number of games finished and not popped yet."""
+        return self._searcher.get_num_records()
+
+    def step(self, leaves_per_game: int = 1) -> int:
+        """Select game positions from all the games, evaluate them at once,
+        and advance the games whose searches are done.
+
+        Parameters
+        ----------
+        leaves_per_game : int, optional
+            Maximum number of game positions to select per game, by default
+            1.
+
+        Returns
+        -------
+        int
+            Number of game positions evaluated.
+        """
+        return self._searcher.step(
+            self._batch_policy_value_func, leaves_per_game)
+
+    def play(
+        self,
+        num_records: int,
+        leaves_per_game: int = 1,
+    ) -> tp.List[tp.Tuple[Game, tp.List[tp.Dict[str, tp.Any]]]]:
+        """Step until at least `num_records` games are finished, and return
+        the finished games.
+
+        Parameters
+        ----------
+        num_records : int
+            Number of games to finish.
+        leaves_per_game : int, optional
+            Maximum number of game positions to select per game in a step,
+            by default 1.
+
+        Returns
+        -------
+        tp.List[tp.Tuple[Game, tp.List[tp.Dict[str, tp.Any]]]]
+            See `pop_records()`.
+        """
+        while self._searcher.get_num_records() < num_records:
+            self.step(leaves_per_game)
+        return self.pop_records()
+
+    def pop_records(
+        self,
+    ) -> tp.List[tp.Tuple[Game, tp.List[tp.Dict[str, tp.Any]]]]:
+        """Return games finished since the last call.
+
+        Returns
+        -------
+        tp.List[tp.Tuple[Game, tp.List[tp.Dict[str, tp.Any]]]]
+            Pairs of a game and statistics of the search of each of its
+            moves, which are `action`, `value` of the root by the evaluator,
+            `q_value` of the root, and `visit_counts`,
+            `visit_counts_excluding_random`, and `q_values` of the actions.
+        """
+        return [
+            (self._game_class(game), plies)
+            for game, plies in self._searcher.pop_records()
+        ]
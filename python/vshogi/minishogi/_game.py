@@ -3,7 +3,9 @@ from vshogi._vshogi.minishogi import (
     DfpnSearcher,
     MCTS,
     MctsNode,
+    MctsPonderer,
     Move,
+    MultiGameMCTS,
     _Game as _MinishogiGame,
 )
 
@@ -57,6 +59,14 @@ class Game(BaseGame):
     def _get_mcts_searcher_class(cls) -> type:
         return MCTS
 
+    @classmethod
+    def _get_mcts_ponderer_class(cls) -> type:
+        return MctsPonderer
+
+    @classmethod
+    def _get_mcts_multi_game_searcher_class(cls) -> type:
+        return MultiGameMCTS
+
     @classmethod
     def _get_dfpn_searcher_class(cls) -> type:
         return DfpnSearcher
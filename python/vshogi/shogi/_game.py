@@ -3,7 +3,9 @@ from vshogi._vshogi.shogi import (
     DfpnSearcher,
     MCTS,
     MctsNode,
+    MctsPonderer,
     Move,
+    MultiGameMCTS,
     _Game as _ShogiGame,
 )
 
@@ -67,6 +69,14 @@ LNSGKGSNL w - 2")
     def _get_mcts_searcher_class(cls) -> type:
         return MCTS
 
+    @classmethod
+    def _get_mcts_ponderer_class(cls) -> type:
+        return MctsPonderer
+
+    @classmethod
+    def _get_mcts_multi_game_searcher_class(cls) -> type:
+        return MultiGameMCTS
+
     @classmethod
     def _get_dfpn_searcher_class(cls) -> type:
         return DfpnSearcher